@@ -92,3 +92,104 @@ _CPU_AND_GPU_CODE_ inline bool computePerPointGH_rt_Color(THREADPTR(float) *loca
 
 	return true;
 }
+
+/// Intensity of a point cloud colour, with the weights used by convertColourToIntensity
+_CPU_AND_GPU_CODE_ inline float getPointIntensity(const CONSTPTR(Vector4f) & colour)
+{
+	return 255.0f * (0.299f * colour.x + 0.587f * colour.y + 0.114f * colour.z);
+}
+
+/// Bilinear lookup of intensity and both gradients, sharing the weights between the three channels
+_CPU_AND_GPU_CODE_ inline void interpolateIntensityAndGradient(THREADPTR(float) &intensity_obs, THREADPTR(Vector2f) &gradient_obs,
+	const CONSTPTR(uchar) *intensity, const CONSTPTR(Vector2s_) *gradients, const THREADPTR(Vector2f) & position, const CONSTPTR(Vector2i) & imgSize)
+{
+	Vector2i p; Vector2f delta;
+
+	p.x = (int)floor(position.x); p.y = (int)floor(position.y);
+	delta.x = position.x - (float)p.x; delta.y = position.y - (float)p.y;
+
+	int locId = p.x + p.y * imgSize.x;
+	float w_a = (1.0f - delta.x) * (1.0f - delta.y), w_b = delta.x * (1.0f - delta.y);
+	float w_c = (1.0f - delta.x) * delta.y, w_d = delta.x * delta.y;
+
+	intensity_obs = w_a * intensity[locId] + w_b * intensity[locId + 1] + w_c * intensity[locId + imgSize.x] + w_d * intensity[locId + imgSize.x + 1];
+
+	Vector2s g_a = gradients[locId], g_b = gradients[locId + 1], g_c = gradients[locId + imgSize.x], g_d = gradients[locId + imgSize.x + 1];
+	gradient_obs.x = w_a * g_a.x + w_b * g_b.x + w_c * g_c.x + w_d * g_d.x;
+	gradient_obs.y = w_a * g_a.y + w_b * g_b.y + w_c * g_c.y + w_d * g_d.y;
+}
+
+_CPU_AND_GPU_CODE_ inline float getIntensityDifferenceSq(const CONSTPTR(Vector4f) *locations, const CONSTPTR(Vector4f) *colours, const CONSTPTR(uchar) *intensity,
+	const CONSTPTR(Vector2i) & imgSize, int locId_global, const CONSTPTR(Vector4f) & projParams, const CONSTPTR(Matrix4f) & M)
+{
+	Vector4f pt_camera = M * locations[locId_global];
+
+	if (pt_camera.z <= 0) return -1.0f;
+
+	Vector2f pt_image;
+	pt_image.x = projParams.x * pt_camera.x / pt_camera.z + projParams.z;
+	pt_image.y = projParams.y * pt_camera.y / pt_camera.z + projParams.w;
+
+	// all four neighbours are read, so stay clear of the last row and column
+	if (pt_image.x < 0 || pt_image.x >= imgSize.x - 1 || pt_image.y < 0 || pt_image.y >= imgSize.y - 1) return -1.0f;
+
+	Vector2i p; Vector2f delta;
+	p.x = (int)floor(pt_image.x); p.y = (int)floor(pt_image.y);
+	delta.x = pt_image.x - (float)p.x; delta.y = pt_image.y - (float)p.y;
+
+	int locId = p.x + p.y * imgSize.x;
+	float intensity_obs = (1.0f - delta.x) * (1.0f - delta.y) * intensity[locId] + delta.x * (1.0f - delta.y) * intensity[locId + 1] +
+		(1.0f - delta.x) * delta.y * intensity[locId + imgSize.x] + delta.x * delta.y * intensity[locId + imgSize.x + 1];
+
+	float intensity_diff = intensity_obs - getPointIntensity(colours[locId_global]);
+
+	return intensity_diff * intensity_diff;
+}
+
+template<bool rotationOnly>
+_CPU_AND_GPU_CODE_ inline bool computePerPointGH_Intensity(THREADPTR(float) *localGradient, THREADPTR(float) *localHessian,
+	const CONSTPTR(Vector4f) *locations, const CONSTPTR(Vector4f) *colours, const CONSTPTR(uchar) *intensity, const CONSTPTR(Vector2s_) *gradients,
+	const CONSTPTR(Vector2i) & imgSize, int locId_global, const CONSTPTR(Vector4f) & projParams, const CONSTPTR(Matrix4f) & M)
+{
+	const int noPara = rotationOnly ? 3 : 6;
+
+	Vector4f pt_camera = M * locations[locId_global];
+
+	if (pt_camera.z <= 0) return false;
+
+	float invZ = 1.0f / pt_camera.z;
+
+	Vector2f pt_image;
+	pt_image.x = projParams.x * pt_camera.x * invZ + projParams.z;
+	pt_image.y = projParams.y * pt_camera.y * invZ + projParams.w;
+
+	if (pt_image.x < 0 || pt_image.x >= imgSize.x - 1 || pt_image.y < 0 || pt_image.y >= imgSize.y - 1) return false;
+
+	float intensity_obs; Vector2f gradient_obs;
+	interpolateIntensityAndGradient(intensity_obs, gradient_obs, intensity, gradients, pt_image, imgSize);
+
+	float intensity_diff_d = 2.0f * (intensity_obs - getPointIntensity(colours[locId_global]));
+
+	// image gradient chained with the derivative of the projection, w.r.t. the camera space point
+	Vector3f d_pt;
+	d_pt.x = gradient_obs.x * projParams.x * invZ;
+	d_pt.y = gradient_obs.y * projParams.y * invZ;
+	d_pt.z = -(d_pt.x * pt_camera.x + d_pt.y * pt_camera.y) * invZ;
+
+	float d[6];
+	if (!rotationOnly)
+	{
+		d[0] = d_pt.x * pt_camera.w; d[1] = d_pt.y * pt_camera.w; d[2] = d_pt.z * pt_camera.w;
+	}
+	d[noPara - 3] = d_pt.z * pt_camera.y - d_pt.y * pt_camera.z;
+	d[noPara - 2] = d_pt.x * pt_camera.z - d_pt.z * pt_camera.x;
+	d[noPara - 1] = d_pt.y * pt_camera.x - d_pt.x * pt_camera.y;
+
+	for (int para = 0, counter = 0; para < noPara; para++)
+	{
+		localGradient[para] = d[para] * intensity_diff_d;
+		for (int col = 0; col <= para; col++) localHessian[counter++] = 2.0f * d[para] * d[col];
+	}
+
+	return true;
+}
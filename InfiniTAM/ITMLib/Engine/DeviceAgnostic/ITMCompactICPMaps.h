@@ -0,0 +1,171 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include "../../Utils/ITMLibDefines.h"
+#include "ITMPixelUtils.h"
+
+/** Compact ICP maps store, per pixel, the depth of the surface point
+    along the ray of that pixel in the camera that rendered it, and the
+    surface normal in the same camera frame as two snorm16 octahedral
+    coordinates (Vector2s). The raycaster finds the points on the pixel
+    rays, so the depth is all that is needed to recover them exactly, and
+    the maps take 8 bytes per pixel instead of the 32 bytes of the two
+    Vector4f maps.
+*/
+
+#define COMPACT_OCT_SCALE 32767.0f
+
+_CPU_AND_GPU_CODE_ inline float signNotZero(float value) { return value >= 0.0f ? 1.0f : -1.0f; }
+
+_CPU_AND_GPU_CODE_ inline Vector2s encodeOctahedralNormal(const THREADPTR(Vector3f) & normal)
+{
+	float invL1Norm = 1.0f / (fabs(normal.x) + fabs(normal.y) + fabs(normal.z));
+	float u = normal.x * invL1Norm, v = normal.y * invL1Norm;
+
+	if (normal.z < 0.0f)
+	{
+		float tmp = (1.0f - fabs(v)) * signNotZero(u);
+		v = (1.0f - fabs(u)) * signNotZero(v); u = tmp;
+	}
+
+	Vector2s result;
+	result.x = (short)floor(u * COMPACT_OCT_SCALE + 0.5f);
+	result.y = (short)floor(v * COMPACT_OCT_SCALE + 0.5f);
+	return result;
+}
+
+/// Returns the normal scaled to unit L1 norm, normalise before use
+_CPU_AND_GPU_CODE_ inline Vector3f decodeOctahedralNormal(const THREADPTR(Vector2s) & encoded)
+{
+	Vector3f result;
+	result.x = (float)encoded.x / COMPACT_OCT_SCALE;
+	result.y = (float)encoded.y / COMPACT_OCT_SCALE;
+	result.z = 1.0f - fabs(result.x) - fabs(result.y);
+
+	if (result.z < 0.0f)
+	{
+		float tmp = (1.0f - fabs(result.y)) * signNotZero(result.x);
+		result.y = (1.0f - fabs(result.x)) * signNotZero(result.y); result.x = tmp;
+	}
+
+	return result;
+}
+
+_CPU_AND_GPU_CODE_ inline void encodeCompactICPPixel(DEVICEPTR(float) &compactDepth, DEVICEPTR(Vector2s_) &compactNormal,
+	const THREADPTR(Vector3f) &point, const THREADPTR(Vector3f) &normal, const CONSTPTR(Matrix4f) &M)
+{
+	Vector4f pt_camera = M * Vector4f(point, 1.0f);
+	Vector4f n_camera = M * Vector4f(normal, 0.0f);
+
+	// visible surfaces face the camera, flip them into the unfolded half of the octahedron
+	compactDepth = pt_camera.z;
+	compactNormal = encodeOctahedralNormal(Vector3f(n_camera.x, n_camera.y, -n_camera.z));
+}
+
+_CPU_AND_GPU_CODE_ inline void encodeCompactICPHole(DEVICEPTR(float) &compactDepth, DEVICEPTR(Vector2s_) &compactNormal)
+{
+	compactDepth = -1.0f;
+	compactNormal.x = 0; compactNormal.y = 0;
+}
+
+/// Applies the inverse of the rigid transformation @p M, taking camera coordinates back to the world
+_CPU_AND_GPU_CODE_ inline Vector3f invRotate(const CONSTPTR(Matrix4f) & M, const THREADPTR(Vector3f) & v)
+{
+	Vector3f result;
+	result.x = M.m00 * v.x + M.m01 * v.y + M.m02 * v.z;
+	result.y = M.m10 * v.x + M.m11 * v.y + M.m12 * v.z;
+	result.z = M.m20 * v.x + M.m21 * v.y + M.m22 * v.z;
+	return result;
+}
+
+/** Look up the scene point at a subpixel position of the ICP maps, in
+    world coordinates. The w component is negative if any of the
+    neighbouring pixels is a hole. @p sceneIntrinsics and @p scenePose
+    describe the camera the maps were rendered from, which the compact
+    maps are relative to.
+*/
+_CPU_AND_GPU_CODE_ inline Vector4f interpolateICPPoint(const CONSTPTR(Vector4f) *pointsMap, const THREADPTR(Vector2f) & position,
+	const CONSTPTR(Vector2i) & imgSize, const CONSTPTR(Vector4f) & sceneIntrinsics, const CONSTPTR(Matrix4f) & scenePose)
+{
+	return interpolateBilinear_withHoles(pointsMap, position, imgSize);
+}
+
+_CPU_AND_GPU_CODE_ inline Vector4f interpolateICPPoint(const CONSTPTR(float) *depthMap, const THREADPTR(Vector2f) & position,
+	const CONSTPTR(Vector2i) & imgSize, const CONSTPTR(Vector4f) & sceneIntrinsics, const CONSTPTR(Matrix4f) & scenePose)
+{
+	Vector4f result;
+	Vector2i p; Vector2f delta;
+
+	p.x = (int)floor(position.x); p.y = (int)floor(position.y);
+	delta.x = position.x - (float)p.x; delta.y = position.y - (float)p.y;
+
+	float z_a = depthMap[p.x + p.y * imgSize.x];
+	float z_b = depthMap[(p.x + 1) + p.y * imgSize.x];
+	float z_c = depthMap[p.x + (p.y + 1) * imgSize.x];
+	float z_d = depthMap[(p.x + 1) + (p.y + 1) * imgSize.x];
+
+	if (z_a <= 0.0f || z_b <= 0.0f || z_c <= 0.0f || z_d <= 0.0f)
+	{
+		result.x = 0; result.y = 0; result.z = 0; result.w = -1.0f;
+		return result;
+	}
+
+	// weighted depths of the left / right and top / bottom neighbours
+	float z_left = z_a * (1.0f - delta.x) * (1.0f - delta.y) + z_c * (1.0f - delta.x) * delta.y;
+	float z_right = z_b * delta.x * (1.0f - delta.y) + z_d * delta.x * delta.y;
+	float z_top = z_a * (1.0f - delta.x) * (1.0f - delta.y) + z_b * delta.x * (1.0f - delta.y);
+	float z_bottom = z_c * (1.0f - delta.x) * delta.y + z_d * delta.x * delta.y;
+
+	// unproject the four neighbours along their pixel rays and blend
+	float invFx = 1.0f / sceneIntrinsics.x, invFy = 1.0f / sceneIntrinsics.y;
+	Vector3f pt_camera;
+	pt_camera.x = (z_left * ((float)p.x - sceneIntrinsics.z) + z_right * ((float)(p.x + 1) - sceneIntrinsics.z)) * invFx;
+	pt_camera.y = (z_top * ((float)p.y - sceneIntrinsics.w) + z_bottom * ((float)(p.y + 1) - sceneIntrinsics.w)) * invFy;
+	pt_camera.z = z_left + z_right;
+
+	pt_camera.x -= scenePose.m30; pt_camera.y -= scenePose.m31; pt_camera.z -= scenePose.m32;
+
+	Vector3f pt_world = invRotate(scenePose, pt_camera);
+	result.x = pt_world.x; result.y = pt_world.y; result.z = pt_world.z; result.w = 1.0f;
+
+	return result;
+}
+
+/** Look up the scene normal at a subpixel position of the ICP maps, in
+    world coordinates. Only meaningful where interpolateICPPoint found no
+    holes.
+*/
+_CPU_AND_GPU_CODE_ inline Vector4f interpolateICPNormal(const CONSTPTR(Vector4f) *normalsMap, const THREADPTR(Vector2f) & position,
+	const CONSTPTR(Vector2i) & imgSize, const CONSTPTR(Matrix4f) & scenePose)
+{
+	return interpolateBilinear_withHoles(normalsMap, position, imgSize);
+}
+
+_CPU_AND_GPU_CODE_ inline Vector4f interpolateICPNormal(const CONSTPTR(Vector2s_) *normalsMap, const THREADPTR(Vector2f) & position,
+	const CONSTPTR(Vector2i) & imgSize, const CONSTPTR(Matrix4f) & scenePose)
+{
+	Vector4f result;
+	Vector2i p; Vector2f delta;
+
+	p.x = (int)floor(position.x); p.y = (int)floor(position.y);
+	delta.x = position.x - (float)p.x; delta.y = position.y - (float)p.y;
+
+	Vector3f a = decodeOctahedralNormal(normalsMap[p.x + p.y * imgSize.x]);
+	Vector3f b = decodeOctahedralNormal(normalsMap[(p.x + 1) + p.y * imgSize.x]);
+	Vector3f c = decodeOctahedralNormal(normalsMap[p.x + (p.y + 1) * imgSize.x]);
+	Vector3f d = decodeOctahedralNormal(normalsMap[(p.x + 1) + (p.y + 1) * imgSize.x]);
+
+	// neighbouring normals are similar, so normalising once after blending is enough
+	Vector3f n_camera = a * ((1.0f - delta.x) * (1.0f - delta.y)) + b * (delta.x * (1.0f - delta.y)) +
+		c * ((1.0f - delta.x) * delta.y) + d * (delta.x * delta.y);
+
+	float norm = sqrtf(n_camera.x * n_camera.x + n_camera.y * n_camera.y + n_camera.z * n_camera.z);
+	if (norm > 0.0f) n_camera *= 1.0f / norm;
+	n_camera.z = -n_camera.z;
+
+	Vector3f n_world = invRotate(scenePose, n_camera);
+	result.x = n_world.x; result.y = n_world.y; result.z = n_world.z; result.w = 0.0f;
+
+	return result;
+}
@@ -4,13 +4,14 @@
 
 #include "../../Utils/ITMLibDefines.h"
 #include "ITMPixelUtils.h"
+#include "ITMCompactICPMaps.h"
 
-template<bool shortIteration, bool rotationOnly>
+template<bool shortIteration, bool rotationOnly, class TPoint, class TNormal>
 _CPU_AND_GPU_CODE_ inline bool computePerPointGH_Depth_Ab(THREADPTR(float) *A, THREADPTR(float) &b,
 	const THREADPTR(int) & x, const THREADPTR(int) & y,
 	const CONSTPTR(float) &depth, const CONSTPTR(Vector2i) & viewImageSize, const CONSTPTR(Vector4f) & viewIntrinsics, const CONSTPTR(Vector2i) & sceneImageSize,
-	const CONSTPTR(Vector4f) & sceneIntrinsics, const CONSTPTR(Matrix4f) & approxInvPose, const CONSTPTR(Matrix4f) & scenePose, const CONSTPTR(Vector4f) *pointsMap,
-	const CONSTPTR(Vector4f) *normalsMap, float distThresh)
+	const CONSTPTR(Vector4f) & sceneIntrinsics, const CONSTPTR(Matrix4f) & approxInvPose, const CONSTPTR(Matrix4f) & scenePose, const CONSTPTR(TPoint) *pointsMap,
+	const CONSTPTR(TNormal) *normalsMap, float distThresh)
 {
 	if (depth <= 1e-8f) return false; //check if valid -- != 0.0f
 
@@ -35,7 +36,7 @@ _CPU_AND_GPU_CODE_ inline bool computePerPointGH_Depth_Ab(THREADPTR(float) *A, T
 	if (!((tmp2Dpoint.x >= 0.0f) && (tmp2Dpoint.x <= sceneImageSize.x - 2) && (tmp2Dpoint.y >= 0.0f) && (tmp2Dpoint.y <= sceneImageSize.y - 2)))
 		return false;
 
-	curr3Dpoint = interpolateBilinear_withHoles(pointsMap, tmp2Dpoint, sceneImageSize);
+	curr3Dpoint = interpolateICPPoint(pointsMap, tmp2Dpoint, sceneImageSize, sceneIntrinsics, scenePose);
 	if (curr3Dpoint.w < 0.0f) return false;
 
 	ptDiff.x = curr3Dpoint.x - tmp3Dpoint.x;
@@ -45,7 +46,7 @@ _CPU_AND_GPU_CODE_ inline bool computePerPointGH_Depth_Ab(THREADPTR(float) *A, T
 
 	if (dist > distThresh) return false;
 
-	corr3Dnormal = interpolateBilinear_withHoles(normalsMap, tmp2Dpoint, sceneImageSize);
+	corr3Dnormal = interpolateICPNormal(normalsMap, tmp2Dpoint, sceneImageSize, scenePose);
 //	if (corr3Dnormal.w < 0.0f) return false;
 
 	b = corr3Dnormal.x * ptDiff.x + corr3Dnormal.y * ptDiff.y + corr3Dnormal.z * ptDiff.z;
@@ -72,12 +73,12 @@ _CPU_AND_GPU_CODE_ inline bool computePerPointGH_Depth_Ab(THREADPTR(float) *A, T
 	return true;
 }
 
-template<bool shortIteration, bool rotationOnly>
+template<bool shortIteration, bool rotationOnly, class TPoint, class TNormal>
 _CPU_AND_GPU_CODE_ inline bool computePerPointGH_Depth(THREADPTR(float) *localNabla, THREADPTR(float) *localHessian, THREADPTR(float) &localF,
 	const THREADPTR(int) & x, const THREADPTR(int) & y,
 	const CONSTPTR(float) &depth, const CONSTPTR(Vector2i) & viewImageSize, const CONSTPTR(Vector4f) & viewIntrinsics, const CONSTPTR(Vector2i) & sceneImageSize,
-	const CONSTPTR(Vector4f) & sceneIntrinsics, const CONSTPTR(Matrix4f) & approxInvPose, const CONSTPTR(Matrix4f) & scenePose, const CONSTPTR(Vector4f) *pointsMap,
-	const CONSTPTR(Vector4f) *normalsMap, float distThresh)
+	const CONSTPTR(Vector4f) & sceneIntrinsics, const CONSTPTR(Matrix4f) & approxInvPose, const CONSTPTR(Matrix4f) & scenePose, const CONSTPTR(TPoint) *pointsMap,
+	const CONSTPTR(TNormal) *normalsMap, float distThresh)
 {
 	const int noPara = shortIteration ? 3 : 6;
 	float A[noPara];
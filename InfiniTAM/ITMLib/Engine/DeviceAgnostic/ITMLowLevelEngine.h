@@ -121,3 +121,40 @@ _CPU_AND_GPU_CODE_ inline void gradientY(DEVICEPTR(Vector4s) *grad, int x, int y
 
 	grad[x + y * imgSize.x] = d_out;
 }
+
+_CPU_AND_GPU_CODE_ inline void convertColourToIntensity(DEVICEPTR(uchar) *imageData_out, int x, int y, Vector2i imgSize,
+	const CONSTPTR(Vector4u) *imageData_in)
+{
+	int locId = x + y * imgSize.x;
+	Vector4u pixel_in = imageData_in[locId];
+
+	imageData_out[locId] = (uchar)(0.299f * pixel_in.x + 0.587f * pixel_in.y + 0.114f * pixel_in.z + 0.5f);
+}
+
+_CPU_AND_GPU_CODE_ inline void filterSubsample(DEVICEPTR(uchar) *imageData_out, int x, int y, Vector2i newDims,
+	const CONSTPTR(uchar) *imageData_in, Vector2i oldDims)
+{
+	int src_pos_x = x * 2, src_pos_y = y * 2;
+
+	int pixel_out = imageData_in[(src_pos_x + 0) + (src_pos_y + 0) * oldDims.x] + imageData_in[(src_pos_x + 1) + (src_pos_y + 0) * oldDims.x] +
+		imageData_in[(src_pos_x + 0) + (src_pos_y + 1) * oldDims.x] + imageData_in[(src_pos_x + 1) + (src_pos_y + 1) * oldDims.x];
+
+	imageData_out[x + y * newDims.x] = (uchar)(pixel_out / 4);
+}
+
+_CPU_AND_GPU_CODE_ inline void gradient(DEVICEPTR(Vector2s_) *grad, int x, int y, const CONSTPTR(uchar) *image, Vector2i imgSize)
+{
+	const CONSTPTR(uchar) *row_above = image + (y - 1) * imgSize.x;
+	const CONSTPTR(uchar) *row = image + y * imgSize.x;
+	const CONSTPTR(uchar) *row_below = image + (y + 1) * imgSize.x;
+
+	// same Sobel kernels and scaling as gradientX and gradientY
+	int d_x = (row_above[x + 1] - row_above[x - 1]) + 2 * (row[x + 1] - row[x - 1]) + (row_below[x + 1] - row_below[x - 1]);
+	int d_y = (row_below[x - 1] - row_above[x - 1]) + 2 * (row_below[x] - row_above[x]) + (row_below[x + 1] - row_above[x + 1]);
+
+	Vector2s d_out;
+	d_out.x = (short)(d_x / 8);
+	d_out.y = (short)(d_y / 8);
+
+	grad[x + y * imgSize.x] = d_out;
+}
@@ -0,0 +1,101 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include "../../Utils/ITMLibDefines.h"
+
+#define NORMAL_BINS_PER_AXIS 8
+#define NORMAL_BINS_TOTAL (NORMAL_BINS_PER_AXIS * NORMAL_BINS_PER_AXIS)
+#define GRADIENT_HISTOGRAM_BINS 256
+
+_CPU_AND_GPU_CODE_ inline int computeNormalBin(const THREADPTR(Vector3f) & d_x, const THREADPTR(Vector3f) & d_y)
+{
+	Vector3f normal = cross(d_x, d_y);
+
+	float norm = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+	if (norm < 1e-12f) return -1;
+
+	normal *= 1.0f / norm;
+
+	// a normal and its negation give the same point-to-plane constraint
+	if (normal.z > 0.0f) { normal.x = -normal.x; normal.y = -normal.y; }
+
+	int bin_x = (int)((normal.x + 1.0f) * 0.5f * NORMAL_BINS_PER_AXIS);
+	int bin_y = (int)((normal.y + 1.0f) * 0.5f * NORMAL_BINS_PER_AXIS);
+
+	bin_x = CLAMP(bin_x, 0, NORMAL_BINS_PER_AXIS - 1);
+	bin_y = CLAMP(bin_y, 0, NORMAL_BINS_PER_AXIS - 1);
+
+	return bin_x + bin_y * NORMAL_BINS_PER_AXIS;
+}
+
+_CPU_AND_GPU_CODE_ inline int computeNormalBin_Depth(int x, int y, const CONSTPTR(float) *depth, const CONSTPTR(Vector2i) & imgSize,
+	const CONSTPTR(Vector4f) & intrinsics)
+{
+	if (x >= imgSize.x - 1 || y >= imgSize.y - 1) return -1;
+
+	int locId = x + y * imgSize.x;
+	float z = depth[locId], z_x = depth[locId + 1], z_y = depth[locId + imgSize.x];
+
+	if (z <= 0.0f || z_x <= 0.0f || z_y <= 0.0f) return -1;
+
+	Vector3f pt, pt_x, pt_y;
+
+	pt.x = z * ((float)x - intrinsics.z) / intrinsics.x;
+	pt.y = z * ((float)y - intrinsics.w) / intrinsics.y;
+	pt.z = z;
+
+	pt_x.x = z_x * ((float)(x + 1) - intrinsics.z) / intrinsics.x;
+	pt_x.y = z_x * ((float)y - intrinsics.w) / intrinsics.y;
+	pt_x.z = z_x;
+
+	pt_y.x = z_y * ((float)x - intrinsics.z) / intrinsics.x;
+	pt_y.y = z_y * ((float)(y + 1) - intrinsics.w) / intrinsics.y;
+	pt_y.z = z_y;
+
+	return computeNormalBin(pt_x - pt, pt_y - pt);
+}
+
+_CPU_AND_GPU_CODE_ inline int computeNormalBin_Points(int x, int y, const CONSTPTR(Vector4f) *points, const CONSTPTR(Vector2i) & imgSize)
+{
+	if (x >= imgSize.x - 1 || y >= imgSize.y - 1) return -1;
+
+	int locId = x + y * imgSize.x;
+	Vector4f pt = points[locId], pt_x = points[locId + 1], pt_y = points[locId + imgSize.x];
+
+	if (pt.w < 0.0f || pt_x.w < 0.0f || pt_y.w < 0.0f) return -1;
+
+	return computeNormalBin(pt_x.toVector3() - pt.toVector3(), pt_y.toVector3() - pt.toVector3());
+}
+
+_CPU_AND_GPU_CODE_ inline float computePointGradientMagnitude(const CONSTPTR(Vector4f) & pt_model, const CONSTPTR(Matrix4f) & M, const CONSTPTR(Vector4f) & projParams,
+	const CONSTPTR(Vector4s) *gx, const CONSTPTR(Vector4s) *gy, const CONSTPTR(Vector2i) & imgSize)
+{
+	Vector4f pt_camera = M * pt_model;
+	if (pt_camera.z <= 0) return -1.0f;
+
+	int x = (int)(projParams.x * pt_camera.x / pt_camera.z + projParams.z + 0.5f);
+	int y = (int)(projParams.y * pt_camera.y / pt_camera.z + projParams.w + 0.5f);
+
+	if (x < 1 || x > imgSize.x - 2 || y < 1 || y > imgSize.y - 2) return -1.0f;
+
+	Vector4s gx_obs = gx[x + y * imgSize.x], gy_obs = gy[x + y * imgSize.x];
+
+	return (float)(abs(gx_obs.x) + abs(gx_obs.y) + abs(gx_obs.z) + abs(gy_obs.x) + abs(gy_obs.y) + abs(gy_obs.z));
+}
+
+_CPU_AND_GPU_CODE_ inline float computePointGradientMagnitude(const CONSTPTR(Vector4f) & pt_model, const CONSTPTR(Matrix4f) & M, const CONSTPTR(Vector4f) & projParams,
+	const CONSTPTR(Vector2s_) *gradients, const CONSTPTR(Vector2i) & imgSize)
+{
+	Vector4f pt_camera = M * pt_model;
+	if (pt_camera.z <= 0) return -1.0f;
+
+	int x = (int)(projParams.x * pt_camera.x / pt_camera.z + projParams.z + 0.5f);
+	int y = (int)(projParams.y * pt_camera.y / pt_camera.z + projParams.w + 0.5f);
+
+	if (x < 1 || x > imgSize.x - 2 || y < 1 || y > imgSize.y - 2) return -1.0f;
+
+	Vector2s g_obs = gradients[x + y * imgSize.x];
+
+	return (float)(abs(g_obs.x) + abs(g_obs.y));
+}
@@ -46,22 +46,24 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeDDT(const CONSTPTR(Vector3f) &pt_f, co
 	Vector3i pt = TO_INT_ROUND3(pt_f);
 
 	bool isFound; float dt1, dt2;
+	VoxelStencil<TVoxel, typename TIndex::IndexData> stencil(voxelBlocks, index, pt);
+	typename TIndex::IndexCache cache;
 
-	dt1 = TVoxel::SDF_valueToFloat(readVoxel(voxelBlocks, index, pt + Vector3i(1, 0, 0), isFound).sdf);
+	dt1 = TVoxel::SDF_valueToFloat(stencil.read(Vector3i(1, 0, 0), isFound, cache).sdf);
 	if (!isFound || dt1 == 1.0f) { ddtFound = false; return Vector3f(0.0f); }
-	dt2 = TVoxel::SDF_valueToFloat(readVoxel(voxelBlocks, index, pt + Vector3i(-1, 0, 0), isFound).sdf);
+	dt2 = TVoxel::SDF_valueToFloat(stencil.read(Vector3i(-1, 0, 0), isFound, cache).sdf);
 	if (!isFound || dt2 == 1.0f) { ddtFound = false; return Vector3f(0.0f); }
 	ddt.x = (dt1 - dt2) * 0.5f;
 
-	dt1 = TVoxel::SDF_valueToFloat(readVoxel(voxelBlocks, index, pt + Vector3i(0, 1, 0), isFound).sdf);
+	dt1 = TVoxel::SDF_valueToFloat(stencil.read(Vector3i(0, 1, 0), isFound, cache).sdf);
 	if (!isFound || dt1 == 1.0f) { ddtFound = false; return Vector3f(0.0f); }
-	dt2 = TVoxel::SDF_valueToFloat(readVoxel(voxelBlocks, index, pt + Vector3i(0, -1, 0), isFound).sdf);
+	dt2 = TVoxel::SDF_valueToFloat(stencil.read(Vector3i(0, -1, 0), isFound, cache).sdf);
 	if (!isFound || dt2 == 1.0f) { ddtFound = false; return Vector3f(0.0f); }
 	ddt.y = (dt1 - dt2) * 0.5f;
 
-	dt1 = TVoxel::SDF_valueToFloat(readVoxel(voxelBlocks, index, pt + Vector3i(0, 0, 1), isFound).sdf);
+	dt1 = TVoxel::SDF_valueToFloat(stencil.read(Vector3i(0, 0, 1), isFound, cache).sdf);
 	if (!isFound || dt1 == 1.0f) { ddtFound = false; return Vector3f(0.0f); }
-	dt2 = TVoxel::SDF_valueToFloat(readVoxel(voxelBlocks, index, pt + Vector3i(0, 0, -1), isFound).sdf);
+	dt2 = TVoxel::SDF_valueToFloat(stencil.read(Vector3i(0, 0, -1), isFound, cache).sdf);
 	if (!isFound || dt2 == 1.0f) { ddtFound = false; return Vector3f(0.0f); }
 	ddt.z = (dt1 - dt2) * 0.5f;
 
@@ -101,9 +103,10 @@ _CPU_AND_GPU_CODE_ inline bool computePerPixelJacobian(THREADPTR(float) *jacobia
 
 	jacobian[0] = dDt.x; jacobian[1] = dDt.y; jacobian[2] = dDt.z;
 
-	jacobian[3] = 4.0f * (dDt.z * cPt.y - dDt.y * cPt.z);
-	jacobian[4] = 4.0f * (dDt.x * cPt.z - dDt.z * cPt.x);
-	jacobian[5] = 4.0f * (dDt.y * cPt.x - dDt.x * cPt.y);
+	// derivatives w.r.t. the rotation part of the twist in the ITMPose tangent space
+	jacobian[3] = dDt.z * cPt.y - dDt.y * cPt.z;
+	jacobian[4] = dDt.x * cPt.z - dDt.z * cPt.x;
+	jacobian[5] = dDt.y * cPt.x - dDt.x * cPt.y;
 
 	return true;
 }
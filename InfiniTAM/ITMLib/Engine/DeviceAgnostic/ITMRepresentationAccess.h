@@ -5,8 +5,46 @@
 #include "../../Utils/ITMLibDefines.h"
 #include "ITMPixelUtils.h"
 
-template<typename T> _CPU_AND_GPU_CODE_ inline int hashIndex(const THREADPTR(T) & blockPos) {
-	return (((uint)blockPos.x * 73856093u) ^ ((uint)blockPos.y * 19349669u) ^ ((uint)blockPos.z * 83492791u)) & (uint)SDF_HASH_MASK;
+#if !defined(__CUDACC__) && !defined(__METALC__)
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define PREFETCH_READ(ptr) _mm_prefetch((const char*)(ptr), _MM_HINT_T0)
+#else
+#define PREFETCH_READ(ptr) __builtin_prefetch(ptr)
+#endif
+#endif
+
+/// Number of ordered entries of a hash table, kept in the header entry in front of it
+_CPU_AND_GPU_CODE_ inline int getNoOrderedEntries(const CONSTPTR(ITMHashEntry) *hashTable) { return hashTable[-1].offset; }
+
+/// Number of ordered entries per bucket of a hash table, kept in the header entry in front of it
+_CPU_AND_GPU_CODE_ inline int getNoEntriesPerBucket(const CONSTPTR(ITMHashEntry) *hashTable) { return hashTable[-1].pos.z; }
+
+/** Index of the first entry of the bucket of a block, in a table with
+    @p noOrderedEntries ordered entries in buckets of
+    @p noEntriesPerBucket. Both are 2^n, so scaling the hash before
+    masking picks bucket (hash mod number of buckets).
+*/
+template<typename T> _CPU_AND_GPU_CODE_ inline int hashIndex(const THREADPTR(T) & blockPos, int noOrderedEntries, int noEntriesPerBucket) {
+	return (int)(((((uint)blockPos.x * 73856093u) ^ ((uint)blockPos.y * 19349669u) ^ ((uint)blockPos.z * 83492791u)) * (uint)noEntriesPerBucket)
+		& (uint)(noOrderedEntries - 1));
+}
+
+/** Index of the voxel at position (@p x, @p y, @p z) inside its block
+    in the voxel data of the block. The bricked and Morton layouts keep
+    each 2x2x2 interpolation cell within 64 bytes for voxels of up to 8
+    bytes, where the linear layout spreads it over up to 4 cache lines.
+*/
+_CPU_AND_GPU_CODE_ inline int voxelIndexInBlock(int x, int y, int z) {
+#if SDF_VOXEL_LAYOUT == SDF_VOXEL_LAYOUT_BRICKED
+	return (((x >> 1) + (y >> 1) * (SDF_BLOCK_SIZE / 2) + (z >> 1) * (SDF_BLOCK_SIZE * SDF_BLOCK_SIZE / 4)) << 3) | (x & 1) | ((y & 1) << 1) | ((z & 1) << 2);
+#elif SDF_VOXEL_LAYOUT == SDF_VOXEL_LAYOUT_MORTON
+	return (x & 1) | ((y & 1) << 1) | ((z & 1) << 2) | ((x & 2) << 2) | ((y & 2) << 3) | ((z & 2) << 4) | ((x & 4) << 4) | ((y & 4) << 5) | ((z & 4) << 6);
+#else
+	return x + y * SDF_BLOCK_SIZE + z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+#endif
 }
 
 _CPU_AND_GPU_CODE_ inline int pointToVoxelBlockPos(const THREADPTR(Vector3i) & point, THREADPTR(Vector3i) &blockPos) {
@@ -14,44 +52,133 @@ _CPU_AND_GPU_CODE_ inline int pointToVoxelBlockPos(const THREADPTR(Vector3i) & p
 	blockPos.y = ((point.y < 0) ? point.y - SDF_BLOCK_SIZE + 1 : point.y) / SDF_BLOCK_SIZE;
 	blockPos.z = ((point.z < 0) ? point.z - SDF_BLOCK_SIZE + 1 : point.z) / SDF_BLOCK_SIZE;
 
-	//Vector3i locPos = point - blockPos * SDF_BLOCK_SIZE;
-	//return locPos.x + locPos.y * SDF_BLOCK_SIZE + locPos.z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
-	return point.x + (point.y - blockPos.x) * SDF_BLOCK_SIZE + (point.z - blockPos.y) * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE - blockPos.z * SDF_BLOCK_SIZE3;
+	return voxelIndexInBlock(point.x - blockPos.x * SDF_BLOCK_SIZE, point.y - blockPos.y * SDF_BLOCK_SIZE, point.z - blockPos.z * SDF_BLOCK_SIZE);
 }
 
-_CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexData) *voxelIndex, const THREADPTR(Vector3i) & point,
-	THREADPTR(bool) &isFound, THREADPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexCache) & cache)
+/// Position of the super-block containing a block, on the given level of the block occupancy hierarchy
+_CPU_AND_GPU_CODE_ inline Vector3i blockToSuperBlockPos(const THREADPTR(Vector3i) & blockPos, int levelId) {
+	int shift = SDF_SUPERBLOCK_SHIFT * (levelId + 1);
+	return Vector3i(blockPos.x >> shift, blockPos.y >> shift, blockPos.z >> shift);
+}
+
+/// Index of the occupancy counter of a super-block. Super-blocks sharing a counter can only look occupied when they are not.
+_CPU_AND_GPU_CODE_ inline int occupancyIndex(const THREADPTR(Vector3i) & superBlockPos, int levelId) {
+	return ((((uint)superBlockPos.x * 73856093u) ^ ((uint)superBlockPos.y * 19349669u) ^ ((uint)superBlockPos.z * 83492791u)) & (uint)SDF_OCCUPANCY_MASK)
+		+ levelId * SDF_OCCUPANCY_NUM;
+}
+
+/// Add (delta 1) or remove (delta -1) an allocated block on all levels of the block occupancy hierarchy. Not atomic.
+_CPU_AND_GPU_CODE_ inline void updateBlockOccupancy(DEVICEPTR(int) *blockOccupancy, const THREADPTR(Vector3s) & blockPos, int delta) {
+	Vector3i pos(blockPos.x, blockPos.y, blockPos.z);
+	for (int levelId = 0; levelId < SDF_SUPERBLOCK_LEVELS; levelId++) blockOccupancy[occupancyIndex(blockToSuperBlockPos(pos, levelId), levelId)] += delta;
+}
+
+#if !defined(__CUDACC__) && !defined(__METALC__)
+/** Word offset of the line of a block in a block filter of
+    2^@p lineShift lines, and the three bits the block sets in that
+    line. The filter is a blocked Bloom filter, so a block is tested
+    within a single line.
+*/
+template<typename T> inline int blockFilterBits(const T & blockPos, int lineShift, int *bitIds) {
+	uint h = ((uint)blockPos.x * 73856093u) ^ ((uint)blockPos.y * 19349669u) ^ ((uint)blockPos.z * 83492791u);
+	h ^= h >> 16; h *= 0x85ebca6bu; h ^= h >> 13; h *= 0xc2b2ae35u; h ^= h >> 16;
+
+	// the line takes the low bits of h, the bits in the line come from the high bits of a second product
+	uint g = h * 0x9e3779b9u;
+	bitIds[0] = g >> 23; bitIds[1] = (g >> 14) & 511; bitIds[2] = (g >> 5) & 511;
+
+	return (int)(h & ((1u << lineShift) - 1u)) * SDF_FILTER_LINE_WORDS;
+}
+
+/// Block filter stored behind the excess list of a hash table in host memory, or NULL if the table has none
+inline uint *getBlockFilter(const ITMHashEntry *hashTable) {
+	const ITMHashEntry &header = hashTable[-1];
+	return (header.pos.y != 0) ? (uint*)(hashTable + header.offset + header.ptr) : NULL;
+}
+
+/// Record an allocated block in the block filter of a hash table, if it has one. Not atomic.
+template<typename T> inline void markBlockInFilter(ITMHashEntry *hashTable, const T & blockPos) {
+	uint *blockFilter = getBlockFilter(hashTable);
+	if (blockFilter == NULL) return;
+
+	int bitIds[3];
+	uint *line = blockFilter + blockFilterBits(blockPos, hashTable[-1].pos.x, bitIds);
+	for (int i = 0; i < 3; i++) line[bitIds[i] >> 5] |= 1u << (bitIds[i] & 31);
+}
+
+/// False if the block is definitely not allocated, true if it may be or the hash table has no block filter
+template<typename T> inline bool mayContainBlock(const ITMHashEntry *hashTable, const T & blockPos) {
+	const uint *blockFilter = getBlockFilter(hashTable);
+	if (blockFilter == NULL) return true;
+
+	int bitIds[3];
+	const uint *line = blockFilter + blockFilterBits(blockPos, hashTable[-1].pos.x, bitIds);
+	for (int i = 0; i < 3; i++) if (!(line[bitIds[i] >> 5] & (1u << (bitIds[i] & 31)))) return false;
+	return true;
+}
+#endif
+
+/** Index of the entry of a block that is in use, i.e. allocated or
+    swapped out, or -1 if there is none. The entries of the bucket of
+    the block are compared first, then the excess list entries chained
+    to the last entry of the bucket. The block filter only covers
+    allocated blocks, so it cannot rule out swapped out ones here.
+*/
+_CPU_AND_GPU_CODE_ inline int findHashEntry(const CONSTPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexData) *voxelIndex, const THREADPTR(Vector3i) & blockPos)
 {
-	Vector3i blockPos;
-	short linearIdx = pointToVoxelBlockPos(point, blockPos);
+	int noOrderedEntries = getNoOrderedEntries(voxelIndex), noEntriesPerBucket = getNoEntriesPerBucket(voxelIndex);
+	int hashIdx = hashIndex(blockPos, noOrderedEntries, noEntriesPerBucket);
 
-	if IS_EQUAL3(blockPos, cache.blockPos)
+	for (int i = 0; i < noEntriesPerBucket; i++, hashIdx++)
 	{
-		isFound = true;
-		return cache.blockPtr + linearIdx;
+		ITMHashEntry hashEntry = voxelIndex[hashIdx];
+		if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= -1) return hashIdx;
 	}
 
-	int hashIdx = hashIndex(blockPos);
-
-	while (true) 
+	int offset = voxelIndex[hashIdx - 1].offset;
+	while (offset >= 1)
 	{
-		ITMHashEntry hashEntry = voxelIndex[hashIdx];
+		hashIdx = noOrderedEntries + offset - 1;
 
-		if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= 0)
-		{
-			isFound = true;
-			cache.blockPos = blockPos; cache.blockPtr = hashEntry.ptr * SDF_BLOCK_SIZE3;
-			return cache.blockPtr + linearIdx;
-		}
+		ITMHashEntry hashEntry = voxelIndex[hashIdx];
+		if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= -1) return hashIdx;
 
-		if (hashEntry.offset < 1) break;
-		hashIdx = SDF_BUCKET_NUM + hashEntry.offset - 1;
+		offset = hashEntry.offset;
 	}
 
-	isFound = false;
 	return -1;
 }
 
+/// Offset of an allocated block in the voxel data, or -1, trying the cache and on the host the block filter first
+_CPU_AND_GPU_CODE_ inline int findVoxelBlock(const CONSTPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexData) *voxelIndex, const THREADPTR(Vector3i) & blockPos,
+	THREADPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexCache) & cache)
+{
+	if IS_EQUAL3(blockPos, cache.blockPos) return cache.blockPtr;
+
+#if !defined(__CUDACC__) && !defined(__METALC__)
+	// only the host side engines maintain the block filter
+	if (!mayContainBlock(voxelIndex, blockPos)) return -1;
+#endif
+
+	int hashIdx = findHashEntry(voxelIndex, blockPos);
+	if (hashIdx < 0 || voxelIndex[hashIdx].ptr < 0) return -1;
+
+	cache.blockPos = blockPos; cache.blockPtr = voxelIndex[hashIdx].ptr * SDF_BLOCK_SIZE3;
+	return cache.blockPtr;
+}
+
+_CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexData) *voxelIndex, const THREADPTR(Vector3i) & point,
+	THREADPTR(bool) &isFound, THREADPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexCache) & cache)
+{
+	Vector3i blockPos;
+	short linearIdx = pointToVoxelBlockPos(point, blockPos);
+
+	int blockPtr = findVoxelBlock(voxelIndex, blockPos, cache);
+
+	isFound = blockPtr >= 0;
+	return isFound ? blockPtr + linearIdx : -1;
+}
+
 _CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexData) *voxelIndex, Vector3i point, THREADPTR(bool) &isFound)
 {
 	ITMLib::Objects::ITMVoxelBlockHash::IndexCache cache;
@@ -82,40 +209,157 @@ _CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::Objects::ITMPlain
 	return findVoxel(voxelIndex, point_orig, isFound);
 }
 
-template<class TVoxel>
-_CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexData) *voxelIndex,
-	const THREADPTR(Vector3i) & point, THREADPTR(bool) &isFound, THREADPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexCache) & cache)
+#if !defined(__CUDACC__) && !defined(__METALC__)
+/// Number of lookups findVoxelBlocks keeps in flight
+#define HASH_LOOKUP_BATCH_SIZE 32
+
+/** \brief
+    Looks up @p noBlocks independent block positions on the CPU and
+    stores the offset of each block in the voxel data, or -1 if it is not
+    allocated, in @p blockPtrs. Positions that the block filter rules
+    out never touch the hash table. The hash buckets of a whole batch of
+    positions are prefetched before the first of them is compared, and
+    the chains into the excess list are then followed one entry per
+    round for all lookups of the batch, again prefetching all the
+    entries of a round first. The cache misses of the lookups thus
+    overlap instead of following one another.
+*/
+inline void findVoxelBlocks(int *blockPtrs, const ITMLib::Objects::ITMVoxelBlockHash::IndexData *voxelIndex, const Vector3i *blockPos, int noBlocks)
 {
-//	int voxelAddress = findVoxel(voxelIndex, point, isFound, cache);
-//	return isFound ? voxelData[voxelAddress] : TVoxel();
-	Vector3i blockPos;
-	int linearIdx = pointToVoxelBlockPos(point, blockPos);
+	int hashIdx[HASH_LOOKUP_BATCH_SIZE], pendingIds[HASH_LOOKUP_BATCH_SIZE];
+	int noOrderedEntries = getNoOrderedEntries(voxelIndex), noEntriesPerBucket = getNoEntriesPerBucket(voxelIndex);
 
-	if IS_EQUAL3(blockPos, cache.blockPos)
+	for (int batchStart = 0; batchStart < noBlocks; batchStart += HASH_LOOKUP_BATCH_SIZE)
 	{
-		isFound = true;
-		return voxelData[cache.blockPtr + linearIdx];
-	}
+		const Vector3i *batchPos = blockPos + batchStart;
+		int *batchPtrs = blockPtrs + batchStart;
+		int noInBatch = MIN(noBlocks - batchStart, HASH_LOOKUP_BATCH_SIZE), noPending = 0;
 
-	int hashIdx = hashIndex(blockPos);
+		for (int i = 0; i < noInBatch; i++)
+		{
+			if (!mayContainBlock(voxelIndex, batchPos[i])) { batchPtrs[i] = -1; continue; }
 
-	while (true) 
-	{
-		ITMHashEntry hashEntry = voxelIndex[hashIdx];
+			hashIdx[i] = hashIndex(batchPos[i], noOrderedEntries, noEntriesPerBucket);
+			PREFETCH_READ(voxelIndex + hashIdx[i]);
+			pendingIds[noPending++] = i;
+		}
 
-		if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= 0)
+		// the first round compares whole buckets, the following ones single excess list entries
+		for (int noCompared = noEntriesPerBucket; noPending > 0; noCompared = 1)
 		{
-			isFound = true;
-			cache.blockPos = blockPos; cache.blockPtr = hashEntry.ptr * SDF_BLOCK_SIZE3;
-			return voxelData[cache.blockPtr + linearIdx];
+			int noStillPending = 0;
+			for (int k = 0; k < noPending; k++)
+			{
+				int i = pendingIds[k], entryId = 0;
+				const ITMHashEntry *entries = voxelIndex + hashIdx[i];
+
+				while (entryId < noCompared && !(IS_EQUAL3(entries[entryId].pos, batchPos[i]) && entries[entryId].ptr >= -1)) entryId++;
+
+				if (entryId < noCompared)
+				{
+					batchPtrs[i] = (entries[entryId].ptr >= 0) ? entries[entryId].ptr * SDF_BLOCK_SIZE3 : -1;
+					continue;
+				}
+
+				int offset = entries[noCompared - 1].offset;
+				if (offset < 1) { batchPtrs[i] = -1; continue; }
+
+				hashIdx[i] = noOrderedEntries + offset - 1;
+				PREFETCH_READ(voxelIndex + hashIdx[i]);
+				pendingIds[noStillPending++] = i;
+			}
+			noPending = noStillPending;
 		}
-
-		if (hashEntry.offset < 1) break;
-		hashIdx = SDF_BUCKET_NUM + hashEntry.offset - 1;
 	}
+}
 
-	isFound = false;
-	return TVoxel();
+/// Rebuild the block filter from the allocated entries of the hash table, dropping blocks that have been removed since
+inline void rebuildBlockFilter(ITMLib::Objects::ITMVoxelBlockHash *index)
+{
+	ITMHashEntry *hashTable = index->GetEntries();
+	int noTotalEntries = index->noTotalEntries;
+
+	memset(index->GetBlockFilter(), 0, index->GetNoFilterLines() * SDF_FILTER_LINE_WORDS * sizeof(uint));
+	for (int entryId = 0; entryId < noTotalEntries; entryId++)
+		if (hashTable[entryId].ptr >= 0) markBlockInFilter(hashTable, hashTable[entryId].pos);
+}
+
+/// Whether the block occupancy counters match the blocks allocated in the hash table, see updateBlockOccupancy()
+inline bool isBlockOccupancyConsistent(const int *blockOccupancy, const ITMHashEntry *hashTable, int noTotalEntries)
+{
+	int noCounters = SDF_SUPERBLOCK_LEVELS * SDF_OCCUPANCY_NUM;
+	int *expectedOccupancy = new int[noCounters];
+	memset(expectedOccupancy, 0, noCounters * sizeof(int));
+
+	for (int entryId = 0; entryId < noTotalEntries; entryId++)
+		if (hashTable[entryId].ptr >= 0) updateBlockOccupancy(expectedOccupancy, hashTable[entryId].pos, 1);
+
+	bool isConsistent = memcmp(expectedOccupancy, blockOccupancy, noCounters * sizeof(int)) == 0;
+	delete[] expectedOccupancy;
+
+	return isConsistent;
+}
+
+/** With SDF_CHECK_BLOCK_OCCUPANCY set, fail if the block occupancy
+    counters of a host side index have drifted from its allocated
+    blocks. Called by every engine that allocates or removes blocks.
+*/
+inline void checkBlockOccupancy(const ITMLib::Objects::ITMVoxelBlockHash *index)
+{
+#if SDF_CHECK_BLOCK_OCCUPANCY
+	if (!isBlockOccupancyConsistent(index->GetBlockOccupancy(), index->GetEntries(), index->noTotalEntries))
+		DIEWITHEXCEPTION("The block occupancy counters disagree with the allocated blocks");
+#endif
+}
+
+/// Key that orders blocks along a Morton curve, so that blocks close in space are mostly close in the order
+inline unsigned long long blockMortonCode(const Vector3s & blockPos)
+{
+	unsigned long long code = 0;
+	unsigned int x = (unsigned short)(blockPos.x + 0x8000), y = (unsigned short)(blockPos.y + 0x8000), z = (unsigned short)(blockPos.z + 0x8000);
+
+	for (int bitId = 15; bitId >= 0; bitId--)
+		code = (code << 3) | (((x >> bitId) & 1) << 2) | (((y >> bitId) & 1) << 1) | ((z >> bitId) & 1);
+
+	return code;
+}
+
+/// Orders hash entries by the voxel block they point to
+struct HashEntryPtrLess
+{
+	const ITMHashEntry *hashTable;
+	explicit HashEntryPtrLess(const ITMHashEntry *hashTable) : hashTable(hashTable) { }
+	bool operator()(int entryId1, int entryId2) const { return hashTable[entryId1].ptr < hashTable[entryId2].ptr; }
+};
+
+/// Sort a visible list by the voxel blocks of its entries, so that walking it walks the voxel block array in order
+inline void sortVisibleEntriesByPtr(int *visibleEntryIDs, int noVisibleEntries, const ITMHashEntry *hashTable)
+{
+	std::sort(visibleEntryIDs, visibleEntryIDs + noVisibleEntries, HashEntryPtrLess(hashTable));
+}
+
+/// Prefetch the hash bucket of the block holding a voxel, ahead of an independent lookup of it
+inline void prefetchVoxel(const ITMLib::Objects::ITMVoxelBlockHash::IndexData *voxelIndex, const Vector3i & point)
+{
+	Vector3i blockPos;
+	pointToVoxelBlockPos(point, blockPos);
+	PREFETCH_READ(voxelIndex + hashIndex(blockPos, getNoOrderedEntries(voxelIndex), getNoEntriesPerBucket(voxelIndex)));
+}
+
+inline void prefetchVoxel(const ITMLib::Objects::ITMPlainVoxelArray::IndexData *voxelIndex, const Vector3i & point) { }
+#endif
+
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexData) *voxelIndex,
+	const THREADPTR(Vector3i) & point, THREADPTR(bool) &isFound, THREADPTR(ITMLib::Objects::ITMVoxelBlockHash::IndexCache) & cache)
+{
+	Vector3i blockPos;
+	int linearIdx = pointToVoxelBlockPos(point, blockPos);
+
+	int blockPtr = findVoxelBlock(voxelIndex, blockPos, cache);
+
+	isFound = blockPtr >= 0;
+	return isFound ? voxelData[blockPtr + linearIdx] : TVoxel();
 }
 
 template<class TVoxel>
@@ -141,6 +385,75 @@ _CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, co
 	return readVoxel(voxelData, voxelIndex, point_orig, isFound);
 }
 
+/** \brief
+    Reads the voxels of a small stencil around a base voxel, at offsets
+    from -1 to 2 along each axis, as needed for trilinear interpolation
+    and SDF gradients. Such a stencil touches at most 2x2x2 voxel blocks,
+    and each of them is looked up in the index at most once.
+*/
+template<class TVoxel, class TIndexData> struct VoxelStencil;
+
+template<class TVoxel>
+struct VoxelStencil<TVoxel, ITMLib::Objects::ITMVoxelBlockHash::IndexData>
+{
+	typedef ITMLib::Objects::ITMVoxelBlockHash::IndexCache IndexCache;
+
+	const CONSTPTR(TVoxel) *voxelData;
+	const CONSTPTR(ITMHashEntry) *voxelIndex;
+
+	/// The block holding the voxel at offset -1, and the base voxel relative to that block
+	Vector3i firstBlockPos, basePos;
+
+	/// Offsets of the 2x2x2 blocks in the voxel data, -1 if not allocated and -2 if not looked up yet
+	int blockPtrs[8];
+
+	_CPU_AND_GPU_CODE_ VoxelStencil(const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMHashEntry) *voxelIndex, const THREADPTR(Vector3i) & pos)
+	{
+		this->voxelData = voxelData; this->voxelIndex = voxelIndex;
+
+		pointToVoxelBlockPos(pos - Vector3i(1, 1, 1), firstBlockPos);
+		basePos = pos - firstBlockPos * SDF_BLOCK_SIZE;
+
+		for (int i = 0; i < 8; i++) blockPtrs[i] = -2;
+	}
+
+	_CPU_AND_GPU_CODE_ TVoxel read(const THREADPTR(Vector3i) & offset, THREADPTR(bool) &isFound, THREADPTR(IndexCache) & cache)
+	{
+		Vector3i pos = basePos + offset;
+		int bx = (pos.x >= SDF_BLOCK_SIZE) ? 1 : 0, by = (pos.y >= SDF_BLOCK_SIZE) ? 1 : 0, bz = (pos.z >= SDF_BLOCK_SIZE) ? 1 : 0;
+		pos.x -= bx * SDF_BLOCK_SIZE; pos.y -= by * SDF_BLOCK_SIZE; pos.z -= bz * SDF_BLOCK_SIZE;
+
+		int blockId = bx + by * 2 + bz * 4;
+		if (blockPtrs[blockId] == -2) blockPtrs[blockId] = findVoxelBlock(voxelIndex, firstBlockPos + Vector3i(bx, by, bz), cache);
+
+		isFound = blockPtrs[blockId] >= 0;
+		if (!isFound) return TVoxel();
+
+		return voxelData[blockPtrs[blockId] + voxelIndexInBlock(pos.x, pos.y, pos.z)];
+	}
+};
+
+template<class TVoxel>
+struct VoxelStencil<TVoxel, ITMLib::Objects::ITMPlainVoxelArray::IndexData>
+{
+	typedef ITMLib::Objects::ITMPlainVoxelArray::IndexCache IndexCache;
+
+	const CONSTPTR(TVoxel) *voxelData;
+	const CONSTPTR(ITMLib::Objects::ITMPlainVoxelArray::IndexData) *voxelIndex;
+	Vector3i pos;
+
+	_CPU_AND_GPU_CODE_ VoxelStencil(const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::Objects::ITMPlainVoxelArray::IndexData) *voxelIndex,
+		const THREADPTR(Vector3i) & pos)
+	{
+		this->voxelData = voxelData; this->voxelIndex = voxelIndex; this->pos = pos;
+	}
+
+	_CPU_AND_GPU_CODE_ TVoxel read(const THREADPTR(Vector3i) & offset, THREADPTR(bool) &isFound, THREADPTR(IndexCache) & cache)
+	{
+		return readVoxel(voxelData, voxelIndex, pos + offset, isFound);
+	}
+};
+
 template<class TVoxel, class TIndex>
 _CPU_AND_GPU_CODE_ inline float readFromSDF_float_uninterpolated(const CONSTPTR(TVoxel) *voxelData,
 	const CONSTPTR(TIndex) *voxelIndex, Vector3f point, THREADPTR(bool) &isFound)
@@ -163,21 +476,22 @@ _CPU_AND_GPU_CODE_ inline float readFromSDF_float_interpolated(const CONSTPTR(TV
 {
 	float res1, res2, v1, v2;
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
+	VoxelStencil<TVoxel, TIndex> stencil(voxelData, voxelIndex, pos);
 
-	v1 = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), isFound, cache).sdf;
-	v2 = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), isFound, cache).sdf;
+	v1 = stencil.read(Vector3i(0, 0, 0), isFound, cache).sdf;
+	v2 = stencil.read(Vector3i(1, 0, 0), isFound, cache).sdf;
 	res1 = (1.0f - coeff.x) * v1 + coeff.x * v2;
 
-	v1 = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), isFound, cache).sdf;
-	v2 = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), isFound, cache).sdf;
+	v1 = stencil.read(Vector3i(0, 1, 0), isFound, cache).sdf;
+	v2 = stencil.read(Vector3i(1, 1, 0), isFound, cache).sdf;
 	res1 = (1.0f - coeff.y) * res1 + coeff.y * ((1.0f - coeff.x) * v1 + coeff.x * v2);
 
-	v1 = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), isFound, cache).sdf;
-	v2 = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), isFound, cache).sdf;
+	v1 = stencil.read(Vector3i(0, 0, 1), isFound, cache).sdf;
+	v2 = stencil.read(Vector3i(1, 0, 1), isFound, cache).sdf;
 	res2 = (1.0f - coeff.x) * v1 + coeff.x * v2;
 
-	v1 = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), isFound, cache).sdf;
-	v2 = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), isFound, cache).sdf;
+	v1 = stencil.read(Vector3i(0, 1, 1), isFound, cache).sdf;
+	v2 = stencil.read(Vector3i(1, 1, 1), isFound, cache).sdf;
 	res2 = (1.0f - coeff.y) * res2 + coeff.y * ((1.0f - coeff.x) * v1 + coeff.x * v2);
 
 	isFound = true;
@@ -191,29 +505,30 @@ _CPU_AND_GPU_CODE_ inline Vector4f readFromSDF_color4u_interpolated(const CONSTP
 {
 	TVoxel resn; Vector3f ret = 0.0f; Vector4f ret4; bool isFound;
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
+	VoxelStencil<TVoxel, typename TIndex::IndexData> stencil(voxelData, voxelIndex, pos);
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), isFound, cache);
+	resn = stencil.read(Vector3i(0, 0, 0), isFound, cache);
 	ret += (1.0f - coeff.x) * (1.0f - coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), isFound, cache);
+	resn = stencil.read(Vector3i(1, 0, 0), isFound, cache);
 	ret += (coeff.x) * (1.0f - coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), isFound, cache);
+	resn = stencil.read(Vector3i(0, 1, 0), isFound, cache);
 	ret += (1.0f - coeff.x) * (coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), isFound, cache);
+	resn = stencil.read(Vector3i(1, 1, 0), isFound, cache);
 	ret += (coeff.x) * (coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), isFound, cache);
+	resn = stencil.read(Vector3i(0, 0, 1), isFound, cache);
 	ret += (1.0f - coeff.x) * (1.0f - coeff.y) * coeff.z * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), isFound, cache);
+	resn = stencil.read(Vector3i(1, 0, 1), isFound, cache);
 	ret += (coeff.x) * (1.0f - coeff.y) * coeff.z * resn.clr.toFloat();;
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), isFound, cache);
+	resn = stencil.read(Vector3i(0, 1, 1), isFound, cache);
 	ret += (1.0f - coeff.x) * (coeff.y) * coeff.z * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), isFound, cache);
+	resn = stencil.read(Vector3i(1, 1, 1), isFound, cache);
 	ret += (coeff.x) * (coeff.y) * coeff.z * resn.clr.toFloat();
 
 	ret4.x = ret.x; ret4.y = ret.y; ret4.z = ret.z; ret4.w = 255.0f;
@@ -228,18 +543,20 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 
 	Vector3f ret;
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
+	VoxelStencil<TVoxel, TIndex> stencil(voxelData, voxelIndex, pos);
+	typename VoxelStencil<TVoxel, TIndex>::IndexCache cache;
 	Vector3f ncoeff(1.0f - coeff.x, 1.0f - coeff.y, 1.0f - coeff.z);
 
 	// all 8 values are going to be reused several times
 	Vector4f front, back;
-	front.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), isFound).sdf;
-	front.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), isFound).sdf;
-	front.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), isFound).sdf;
-	front.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), isFound).sdf;
-	back.x  = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), isFound).sdf;
-	back.y  = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), isFound).sdf;
-	back.z  = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), isFound).sdf;
-	back.w  = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), isFound).sdf;
+	front.x = stencil.read(Vector3i(0, 0, 0), isFound, cache).sdf;
+	front.y = stencil.read(Vector3i(1, 0, 0), isFound, cache).sdf;
+	front.z = stencil.read(Vector3i(0, 1, 0), isFound, cache).sdf;
+	front.w = stencil.read(Vector3i(1, 1, 0), isFound, cache).sdf;
+	back.x  = stencil.read(Vector3i(0, 0, 1), isFound, cache).sdf;
+	back.y  = stencil.read(Vector3i(1, 0, 1), isFound, cache).sdf;
+	back.z  = stencil.read(Vector3i(0, 1, 1), isFound, cache).sdf;
+	back.w  = stencil.read(Vector3i(1, 1, 1), isFound, cache).sdf;
 
 	Vector4f tmp;
 	float p1, p2, v1;
@@ -248,10 +565,10 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 	     front.z *  coeff.y * ncoeff.z +
 	     back.x  * ncoeff.y *  coeff.z +
 	     back.z  *  coeff.y *  coeff.z;
-	tmp.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(-1, 0, 0), isFound).sdf;
-	tmp.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(-1, 1, 0), isFound).sdf;
-	tmp.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(-1, 0, 1), isFound).sdf;
-	tmp.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(-1, 1, 1), isFound).sdf;
+	tmp.x = stencil.read(Vector3i(-1, 0, 0), isFound, cache).sdf;
+	tmp.y = stencil.read(Vector3i(-1, 1, 0), isFound, cache).sdf;
+	tmp.z = stencil.read(Vector3i(-1, 0, 1), isFound, cache).sdf;
+	tmp.w = stencil.read(Vector3i(-1, 1, 1), isFound, cache).sdf;
 	p2 = tmp.x * ncoeff.y * ncoeff.z +
 	     tmp.y *  coeff.y * ncoeff.z +
 	     tmp.z * ncoeff.y *  coeff.z +
@@ -262,10 +579,10 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 	     front.w *  coeff.y * ncoeff.z +
 	     back.y  * ncoeff.y *  coeff.z +
 	     back.w  *  coeff.y *  coeff.z;
-	tmp.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(2, 0, 0), isFound).sdf;
-	tmp.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(2, 1, 0), isFound).sdf;
-	tmp.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(2, 0, 1), isFound).sdf;
-	tmp.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(2, 1, 1), isFound).sdf;
+	tmp.x = stencil.read(Vector3i(2, 0, 0), isFound, cache).sdf;
+	tmp.y = stencil.read(Vector3i(2, 1, 0), isFound, cache).sdf;
+	tmp.z = stencil.read(Vector3i(2, 0, 1), isFound, cache).sdf;
+	tmp.w = stencil.read(Vector3i(2, 1, 1), isFound, cache).sdf;
 	p2 = tmp.x * ncoeff.y * ncoeff.z +
 	     tmp.y *  coeff.y * ncoeff.z +
 	     tmp.z * ncoeff.y *  coeff.z +
@@ -278,10 +595,10 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 	     front.y *  coeff.x * ncoeff.z +
 	     back.x  * ncoeff.x *  coeff.z +
 	     back.y  *  coeff.x *  coeff.z;
-	tmp.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, -1, 0), isFound).sdf;
-	tmp.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, -1, 0), isFound).sdf;
-	tmp.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, -1, 1), isFound).sdf;
-	tmp.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, -1, 1), isFound).sdf;
+	tmp.x = stencil.read(Vector3i(0, -1, 0), isFound, cache).sdf;
+	tmp.y = stencil.read(Vector3i(1, -1, 0), isFound, cache).sdf;
+	tmp.z = stencil.read(Vector3i(0, -1, 1), isFound, cache).sdf;
+	tmp.w = stencil.read(Vector3i(1, -1, 1), isFound, cache).sdf;
 	p2 = tmp.x * ncoeff.x * ncoeff.z +
 	     tmp.y *  coeff.x * ncoeff.z +
 	     tmp.z * ncoeff.x *  coeff.z +
@@ -292,10 +609,10 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 	     front.w *  coeff.x * ncoeff.z +
 	     back.z  * ncoeff.x *  coeff.z +
 	     back.w  *  coeff.x *  coeff.z;
-	tmp.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 2, 0), isFound).sdf;
-	tmp.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 2, 0), isFound).sdf;
-	tmp.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 2, 1), isFound).sdf;
-	tmp.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 2, 1), isFound).sdf;
+	tmp.x = stencil.read(Vector3i(0, 2, 0), isFound, cache).sdf;
+	tmp.y = stencil.read(Vector3i(1, 2, 0), isFound, cache).sdf;
+	tmp.z = stencil.read(Vector3i(0, 2, 1), isFound, cache).sdf;
+	tmp.w = stencil.read(Vector3i(1, 2, 1), isFound, cache).sdf;
 	p2 = tmp.x * ncoeff.x * ncoeff.z +
 	     tmp.y *  coeff.x * ncoeff.z +
 	     tmp.z * ncoeff.x *  coeff.z +
@@ -308,10 +625,10 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 	     front.y *  coeff.x * ncoeff.y +
 	     front.z * ncoeff.x *  coeff.y +
 	     front.w *  coeff.x *  coeff.y;
-	tmp.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, -1), isFound).sdf;
-	tmp.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, -1), isFound).sdf;
-	tmp.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, -1), isFound).sdf;
-	tmp.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, -1), isFound).sdf;
+	tmp.x = stencil.read(Vector3i(0, 0, -1), isFound, cache).sdf;
+	tmp.y = stencil.read(Vector3i(1, 0, -1), isFound, cache).sdf;
+	tmp.z = stencil.read(Vector3i(0, 1, -1), isFound, cache).sdf;
+	tmp.w = stencil.read(Vector3i(1, 1, -1), isFound, cache).sdf;
 	p2 = tmp.x * ncoeff.x * ncoeff.y +
 	     tmp.y *  coeff.x * ncoeff.y +
 	     tmp.z * ncoeff.x *  coeff.y +
@@ -322,10 +639,10 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 	     back.y *  coeff.x * ncoeff.y +
 	     back.z * ncoeff.x *  coeff.y +
 	     back.w *  coeff.x *  coeff.y;
-	tmp.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 2), isFound).sdf;
-	tmp.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 2), isFound).sdf;
-	tmp.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 2), isFound).sdf;
-	tmp.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 2), isFound).sdf;
+	tmp.x = stencil.read(Vector3i(0, 0, 2), isFound, cache).sdf;
+	tmp.y = stencil.read(Vector3i(1, 0, 2), isFound, cache).sdf;
+	tmp.z = stencil.read(Vector3i(0, 1, 2), isFound, cache).sdf;
+	tmp.w = stencil.read(Vector3i(1, 1, 2), isFound, cache).sdf;
 	p2 = tmp.x * ncoeff.x * ncoeff.y +
 	     tmp.y *  coeff.x * ncoeff.y +
 	     tmp.z * ncoeff.x *  coeff.y +
@@ -6,6 +6,27 @@
 #include "ITMPixelUtils.h"
 #include "ITMRepresentationAccess.h"
 
+/// A block is garbage if all of its observed voxels are at least minSdf in front of a surface and none has a weight above maxW
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline bool isBlockGarbage(const CONSTPTR(TVoxel) *voxelBlock, float minSdf, int maxW)
+{
+	for (int locId = 0; locId < SDF_BLOCK_SIZE3; locId++)
+	{
+		const TVoxel &voxel = voxelBlock[locId];
+		if (voxel.w_depth == 0) continue;
+		if (voxel.w_depth > maxW || TVoxel::SDF_valueToFloat(voxel.sdf) < minSdf) return false;
+	}
+
+	return true;
+}
+
+/// Bring a block that has just been taken from the free list into its initial state
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline void resetVoxelBlock(DEVICEPTR(TVoxel) *voxelBlock)
+{
+	for (int locId = 0; locId < SDF_BLOCK_SIZE3; locId++) voxelBlock[locId] = TVoxel();
+}
+
 template<class TVoxel>
 _CPU_AND_GPU_CODE_ inline float computeUpdatedVoxelDepthInfo(DEVICEPTR(TVoxel) &voxel, const THREADPTR(Vector4f) & pt_model, const CONSTPTR(Matrix4f) & M_d,
 	const CONSTPTR(Vector4f) & projParams_d, float mu, int maxW, const CONSTPTR(float) *depth, const CONSTPTR(Vector2i) & imgSize)
@@ -115,15 +136,19 @@ struct ComputeUpdatedVoxelInfo<true, TVoxel> {
 	}
 };
 
-_CPU_AND_GPU_CODE_ inline void buildHashAllocAndVisibleTypePP(DEVICEPTR(uchar) *entriesAllocType, DEVICEPTR(uchar) *entriesVisibleType, int x, int y,
-	DEVICEPTR(Vector4s) *blockCoords, const CONSTPTR(float) *depth, Matrix4f invM_d, Vector4f projParams_d, float mu, Vector2i imgSize,
-	float oneOverVoxelSize, const CONSTPTR(ITMHashEntry) *hashTable, float viewFrustum_min, float viewFrustum_max)
+/** Segment of the ray through a depth pixel that is covered by the
+    truncation band, in block coordinates. Returns the number of steps
+    along it, or 0 if the pixel has no valid depth.
+*/
+_CPU_AND_GPU_CODE_ inline int computeAllocationSegment(THREADPTR(Vector3f) &point, THREADPTR(Vector3f) &direction, int x, int y,
+	const CONSTPTR(float) *depth, Matrix4f invM_d, Vector4f projParams_d, float mu, Vector2i imgSize, float oneOverVoxelSize,
+	float viewFrustum_min, float viewFrustum_max)
 {
-	float depth_measure; unsigned int hashIdx; int noSteps;
-	Vector3f pt_camera_f, point_e, point, direction; Vector3s blockPos;
+	float depth_measure; int noSteps;
+	Vector3f pt_camera_f, point_e;
 
 	depth_measure = depth[x + y * imgSize.x];
-	if (depth_measure <= 0 || (depth_measure - mu) < 0 || (depth_measure - mu) < viewFrustum_min || (depth_measure + mu) > viewFrustum_max) return;
+	if (depth_measure <= 0 || (depth_measure - mu) < 0 || (depth_measure - mu) < viewFrustum_min || (depth_measure + mu) > viewFrustum_max) return 0;
 
 	pt_camera_f.z = depth_measure;
 	pt_camera_f.x = pt_camera_f.z * ((float(x) - projParams_d.z) * projParams_d.x);
@@ -148,63 +173,80 @@ _CPU_AND_GPU_CODE_ inline void buildHashAllocAndVisibleTypePP(DEVICEPTR(uchar) *
 
 	direction /= (float)(noSteps - 1);
 
+	return noSteps;
+}
+
+_CPU_AND_GPU_CODE_ inline void buildHashAllocAndVisibleTypeSegment(DEVICEPTR(uchar) *entriesAllocType, DEVICEPTR(uchar) *entriesVisibleType,
+	DEVICEPTR(Vector4s) *blockCoords, Vector3f point, const THREADPTR(Vector3f) &direction, int noSteps, const CONSTPTR(ITMHashEntry) *hashTable)
+{
+	Vector3s blockPos;
+	int noOrderedEntries = getNoOrderedEntries(hashTable), noEntriesPerBucket = getNoEntriesPerBucket(hashTable);
+
 	//add neighbouring blocks
 	for (int i = 0; i < noSteps; i++)
 	{
 		blockPos = TO_SHORT_FLOOR3(point);
 
-		//compute index in hash table
-		hashIdx = hashIndex(blockPos);
+		//compute index of the first entry of the bucket
+		int hashIdx = hashIndex(blockPos, noOrderedEntries, noEntriesPerBucket), freeIdx = -1;
 
-		//check if hash table contains entry
+		//check if the bucket or its excess list contains the entry
 		bool isFound = false;
 
-		ITMHashEntry hashEntry = hashTable[hashIdx];
-
-		if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= -1)
+		ITMHashEntry hashEntry;
+		for (int entryId = 0; entryId < noEntriesPerBucket; entryId++, hashIdx++)
 		{
-			//entry has been streamed out but is visible or in memory and visible
-			entriesVisibleType[hashIdx] = (hashEntry.ptr == -1) ? 2 : 1;
+			hashEntry = hashTable[hashIdx];
 
-			isFound = true;
+			if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= -1) { isFound = true; break; }
+			if (hashEntry.ptr < -1 && freeIdx < 0) freeIdx = hashIdx;
 		}
 
 		if (!isFound)
 		{
-			bool isExcess = false;
-			if (hashEntry.ptr >= -1) //seach excess list only if there is no room in ordered part
+			//the excess list hangs off the last entry of the bucket
+			hashIdx--; hashEntry = hashTable[hashIdx];
+			while (hashEntry.offset >= 1)
 			{
-				while (hashEntry.offset >= 1)
-				{
-					hashIdx = SDF_BUCKET_NUM + hashEntry.offset - 1;
-					hashEntry = hashTable[hashIdx];
-
-					if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= -1)
-					{
-						//entry has been streamed out but is visible or in memory and visible
-						entriesVisibleType[hashIdx] = (hashEntry.ptr == -1) ? 2 : 1;
-
-						isFound = true;
-						break;
-					}
-				}
-
-				isExcess = true;
+				hashIdx = noOrderedEntries + hashEntry.offset - 1;
+				hashEntry = hashTable[hashIdx];
+
+				if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= -1) { isFound = true; break; }
 			}
+		}
 
-			if (!isFound) //still not found
-			{
-				entriesAllocType[hashIdx] = isExcess ? 2 : 1; //needs allocation 
-				if (!isExcess) entriesVisibleType[hashIdx] = 1; //new entry is visible
+		if (isFound)
+		{
+			//entry has been streamed out but is visible or in memory and visible
+			entriesVisibleType[hashIdx] = (hashEntry.ptr == -1) ? 2 : 1;
+		}
+		else
+		{
+			//use a free entry of the bucket if there is one, otherwise append to the excess list
+			bool isExcess = freeIdx < 0;
+			if (!isExcess) hashIdx = freeIdx;
 
-				blockCoords[hashIdx] = Vector4s(blockPos.x, blockPos.y, blockPos.z, 1);
-			}
+			entriesAllocType[hashIdx] = isExcess ? 2 : 1; //needs allocation 
+			if (!isExcess) entriesVisibleType[hashIdx] = 1; //new entry is visible
+
+			blockCoords[hashIdx] = Vector4s(blockPos.x, blockPos.y, blockPos.z, 1);
 		}
 
 		point += direction;
 	}
 }
 
+_CPU_AND_GPU_CODE_ inline void buildHashAllocAndVisibleTypePP(DEVICEPTR(uchar) *entriesAllocType, DEVICEPTR(uchar) *entriesVisibleType, int x, int y,
+	DEVICEPTR(Vector4s) *blockCoords, const CONSTPTR(float) *depth, Matrix4f invM_d, Vector4f projParams_d, float mu, Vector2i imgSize,
+	float oneOverVoxelSize, const CONSTPTR(ITMHashEntry) *hashTable, float viewFrustum_min, float viewFrustum_max)
+{
+	Vector3f point, direction;
+	int noSteps = computeAllocationSegment(point, direction, x, y, depth, invM_d, projParams_d, mu, imgSize, oneOverVoxelSize,
+		viewFrustum_min, viewFrustum_max);
+
+	buildHashAllocAndVisibleTypeSegment(entriesAllocType, entriesVisibleType, blockCoords, point, direction, noSteps, hashTable);
+}
+
 template<bool useSwapping>
 _CPU_AND_GPU_CODE_ inline void checkPointVisibility(THREADPTR(bool) &isVisible, THREADPTR(bool) &isVisibleEnlarged,
 	const THREADPTR(Vector4f) &pt_image, const CONSTPTR(Matrix4f) & M_d, const CONSTPTR(Vector4f) &projParams_d,
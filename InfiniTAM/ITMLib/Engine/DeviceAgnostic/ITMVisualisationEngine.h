@@ -3,6 +3,7 @@
 #pragma once
 
 #include "../../Utils/ITMLibDefines.h"
+#include "ITMCompactICPMaps.h"
 
 struct RenderingBlock {
 	Vector2s upperLeft;
@@ -348,6 +349,33 @@ _CPU_AND_GPU_CODE_ inline void processPixelICP(DEVICEPTR(Vector4u) *outRendering
 	}
 }
 
+template<bool useSmoothing>
+_CPU_AND_GPU_CODE_ inline void processPixelICP(DEVICEPTR(Vector4u) *outRendering, DEVICEPTR(float) *depthMap, DEVICEPTR(Vector2s_) *normalsMap,
+	const CONSTPTR(Vector4f) *pointsRay, const THREADPTR(Vector2i) &imgSize, const THREADPTR(int) &x, const THREADPTR(int) &y, float voxelSize,
+	const THREADPTR(Vector3f) &lightSource, const CONSTPTR(Matrix4f) &M)
+{
+	Vector3f outNormal;
+	float angle;
+
+	int locId = x + y * imgSize.x;
+	Vector4f point = pointsRay[locId];
+
+	bool foundPoint = point.w > 0.0f;
+
+	computeNormalAndAngle<useSmoothing>(foundPoint, x, y, pointsRay, lightSource, voxelSize, imgSize, outNormal, angle);
+
+	if (foundPoint)
+	{
+		drawPixelGrey(outRendering[locId], angle);
+		encodeCompactICPPixel(depthMap[locId], normalsMap[locId], point.toVector3() * voxelSize, outNormal, M);
+	}
+	else
+	{
+		encodeCompactICPHole(depthMap[locId], normalsMap[locId]);
+		outRendering[locId] = Vector4u((uchar)0);
+	}
+}
+
 template<bool useSmoothing>
 _CPU_AND_GPU_CODE_ inline void processPixelForwardRender(DEVICEPTR(Vector4u) *outRendering, const CONSTPTR(Vector4f) *pointsRay, 
 	const THREADPTR(Vector2i) &imgSize, const THREADPTR(int) &x, const THREADPTR(int) &y, float voxelSize, const THREADPTR(Vector3f) &lightSource)
@@ -4,14 +4,15 @@
 
 #include "../../Utils/ITMLibDefines.h"
 #include "ITMPixelUtils.h"
+#include "ITMCompactICPMaps.h"
 
 
-template<bool shortIteration, bool rotationOnly>
+template<bool shortIteration, bool rotationOnly, class TPoint, class TNormal>
 _CPU_AND_GPU_CODE_ inline bool computePerPointGH_wICP(THREADPTR(float) *localNabla, THREADPTR(float) *localHessian, THREADPTR(float) &localF, THREADPTR(float) &localWeight,
 	const THREADPTR(int) & x, const THREADPTR(int) & y,
 	const CONSTPTR(float) &depth, const CONSTPTR(Vector2i) & viewImageSize, const CONSTPTR(Vector4f) & viewIntrinsics, const CONSTPTR(Vector2i) & sceneImageSize,
-	const CONSTPTR(Vector4f) & sceneIntrinsics, const CONSTPTR(Matrix4f) & approxInvPose, const CONSTPTR(Matrix4f) & scenePose, const CONSTPTR(Vector4f) *pointsMap,
-	const CONSTPTR(Vector4f) *normalsMap, float distThresh)
+	const CONSTPTR(Vector4f) & sceneIntrinsics, const CONSTPTR(Matrix4f) & approxInvPose, const CONSTPTR(Matrix4f) & scenePose, const CONSTPTR(TPoint) *pointsMap,
+	const CONSTPTR(TNormal) *normalsMap, float distThresh)
 {
 	const int noPara = shortIteration ? 3 : 6;
 
@@ -48,7 +49,7 @@ _CPU_AND_GPU_CODE_ inline bool computePerPointGH_wICP(THREADPTR(float) *localNab
 	//////////////////////////////////////////////////////////////////////////
 	// new depth point don't have corresponding voxel block
 	//////////////////////////////////////////////////////////////////////////
-	curr3Dpoint = interpolateBilinear_withHoles(pointsMap, tmp2Dpoint, sceneImageSize);
+	curr3Dpoint = interpolateICPPoint(pointsMap, tmp2Dpoint, sceneImageSize, sceneIntrinsics, scenePose);
 	if (curr3Dpoint.w < 0.0f) { /*localWeight = ICP_NO_CORR;*/ return false; } // reprojected depth to a hole
 
 	ptDiff.x = curr3Dpoint.x - tmp3Dpoint.x;
@@ -62,7 +63,7 @@ _CPU_AND_GPU_CODE_ inline bool computePerPointGH_wICP(THREADPTR(float) *localNab
 	if (dist > distThresh) { /*localWeight = ICP_FAR_OUTLIER;*/ return false; } // distance too big remove points
 
 
-	corr3Dnormal = interpolateBilinear_withHoles(normalsMap, tmp2Dpoint, sceneImageSize);
+	corr3Dnormal = interpolateICPNormal(normalsMap, tmp2Dpoint, sceneImageSize, scenePose);
 		//if (corr3Dnormal.w < 0.0f) return false;
 	
 	float b = corr3Dnormal.x * ptDiff.x + corr3Dnormal.y * ptDiff.y + corr3Dnormal.z * ptDiff.z;
@@ -6,8 +6,28 @@
 
 using namespace ITMLib::Engine;
 
-ITMColorTracker_CPU::ITMColorTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, const ITMLowLevelEngine *lowLevelEngine)
-	: ITMColorTracker(imgSize, trackingRegime, noHierarchyLevels, lowLevelEngine, MEMORYDEVICE_CPU) {  }
+ITMColorTracker_CPU::ITMColorTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, const ITMLowLevelEngine *lowLevelEngine,
+	ITMLibSettings::PixelSelectionType pixelSelectionType, int pixelSelectionStride, bool useIntensity)
+	: ITMColorTracker(imgSize, trackingRegime, noHierarchyLevels, lowLevelEngine, MEMORYDEVICE_CPU, pixelSelectionType, pixelSelectionStride, useIntensity) {  }
+
+template<bool rotationOnly>
+static void accumulateGH_Intensity_CPU(float *globalGradient, float *globalHessian, const Vector4f *locations, const Vector4f *colours,
+	const uchar *intensity, const Vector2s_ *gradients, Vector2i imgSize, const int *selectedPoints, int noTotalPoints, Vector4f projParams, Matrix4f M)
+{
+	const int numPara = rotationOnly ? 3 : 6, numParaSQ = rotationOnly ? 3 + 2 + 1 : 6 + 5 + 4 + 3 + 2 + 1;
+
+	for (int pointId = 0; pointId < noTotalPoints; pointId++)
+	{
+		int locId = (selectedPoints != NULL) ? selectedPoints[pointId] : pointId;
+		float localGradient[6], localHessian[21];
+
+		if (computePerPointGH_Intensity<rotationOnly>(localGradient, localHessian, locations, colours, intensity, gradients, imgSize, locId, projParams, M))
+		{
+			for (int i = 0; i < numPara; i++) globalGradient[i] += localGradient[i];
+			for (int i = 0; i < numParaSQ; i++) globalHessian[i] += localHessian[i];
+		}
+	}
+}
 
 ITMColorTracker_CPU::~ITMColorTracker_CPU(void) { }
 
@@ -21,19 +41,39 @@ void ITMColorTracker_CPU::F_oneLevel(float *f, ITMPose *pose)
 
 	Matrix4f M = pose->GetM();
 
-	Vector2i imgSize = viewHierarchy->levels[levelId]->rgb->noDims;
-
 	float scaleForOcclusions, final_f;
 
 	Vector4f *locations = trackingState->pointCloud->locations->GetData(MEMORYDEVICE_CPU);
 	Vector4f *colours = trackingState->pointCloud->colours->GetData(MEMORYDEVICE_CPU);
-	Vector4u *rgb = viewHierarchy->levels[levelId]->rgb->GetData(MEMORYDEVICE_CPU);
+
+	const ITMSelectionHierarchyLevel *selection = (selectionHierarchy != NULL) ? selectionHierarchy->levels[levelId] : NULL;
+	if (selection != NULL) noTotalPoints = selection->noSelected;
+	const int *selectedPoints = (selection != NULL) ? selection->indices->GetData(MEMORYDEVICE_CPU) : NULL;
 
 	final_f = 0; countedPoints_valid = 0;
-	for (int locId = 0; locId < noTotalPoints; locId++)
+	if (intensityHierarchy != NULL)
+	{
+		Vector2i imgSize = intensityHierarchy->levels[levelId]->intensity->noDims;
+		const uchar *intensity = intensityHierarchy->levels[levelId]->intensity->GetData(MEMORYDEVICE_CPU);
+
+		for (int pointId = 0; pointId < noTotalPoints; pointId++)
+		{
+			int locId = (selectedPoints != NULL) ? selectedPoints[pointId] : pointId;
+			float intensityDiffSq = getIntensityDifferenceSq(locations, colours, intensity, imgSize, locId, projParams, M);
+			if (intensityDiffSq >= 0) { final_f += intensityDiffSq; countedPoints_valid++; }
+		}
+	}
+	else
 	{
-		float colorDiffSq = getColorDifferenceSq(locations, colours, rgb, imgSize, locId, projParams, M);
-		if (colorDiffSq >= 0) { final_f += colorDiffSq; countedPoints_valid++; }
+		Vector2i imgSize = viewHierarchy->levels[levelId]->rgb->noDims;
+		Vector4u *rgb = viewHierarchy->levels[levelId]->rgb->GetData(MEMORYDEVICE_CPU);
+
+		for (int pointId = 0; pointId < noTotalPoints; pointId++)
+		{
+			int locId = (selectedPoints != NULL) ? selectedPoints[pointId] : pointId;
+			float colorDiffSq = getColorDifferenceSq(locations, colours, rgb, imgSize, locId, projParams, M);
+			if (colorDiffSq >= 0) { final_f += colorDiffSq; countedPoints_valid++; }
+		}
 	}
 
 	if (countedPoints_valid == 0) { final_f = MY_INF; scaleForOcclusions = 1.0; }
@@ -52,8 +92,6 @@ void ITMColorTracker_CPU::G_oneLevel(float *gradient, float *hessian, ITMPose *p
 
 	Matrix4f M = pose->GetM();
 
-	Vector2i imgSize = viewHierarchy->levels[levelId]->rgb->noDims;
-
 	float scaleForOcclusions;
 
 	bool rotationOnly = iterationType == TRACKER_ITERATION_ROTATION;
@@ -65,21 +103,42 @@ void ITMColorTracker_CPU::G_oneLevel(float *gradient, float *hessian, ITMPose *p
 
 	Vector4f *locations = trackingState->pointCloud->locations->GetData(MEMORYDEVICE_CPU);
 	Vector4f *colours = trackingState->pointCloud->colours->GetData(MEMORYDEVICE_CPU);
-	Vector4u *rgb = viewHierarchy->levels[levelId]->rgb->GetData(MEMORYDEVICE_CPU);
-	Vector4s *gx = viewHierarchy->levels[levelId]->gradientX_rgb->GetData(MEMORYDEVICE_CPU);
-	Vector4s *gy = viewHierarchy->levels[levelId]->gradientY_rgb->GetData(MEMORYDEVICE_CPU);
 
-	for (int locId = 0; locId < noTotalPoints; locId++)
-	{
-		float localGradient[6], localHessian[21];
+	const ITMSelectionHierarchyLevel *selection = (selectionHierarchy != NULL) ? selectionHierarchy->levels[levelId] : NULL;
+	if (selection != NULL) noTotalPoints = selection->noSelected;
+	const int *selectedPoints = (selection != NULL) ? selection->indices->GetData(MEMORYDEVICE_CPU) : NULL;
 
-		bool isValidPoint = computePerPointGH_rt_Color(localGradient, localHessian, locations, colours, rgb, imgSize, locId,
-			projParams, M, gx, gy, numPara, startPara);
+	if (intensityHierarchy != NULL)
+	{
+		Vector2i imgSize = intensityHierarchy->levels[levelId]->intensity->noDims;
+		const uchar *intensity = intensityHierarchy->levels[levelId]->intensity->GetData(MEMORYDEVICE_CPU);
+		const Vector2s_ *gradients = intensityHierarchy->levels[levelId]->gradients->GetData(MEMORYDEVICE_CPU);
+
+		if (rotationOnly) accumulateGH_Intensity_CPU<true>(globalGradient, globalHessian, locations, colours, intensity, gradients, imgSize,
+			selectedPoints, noTotalPoints, projParams, M);
+		else accumulateGH_Intensity_CPU<false>(globalGradient, globalHessian, locations, colours, intensity, gradients, imgSize,
+			selectedPoints, noTotalPoints, projParams, M);
+	}
+	else
+	{
+		Vector2i imgSize = viewHierarchy->levels[levelId]->rgb->noDims;
+		Vector4u *rgb = viewHierarchy->levels[levelId]->rgb->GetData(MEMORYDEVICE_CPU);
+		Vector4s *gx = viewHierarchy->levels[levelId]->gradientX_rgb->GetData(MEMORYDEVICE_CPU);
+		Vector4s *gy = viewHierarchy->levels[levelId]->gradientY_rgb->GetData(MEMORYDEVICE_CPU);
 
-		if (isValidPoint)
+		for (int pointId = 0; pointId < noTotalPoints; pointId++)
 		{
-			for (int i = 0; i < numPara; i++) globalGradient[i] += localGradient[i];
-			for (int i = 0; i < numParaSQ; i++) globalHessian[i] += localHessian[i];
+			int locId = (selectedPoints != NULL) ? selectedPoints[pointId] : pointId;
+			float localGradient[6], localHessian[21];
+
+			bool isValidPoint = computePerPointGH_rt_Color(localGradient, localHessian, locations, colours, rgb, imgSize, locId,
+				projParams, M, gx, gy, numPara, startPara);
+
+			if (isValidPoint)
+			{
+				for (int i = 0; i < numPara; i++) globalGradient[i] += localGradient[i];
+				for (int i = 0; i < numParaSQ; i++) globalHessian[i] += localHessian[i];
+			}
 		}
 	}
 
@@ -15,7 +15,8 @@ namespace ITMLib
 			void G_oneLevel(float *gradient, float *hessian, ITMPose *pose) const;
 
 			ITMColorTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels,
-				const ITMLowLevelEngine *lowLevelEngine);
+				const ITMLowLevelEngine *lowLevelEngine, ITMLibSettings::PixelSelectionType pixelSelectionType = ITMLibSettings::PIXELSELECTION_ALL,
+				int pixelSelectionStride = 1, bool useIntensity = false);
 			~ITMColorTracker_CPU(void);
 		};
 	}
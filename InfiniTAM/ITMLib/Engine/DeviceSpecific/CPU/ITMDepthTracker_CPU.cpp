@@ -5,9 +5,31 @@
 
 using namespace ITMLib::Engine;
 
+template<class TPoint, class TNormal>
+static inline bool computePerPointGH_Depth_CPU(TrackerIterationType iterationType, float *localNabla, float *localHessian, float &localF, int x, int y,
+	float depth, const Vector2i &viewImageSize, const Vector4f &viewIntrinsics, const Vector2i &sceneImageSize, const Vector4f &sceneIntrinsics,
+	const Matrix4f &approxInvPose, const Matrix4f &scenePose, const TPoint *pointsMap, const TNormal *normalsMap, float distThresh)
+{
+	switch (iterationType)
+	{
+	case TRACKER_ITERATION_ROTATION:
+		return computePerPointGH_Depth<true, true>(localNabla, localHessian, localF, x, y, depth, viewImageSize,
+			viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh);
+	case TRACKER_ITERATION_TRANSLATION:
+		return computePerPointGH_Depth<true, false>(localNabla, localHessian, localF, x, y, depth, viewImageSize,
+			viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh);
+	case TRACKER_ITERATION_BOTH:
+		return computePerPointGH_Depth<false, false>(localNabla, localHessian, localF, x, y, depth, viewImageSize,
+			viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh);
+	default:
+		return false;
+	}
+}
+
 ITMDepthTracker_CPU::ITMDepthTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, int noICPRunTillLevel,
-	float distThresh, float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine) :ITMDepthTracker(imgSize, trackingRegime, noHierarchyLevels,
-	noICPRunTillLevel, distThresh, terminationThreshold, lowLevelEngine, MEMORYDEVICE_CPU) { }
+	float distThresh, float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine, ITMLibSettings::PixelSelectionType pixelSelectionType,
+	int pixelSelectionStride) :ITMDepthTracker(imgSize, trackingRegime, noHierarchyLevels, noICPRunTillLevel, distThresh, terminationThreshold,
+	lowLevelEngine, MEMORYDEVICE_CPU, pixelSelectionType, pixelSelectionStride) { }
 
 ITMDepthTracker_CPU::~ITMDepthTracker_CPU(void) { }
 
@@ -15,6 +37,8 @@ int ITMDepthTracker_CPU::ComputeGandH(float &f, float *nabla, float *hessian, Ma
 {
 	Vector4f *pointsMap = sceneHierarchyLevel->pointsMap->GetData(MEMORYDEVICE_CPU);
 	Vector4f *normalsMap = sceneHierarchyLevel->normalsMap->GetData(MEMORYDEVICE_CPU);
+	float *compactDepthMap = (sceneHierarchyLevel->compactDepthMap != NULL) ? sceneHierarchyLevel->compactDepthMap->GetData(MEMORYDEVICE_CPU) : NULL;
+	Vector2s_ *compactNormalsMap = (sceneHierarchyLevel->compactNormalsMap != NULL) ? sceneHierarchyLevel->compactNormalsMap->GetData(MEMORYDEVICE_CPU) : NULL;
 	Vector4f sceneIntrinsics = sceneHierarchyLevel->intrinsics;
 	Vector2i sceneImageSize = sceneHierarchyLevel->pointsMap->noDims;
 
@@ -33,8 +57,14 @@ int ITMDepthTracker_CPU::ComputeGandH(float &f, float *nabla, float *hessian, Ma
 	memset(sumHessian, 0, sizeof(float) * noParaSQ);
 	memset(sumNabla, 0, sizeof(float) * noPara);
 
-	for (int y = 0; y < viewImageSize.y; y++) for (int x = 0; x < viewImageSize.x; x++)
+	int noPixels = (selectionHierarchyLevel != NULL) ? selectionHierarchyLevel->noSelected : viewImageSize.x * viewImageSize.y;
+	const int *selectedPixels = (selectionHierarchyLevel != NULL) ? selectionHierarchyLevel->indices->GetData(MEMORYDEVICE_CPU) : NULL;
+
+	for (int pixelId = 0; pixelId < noPixels; pixelId++)
 	{
+		int locId = (selectedPixels != NULL) ? selectedPixels[pixelId] : pixelId;
+		int y = locId / viewImageSize.x, x = locId - y * viewImageSize.x;
+
 		float localHessian[6 + 5 + 4 + 3 + 2 + 1], localNabla[6], localF = 0;
 
 		for (int i = 0; i < noPara; i++) localNabla[i] = 0.0f;
@@ -42,24 +72,12 @@ int ITMDepthTracker_CPU::ComputeGandH(float &f, float *nabla, float *hessian, Ma
 
 		bool isValidPoint;
         
-		switch (iterationType)
-		{
-		case TRACKER_ITERATION_ROTATION:
-			isValidPoint = computePerPointGH_Depth<true, true>(localNabla, localHessian, localF, x, y, depth[x + y * viewImageSize.x], viewImageSize,
-				viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh[levelId]);
-			break;
-		case TRACKER_ITERATION_TRANSLATION:
-			isValidPoint = computePerPointGH_Depth<true, false>(localNabla, localHessian, localF, x, y, depth[x + y * viewImageSize.x], viewImageSize,
+		if (compactDepthMap != NULL)
+			isValidPoint = computePerPointGH_Depth_CPU(iterationType, localNabla, localHessian, localF, x, y, depth[x + y * viewImageSize.x], viewImageSize,
+				viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, compactDepthMap, compactNormalsMap, distThresh[levelId]);
+		else
+			isValidPoint = computePerPointGH_Depth_CPU(iterationType, localNabla, localHessian, localF, x, y, depth[x + y * viewImageSize.x], viewImageSize,
 				viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh[levelId]);
-			break;
-		case TRACKER_ITERATION_BOTH:
-			isValidPoint = computePerPointGH_Depth<false, false>(localNabla, localHessian, localF, x, y, depth[x + y * viewImageSize.x], viewImageSize,
-				viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh[levelId]);
-			break;
-		default:
-			isValidPoint = false;
-			break;
-		}
 
 		if (isValidPoint)
 		{
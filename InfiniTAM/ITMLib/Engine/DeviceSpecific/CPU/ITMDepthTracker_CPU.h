@@ -15,7 +15,8 @@ namespace ITMLib
 
 		public:
 			ITMDepthTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, int noICPRunTillLevel, float distThresh,
-				float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine);
+				float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine,
+				ITMLibSettings::PixelSelectionType pixelSelectionType = ITMLibSettings::PIXELSELECTION_ALL, int pixelSelectionStride = 1);
 			~ITMDepthTracker_CPU(void);
 		};
 	}
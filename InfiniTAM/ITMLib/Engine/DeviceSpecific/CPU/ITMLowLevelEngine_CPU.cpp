@@ -6,6 +6,45 @@
 
 using namespace ITMLib::Engine;
 
+// The row kernels below produce exactly the same results as the per-pixel
+// kernels in DeviceAgnostic/ITMLowLevelEngine.h, but work on whole rows of
+// interleaved channels without branches, so that the compiler can vectorise them.
+
+/// Sobel derivative along x for all channels of a row, @p stride is the number of channels per pixel
+static inline void gradientXRow(short *out, const uchar *above, const uchar *row, const uchar *below, int begin, int end, int stride)
+{
+	for (int i = begin; i < end; i++)
+	{
+		int d = (above[i + stride] - above[i - stride]) + 2 * (row[i + stride] - row[i - stride]) + (below[i + stride] - below[i - stride]);
+		out[i] = (short)(d / 8);
+	}
+}
+
+/// Sobel derivative along y for all channels of a row, @p stride is the number of channels per pixel
+static inline void gradientYRow(short *out, const uchar *above, const uchar *below, int begin, int end, int stride)
+{
+	for (int i = begin; i < end; i++)
+	{
+		int d = (below[i - stride] - above[i - stride]) + 2 * (below[i] - above[i]) + (below[i + stride] - above[i + stride]);
+		out[i] = (short)(d / 8);
+	}
+}
+
+/// The colour gradients carry the constant 2 * 255 derivative of the alpha channel, and zero at the image border
+static inline void finishColourGradientRow(Vector4s *grad, int y, Vector2i imgSize)
+{
+	Vector4s *row = grad + y * imgSize.x;
+
+	if (y == 0 || y == imgSize.y - 1)
+	{
+		for (int x = 0; x < imgSize.x; x++) row[x] = Vector4s((short)0);
+		return;
+	}
+
+	row[0] = Vector4s((short)0); row[imgSize.x - 1] = Vector4s((short)0);
+	for (int x = 1; x < imgSize.x - 1; x++) row[x].w = 255;
+}
+
 ITMLowLevelEngine_CPU::ITMLowLevelEngine_CPU(void) { }
 ITMLowLevelEngine_CPU::~ITMLowLevelEngine_CPU(void) { }
 
@@ -43,6 +82,9 @@ void ITMLowLevelEngine_CPU::FilterSubsample(ITMUChar4Image *image_out, const ITM
 	const Vector4u *imageData_in = image_in->GetData(MEMORYDEVICE_CPU);
 	Vector4u *imageData_out = image_out->GetData(MEMORYDEVICE_CPU);
 
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
 	for (int y = 0; y < newDims.y; y++) for (int x = 0; x < newDims.x; x++)
 		filterSubsample(imageData_out, x, y, newDims, imageData_in, oldDims);
 }
@@ -57,6 +99,9 @@ void ITMLowLevelEngine_CPU::FilterSubsampleWithHoles(ITMFloatImage *image_out, c
 	const float *imageData_in = image_in->GetData(MEMORYDEVICE_CPU);
 	float *imageData_out = image_out->GetData(MEMORYDEVICE_CPU);
 
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
 	for (int y = 0; y < newDims.y; y++) for (int x = 0; x < newDims.x; x++)
 		filterSubsampleWithHoles(imageData_out, x, y, newDims, imageData_in, oldDims);
 }
@@ -71,6 +116,9 @@ void ITMLowLevelEngine_CPU::FilterSubsampleWithHoles(ITMFloat4Image *image_out,
 	const Vector4f *imageData_in = image_in->GetData(MEMORYDEVICE_CPU);
 	Vector4f *imageData_out = image_out->GetData(MEMORYDEVICE_CPU);
 
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
 	for (int y = 0; y < newDims.y; y++) for (int x = 0; x < newDims.x; x++)
 		filterSubsampleWithHoles(imageData_out, x, y, newDims, imageData_in, oldDims);
 }
@@ -81,12 +129,22 @@ void ITMLowLevelEngine_CPU::GradientX(ITMShort4Image *grad_out, const ITMUChar4I
 	Vector2i imgSize = image_in->noDims;
 
 	Vector4s *grad = grad_out->GetData(MEMORYDEVICE_CPU);
-	const Vector4u *image = image_in->GetData(MEMORYDEVICE_CPU);
-
-	memset(grad, 0, imgSize.x * imgSize.y * sizeof(Vector3s));
-
-	for (int y = 1; y < imgSize.y - 1; y++) for (int x = 1; x < imgSize.x - 1; x++)
-		gradientX(grad, x, y, image, imgSize);
+	const uchar *image = (const uchar*)image_in->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < imgSize.y; y++)
+	{
+		if (y > 0 && y < imgSize.y - 1)
+		{
+			const uchar *above = image + 4 * (y - 1) * imgSize.x, *row = above + 4 * imgSize.x, *below = row + 4 * imgSize.x;
+			short *out = (short*)(grad + y * imgSize.x);
+			gradientXRow(out, above, row, below, 4, 4 * (imgSize.x - 1), 4);
+		}
+
+		finishColourGradientRow(grad, y, imgSize);
+	}
 }
 
 void ITMLowLevelEngine_CPU::GradientY(ITMShort4Image *grad_out, const ITMUChar4Image *image_in) const
@@ -95,10 +153,81 @@ void ITMLowLevelEngine_CPU::GradientY(ITMShort4Image *grad_out, const ITMUChar4I
 	Vector2i imgSize = image_in->noDims;
 
 	Vector4s *grad = grad_out->GetData(MEMORYDEVICE_CPU);
-	const Vector4u *image = image_in->GetData(MEMORYDEVICE_CPU);
+	const uchar *image = (const uchar*)image_in->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < imgSize.y; y++)
+	{
+		if (y > 0 && y < imgSize.y - 1)
+		{
+			const uchar *above = image + 4 * (y - 1) * imgSize.x, *row = above + 4 * imgSize.x, *below = row + 4 * imgSize.x;
+			short *out = (short*)(grad + y * imgSize.x);
+			gradientYRow(out, above, below, 4, 4 * (imgSize.x - 1), 4);
+		}
+
+		finishColourGradientRow(grad, y, imgSize);
+	}
+}
+
+void ITMLowLevelEngine_CPU::ConvertColourToIntensity(ITMUCharImage *image_out, const ITMUChar4Image *image_in) const
+{
+	Vector2i imgSize = image_in->noDims;
+	image_out->ChangeDims(imgSize);
 
-	memset(grad, 0, imgSize.x * imgSize.y * sizeof(Vector3s));
+	const Vector4u *imageData_in = image_in->GetData(MEMORYDEVICE_CPU);
+	uchar *imageData_out = image_out->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
+		convertColourToIntensity(imageData_out, x, y, imgSize, imageData_in);
+}
 
-	for (int y = 1; y < imgSize.y - 1; y++) for (int x = 1; x < imgSize.x - 1; x++)
-		gradientY(grad, x, y, image, imgSize);
-}
\ No newline at end of file
+void ITMLowLevelEngine_CPU::FilterSubsample(ITMUCharImage *image_out, const ITMUCharImage *image_in) const
+{
+	Vector2i oldDims = image_in->noDims;
+	Vector2i newDims; newDims.x = image_in->noDims.x / 2; newDims.y = image_in->noDims.y / 2;
+
+	image_out->ChangeDims(newDims);
+
+	const uchar *imageData_in = image_in->GetData(MEMORYDEVICE_CPU);
+	uchar *imageData_out = image_out->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < newDims.y; y++) for (int x = 0; x < newDims.x; x++)
+		filterSubsample(imageData_out, x, y, newDims, imageData_in, oldDims);
+}
+
+void ITMLowLevelEngine_CPU::Gradient(ITMShort2Image *grad_out, const ITMUCharImage *image_in) const
+{
+	grad_out->ChangeDims(image_in->noDims);
+	Vector2i imgSize = image_in->noDims;
+
+	Vector2s_ *grad = grad_out->GetData(MEMORYDEVICE_CPU);
+	const uchar *image = image_in->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < imgSize.y; y++)
+	{
+		short *out = (short*)(grad + y * imgSize.x);
+
+		if (y == 0 || y == imgSize.y - 1) { memset(out, 0, imgSize.x * sizeof(Vector2s)); continue; }
+
+		const uchar *above = image + (y - 1) * imgSize.x, *row = above + imgSize.x, *below = row + imgSize.x;
+		for (int x = 1; x < imgSize.x - 1; x++)
+		{
+			int d_x = (above[x + 1] - above[x - 1]) + 2 * (row[x + 1] - row[x - 1]) + (below[x + 1] - below[x - 1]);
+			int d_y = (below[x - 1] - above[x - 1]) + 2 * (below[x] - above[x]) + (below[x + 1] - above[x + 1]);
+			out[2 * x] = (short)(d_x / 8); out[2 * x + 1] = (short)(d_y / 8);
+		}
+
+		out[0] = out[1] = 0; out[2 * (imgSize.x - 1)] = out[2 * (imgSize.x - 1) + 1] = 0;
+	}
+}
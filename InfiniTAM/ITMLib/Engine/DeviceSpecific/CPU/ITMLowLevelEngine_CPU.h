@@ -22,6 +22,10 @@ namespace ITMLib
 			void GradientX(ITMShort4Image *grad_out, const ITMUChar4Image *image_in) const;
 			void GradientY(ITMShort4Image *grad_out, const ITMUChar4Image *image_in) const;
 
+			void ConvertColourToIntensity(ITMUCharImage *image_out, const ITMUChar4Image *image_in) const;
+			void FilterSubsample(ITMUCharImage *image_out, const ITMUCharImage *image_in) const;
+			void Gradient(ITMShort2Image *grad_out, const ITMUCharImage *image_in) const;
+
 			ITMLowLevelEngine_CPU(void);
 			~ITMLowLevelEngine_CPU(void);
 		};
@@ -5,6 +5,36 @@
 
 using namespace ITMLib::Engine;
 
+// number of hash entries whose neighbouring blocks are looked up together
+#define MESHING_BATCH_SIZE 4
+
+/** As findPointNeighbors, for the cube at @p localPos inside a block,
+    reading from the 2x2x2 blocks starting at that block, whose voxel
+    offsets are given in @p blockPtrs.
+*/
+template<class TVoxel>
+static inline bool findPointNeighbors(Vector3f *p, float *sdf, const Vector3i & globalPos, const Vector3i & localPos, const TVoxel *localVBA,
+	const int *blockPtrs)
+{
+	static const int cornerOffsets[8][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } };
+
+	for (int i = 0; i < 8; i++)
+	{
+		Vector3i pos = localPos + Vector3i(cornerOffsets[i][0], cornerOffsets[i][1], cornerOffsets[i][2]);
+		p[i] = (globalPos + pos).toFloat();
+
+		int bx = (pos.x >= SDF_BLOCK_SIZE) ? 1 : 0, by = (pos.y >= SDF_BLOCK_SIZE) ? 1 : 0, bz = (pos.z >= SDF_BLOCK_SIZE) ? 1 : 0;
+		int blockPtr = blockPtrs[bx + by * 2 + bz * 4];
+		if (blockPtr < 0) return false;
+
+		pos.x -= bx * SDF_BLOCK_SIZE; pos.y -= by * SDF_BLOCK_SIZE; pos.z -= bz * SDF_BLOCK_SIZE;
+		sdf[i] = TVoxel::SDF_valueToFloat(localVBA[blockPtr + voxelIndexInBlock(pos.x, pos.y, pos.z)].sdf);
+		if (sdf[i] == 1.0f) return false;
+	}
+
+	return true;
+}
+
 template<class TVoxel>
 ITMMeshingEngine_CPU<TVoxel,ITMVoxelBlockHash>::ITMMeshingEngine_CPU(void) 
 {
@@ -27,29 +57,44 @@ void ITMMeshingEngine_CPU<TVoxel, ITMVoxelBlockHash>::MeshScene(ITMMesh *mesh, c
 
 	mesh->triangles->Clear();
 
-	for (int entryId = 0; entryId < noTotalEntries; entryId++)
+	int entryId = 0;
+	while (entryId < noTotalEntries)
 	{
-		Vector3i globalPos;
-		const ITMHashEntry &currentHashEntry = hashTable[entryId];
+		// the 2x2x2 blocks starting at each allocated entry of a batch are looked up together
+		int batchEntryIds[MESHING_BATCH_SIZE], noBatchEntries = 0;
+		Vector3i blockPos[MESHING_BATCH_SIZE * 8]; int blockPtrs[MESHING_BATCH_SIZE * 8];
+
+		for (; entryId < noTotalEntries && noBatchEntries < MESHING_BATCH_SIZE; entryId++)
+		{
+			if (hashTable[entryId].ptr < 0) continue;
 
-		if (currentHashEntry.ptr < 0) continue;
+			for (int i = 0; i < 8; i++) blockPos[noBatchEntries * 8 + i] = hashTable[entryId].pos.toInt() + Vector3i(i & 1, (i >> 1) & 1, i >> 2);
+			batchEntryIds[noBatchEntries++] = entryId;
+		}
 
-		globalPos = currentHashEntry.pos.toInt() * SDF_BLOCK_SIZE;
+		findVoxelBlocks(blockPtrs, hashTable, blockPos, noBatchEntries * 8);
 
-		for (int z = 0; z < SDF_BLOCK_SIZE; z++) for (int y = 0; y < SDF_BLOCK_SIZE; y++) for (int x = 0; x < SDF_BLOCK_SIZE; x++)
+		for (int batchId = 0; batchId < noBatchEntries; batchId++)
 		{
-			Vector3f vertList[12];
-			int cubeIndex = buildVertList(vertList, globalPos, Vector3i(x, y, z), localVBA, hashTable);
-			
-			if (cubeIndex < 0) continue;
+			Vector3i globalPos = hashTable[batchEntryIds[batchId]].pos.toInt() * SDF_BLOCK_SIZE;
 
-			for (int i = 0; triangleTable[cubeIndex][i] != -1; i += 3)
+			for (int z = 0; z < SDF_BLOCK_SIZE; z++) for (int y = 0; y < SDF_BLOCK_SIZE; y++) for (int x = 0; x < SDF_BLOCK_SIZE; x++)
 			{
-				triangles[noTriangles].p0 = vertList[triangleTable[cubeIndex][i]] * factor;
-				triangles[noTriangles].p1 = vertList[triangleTable[cubeIndex][i + 1]] * factor;
-				triangles[noTriangles].p2 = vertList[triangleTable[cubeIndex][i + 2]] * factor;
+				Vector3f vertList[12], points[8]; float sdfVals[8];
+
+				if (!findPointNeighbors(points, sdfVals, globalPos, Vector3i(x, y, z), localVBA, blockPtrs + batchId * 8)) continue;
+
+				int cubeIndex = buildVertList(vertList, points, sdfVals);
+				if (cubeIndex < 0) continue;
+
+				for (int i = 0; triangleTable[cubeIndex][i] != -1; i += 3)
+				{
+					triangles[noTriangles].p0 = vertList[triangleTable[cubeIndex][i]] * factor;
+					triangles[noTriangles].p1 = vertList[triangleTable[cubeIndex][i + 1]] * factor;
+					triangles[noTriangles].p2 = vertList[triangleTable[cubeIndex][i + 2]] * factor;
 
-				if (noTriangles < noMaxTriangles - 1) noTriangles++;
+					if (noTriangles < noMaxTriangles - 1) noTriangles++;
+				}
 			}
 		}
 	}
@@ -6,10 +6,28 @@
 
 using namespace ITMLib::Engine;
 
+// number of points whose hash buckets are prefetched together before the points are evaluated
+#define RENTRACKER_BATCH_SIZE 16
+
+/// Prefetch the hash buckets of the voxels the points of a batch fall into
+template<class TIndexData>
+static inline void prefetchPoints(const Vector4f *ptList, const int *selectedPoints, int batchStart, int batchEnd, const TIndexData *index,
+	const Matrix4f & invM, float oneOverVoxelSize)
+{
+	for (int i = batchStart; i < batchEnd; i++)
+	{
+		Vector4f inpt = ptList[(selectedPoints != NULL) ? selectedPoints[i] : i];
+		if (inpt.w == -1.0f) continue;
+
+		Vector3f pt = TO_VECTOR3(invM * inpt) * oneOverVoxelSize;
+		prefetchVoxel(index, Vector3i((int)ROUND(pt.x), (int)ROUND(pt.y), (int)ROUND(pt.z)));
+	}
+}
 
 template<class TVoxel, class TIndex>
-ITMLib::Engine::ITMRenTracker_CPU<TVoxel, TIndex>::ITMRenTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, const ITMLowLevelEngine *lowLevelEngine, const ITMScene<TVoxel, TIndex> *scene)
-	: ITMRenTracker<TVoxel, TIndex>(imgSize, trackingRegime, noHierarchyLevels, lowLevelEngine, scene, MEMORYDEVICE_CPU){}
+ITMLib::Engine::ITMRenTracker_CPU<TVoxel, TIndex>::ITMRenTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, const ITMLowLevelEngine *lowLevelEngine, const ITMScene<TVoxel, TIndex> *scene,
+	ITMLibSettings::PixelSelectionType pixelSelectionType, int pixelSelectionStride)
+	: ITMRenTracker<TVoxel, TIndex>(imgSize, trackingRegime, noHierarchyLevels, lowLevelEngine, scene, MEMORYDEVICE_CPU, pixelSelectionType, pixelSelectionStride){}
 
 template<class TVoxel, class TIndex>
 ITMRenTracker_CPU<TVoxel,TIndex>::~ITMRenTracker_CPU(void) { }
@@ -26,10 +44,20 @@ void ITMRenTracker_CPU<TVoxel,TIndex>::F_oneLevel(float *f, Matrix4f invM)
 
 	float energy = 0;
 
-	for (int i = 0; i < count; i++)
+	const ITMSelectionHierarchyLevel *selection = (this->selectionHierarchy != NULL) ? this->selectionHierarchy->levels[this->levelId] : NULL;
+	if (selection != NULL) count = selection->noSelected;
+	const int *selectedPoints = (selection != NULL) ? selection->indices->GetData(MEMORYDEVICE_CPU) : NULL;
+
+	for (int batchStart = 0; batchStart < count; batchStart += RENTRACKER_BATCH_SIZE)
 	{
-		Vector4f inpt = ptList[i];
-		if (inpt.w > -1.0f) energy += computePerPixelEnergy<TVoxel,TIndex>(inpt, voxelBlocks, index, oneOverVoxelSize, invM);
+		int batchEnd = MIN(batchStart + RENTRACKER_BATCH_SIZE, count);
+		prefetchPoints(ptList, selectedPoints, batchStart, batchEnd, index, invM, oneOverVoxelSize);
+
+		for (int i = batchStart; i < batchEnd; i++)
+		{
+			Vector4f inpt = ptList[(selectedPoints != NULL) ? selectedPoints[i] : i];
+			if (inpt.w > -1.0f) energy += computePerPixelEnergy<TVoxel,TIndex>(inpt, voxelBlocks, index, oneOverVoxelSize, invM);
+		}
 	}
 
 	f[0] = -energy;
@@ -51,19 +79,29 @@ void ITMRenTracker_CPU<TVoxel,TIndex>::G_oneLevel(float *gradient, float *hessia
 	for (int i = 0; i < noPara; i++) globalGradient[i] = 0.0f;
 	for (int i = 0; i < noParaSQ; i++) globalHessian[i] = 0.0f;
 
-	for (int i = 0; i < count; i++)
-	{
-		Vector4f cPt = ptList[i];
-		if (cPt.w == -1.0f) continue;
+	const ITMSelectionHierarchyLevel *selection = (this->selectionHierarchy != NULL) ? this->selectionHierarchy->levels[this->levelId] : NULL;
+	if (selection != NULL) count = selection->noSelected;
+	const int *selectedPoints = (selection != NULL) ? selection->indices->GetData(MEMORYDEVICE_CPU) : NULL;
 
-		float jacobian[6];
+	for (int batchStart = 0; batchStart < count; batchStart += RENTRACKER_BATCH_SIZE)
+	{
+		int batchEnd = MIN(batchStart + RENTRACKER_BATCH_SIZE, count);
+		prefetchPoints(ptList, selectedPoints, batchStart, batchEnd, index, invM, oneOverVoxelSize);
 
-		if (computePerPixelJacobian<TVoxel,TIndex>(jacobian, cPt, voxelBlocks, index, oneOverVoxelSize, invM))
+		for (int i = batchStart; i < batchEnd; i++)
 		{
-			for (int r = 0, counter = 0; r < noPara; r++)
+			Vector4f cPt = ptList[(selectedPoints != NULL) ? selectedPoints[i] : i];
+			if (cPt.w == -1.0f) continue;
+
+			float jacobian[6];
+
+			if (computePerPixelJacobian<TVoxel,TIndex>(jacobian, cPt, voxelBlocks, index, oneOverVoxelSize, invM))
 			{
-				globalGradient[r] -= jacobian[r];
-				for (int c = 0; c <= r; c++, counter++) globalHessian[counter] += jacobian[r] * jacobian[c];
+				for (int r = 0, counter = 0; r < noPara; r++)
+				{
+					globalGradient[r] -= jacobian[r];
+					for (int c = 0; c <= r; c++, counter++) globalHessian[counter] += jacobian[r] * jacobian[c];
+				}
 			}
 		}
 	}
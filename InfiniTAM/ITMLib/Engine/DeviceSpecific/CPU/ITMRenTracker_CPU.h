@@ -20,7 +20,8 @@ namespace ITMLib
 		public:
 			
 			ITMRenTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, const ITMLowLevelEngine *lowLevelEngine,
-				const ITMScene<TVoxel, TIndex> *scene);
+				const ITMScene<TVoxel, TIndex> *scene, ITMLibSettings::PixelSelectionType pixelSelectionType = ITMLibSettings::PIXELSELECTION_ALL,
+				int pixelSelectionStride = 1);
 
 			~ITMRenTracker_CPU(void);
 		};
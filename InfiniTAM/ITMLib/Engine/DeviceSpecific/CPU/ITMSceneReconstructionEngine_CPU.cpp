@@ -2,16 +2,29 @@
 
 #include "ITMSceneReconstructionEngine_CPU.h"
 #include "../../DeviceAgnostic/ITMSceneReconstructionEngine.h"
-#include "../../../Objects/ITMRenderState_VH.h"
+
+#include <vector>
 
 using namespace ITMLib::Engine;
 
+// number of depth pixels whose hash buckets are prefetched together when allocating
+#define ALLOCATION_BATCH_SIZE 16
+
+/// A voxel block in use and its key on the Morton curve, see DefragmentVoxelBlocks()
+struct MortonOrderedBlock
+{
+	unsigned long long code;
+	int entryId;
+
+	bool operator<(const MortonOrderedBlock &other) const { return code < other.code; }
+};
+
 template<class TVoxel>
 ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>::ITMSceneReconstructionEngine_CPU(void) 
 {
-	int noTotalEntries = ITMVoxelBlockHash::noTotalEntries;
-	entriesAllocType = new ORUtils::MemoryBlock<unsigned char>(noTotalEntries, MEMORYDEVICE_CPU);
-	blockCoords = new ORUtils::MemoryBlock<Vector4s>(noTotalEntries, MEMORYDEVICE_CPU);
+	// sized for the hash table of the scene on first use
+	entriesAllocType = new ORUtils::MemoryBlock<unsigned char>(0, MEMORYDEVICE_CPU);
+	blockCoords = new ORUtils::MemoryBlock<Vector4s>(0, MEMORYDEVICE_CPU);
 }
 
 template<class TVoxel>
@@ -25,23 +38,119 @@ template<class TVoxel>
 void ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>::ResetScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene)
 {
 	int numBlocks = scene->index.getNumAllocatedVoxelBlocks();
-	int blockSize = scene->index.getVoxelBlockSize();
 
-	TVoxel *voxelBlocks_ptr = scene->localVBA.GetVoxelBlocks();
-	for (int i = 0; i < numBlocks * blockSize; ++i) voxelBlocks_ptr[i] = TVoxel();
+	//the voxel blocks are initialised when they are taken from the free list, which hands out the lowest blocks first
 	int *vbaAllocationList_ptr = scene->localVBA.GetAllocationList();
-	for (int i = 0; i < numBlocks; ++i) vbaAllocationList_ptr[i] = i;
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int i = 0; i < numBlocks; ++i) vbaAllocationList_ptr[i] = numBlocks - 1 - i;
 	scene->localVBA.lastFreeBlockId = numBlocks - 1;
 
 	ITMHashEntry tmpEntry;
 	memset(&tmpEntry, 0, sizeof(ITMHashEntry));
 	tmpEntry.ptr = -2;
 	ITMHashEntry *hashEntry_ptr = scene->index.GetEntries();
-	for (int i = 0; i < scene->index.noTotalEntries; ++i) hashEntry_ptr[i] = tmpEntry;
+	int noTotalEntries = scene->index.noTotalEntries;
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int i = 0; i < noTotalEntries; ++i) hashEntry_ptr[i] = tmpEntry;
+	int noExcessEntries = scene->index.GetNoExcessEntries();
 	int *excessList_ptr = scene->index.GetExcessAllocationList();
-	for (int i = 0; i < SDF_EXCESS_LIST_SIZE; ++i) excessList_ptr[i] = i;
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int i = 0; i < noExcessEntries; ++i) excessList_ptr[i] = i;
+	memset(scene->index.GetBlockOccupancy(), 0, SDF_SUPERBLOCK_LEVELS * SDF_OCCUPANCY_NUM * sizeof(int));
+	memset(scene->index.GetBlockFilter(), 0, scene->index.GetNoFilterLines() * SDF_FILTER_LINE_WORDS * sizeof(uint));
+	scene->index.SetNoFilterRemovals(0);
+	scene->index.SetNoDroppedAllocations(0);
 
-	scene->index.SetLastFreeExcessListId(SDF_EXCESS_LIST_SIZE - 1);
+	scene->index.SetLastFreeExcessListId(noExcessEntries - 1);
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::ReserveAllocationEntries(int noTotalEntries)
+{
+	if (entriesAllocType->dataSize >= (size_t)noTotalEntries) return;
+
+	delete entriesAllocType;
+	delete blockCoords;
+	entriesAllocType = new ORUtils::MemoryBlock<unsigned char>(noTotalEntries, MEMORYDEVICE_CPU);
+	blockCoords = new ORUtils::MemoryBlock<Vector4s>(noTotalEntries, MEMORYDEVICE_CPU);
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::ResizeHashTable(ITMScene<TVoxel, ITMVoxelBlockHash> *scene,
+	ITMRenderState_VH *renderState_vh, int noOrderedEntries, int noExcessEntries)
+{
+	int oldNoTotalEntries = scene->index.noTotalEntries, noEntriesPerBucket = scene->index.GetNoEntriesPerBucket();
+
+	ORUtils::MemoryBlock<ITMHashEntry> oldEntries(oldNoTotalEntries, MEMORYDEVICE_CPU);
+	ORUtils::MemoryBlock<int> newEntryIds(oldNoTotalEntries, MEMORYDEVICE_CPU);
+	const ITMHashEntry *oldHashTable = oldEntries.GetData(MEMORYDEVICE_CPU);
+	int *newIds = newEntryIds.GetData(MEMORYDEVICE_CPU);
+
+	memcpy(oldEntries.GetData(MEMORYDEVICE_CPU), scene->index.GetEntries(), oldNoTotalEntries * sizeof(ITMHashEntry));
+
+	scene->index.Resize(noOrderedEntries, noExcessEntries);
+
+	ITMHashEntry *hashTable = scene->index.GetEntries();
+	int *excessAllocationList = scene->index.GetExcessAllocationList();
+
+	ITMHashEntry tmpEntry;
+	tmpEntry.pos.x = tmpEntry.pos.y = tmpEntry.pos.z = 0;
+	tmpEntry.offset = 0; tmpEntry.ptr = -2;
+	for (int i = 0; i < scene->index.noTotalEntries; ++i) hashTable[i] = tmpEntry;
+	for (int i = 0; i < noExcessEntries; ++i) excessAllocationList[i] = i;
+	int lastFreeExcessListId = noExcessEntries - 1;
+
+	for (int oldIdx = 0; oldIdx < oldNoTotalEntries; oldIdx++)
+	{
+		ITMHashEntry hashEntry = oldHashTable[oldIdx];
+		newIds[oldIdx] = -1;
+		if (hashEntry.ptr < -1) continue;
+
+		int hashIdx = hashIndex(hashEntry.pos, noOrderedEntries, noEntriesPerBucket), entryId = 0;
+		while (entryId < noEntriesPerBucket && hashTable[hashIdx + entryId].ptr >= -1) entryId++;
+
+		if (entryId < noEntriesPerBucket) hashIdx += entryId;
+		else
+		{
+			//append to the excess list hanging off the last entry of the full bucket
+			if (lastFreeExcessListId < 0) DIEWITHEXCEPTION("Excess list too small to rehash the voxel block hash");
+
+			hashIdx += noEntriesPerBucket - 1;
+			while (hashTable[hashIdx].offset >= 1) hashIdx = noOrderedEntries + hashTable[hashIdx].offset - 1;
+
+			int exlOffset = excessAllocationList[lastFreeExcessListId]; lastFreeExcessListId--;
+			hashTable[hashIdx].offset = exlOffset + 1;
+			hashIdx = noOrderedEntries + exlOffset;
+		}
+
+		hashEntry.offset = 0;
+		hashTable[hashIdx] = hashEntry;
+		newIds[oldIdx] = hashIdx;
+	}
+
+	scene->index.SetLastFreeExcessListId(lastFreeExcessListId);
+
+	//the block filter has been reallocated along with the entries and is sized for the new table
+	rebuildBlockFilter(&scene->index);
+	scene->index.SetNoFilterRemovals(0);
+
+	//the visible list refers to entries, the visibility types are rebuilt from it by the next allocation
+	int *visibleEntryIDs = renderState_vh->GetVisibleEntryIDs();
+	int noVisibleEntries = 0;
+	for (int i = 0; i < renderState_vh->noVisibleEntries; i++)
+	{
+		int newIdx = newIds[visibleEntryIDs[i]];
+		if (newIdx >= 0) visibleEntryIDs[noVisibleEntries++] = newIdx;
+	}
+
+	renderState_vh->noVisibleEntries = noVisibleEntries;
+	renderState_vh->ResizeEntriesVisibleType(scene->index.noTotalEntries);
 }
 
 template<class TVoxel>
@@ -97,7 +206,7 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::IntegrateIntoS
 		{
 			Vector4f pt_model; int locId;
 
-			locId = x + y * SDF_BLOCK_SIZE + z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+			locId = voxelIndexInBlock(x, y, z);
 
 			if (stopIntegratingAtMaxW) if (localVoxelBlock[locId].w_depth == maxW) continue;
 			//if (approximateIntegration) if (localVoxelBlock[locId].w_depth != 0) continue;
@@ -125,6 +234,17 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 
 	ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState;
 
+	//rehash into a larger table once it gets too full, which the global cache of swapping cannot follow
+	if (!onlyUpdateVisibleList && !scene->useSwapping)
+	{
+		int noAllocatedBlocks = scene->index.getNumAllocatedVoxelBlocks() - 1 - scene->localVBA.lastFreeBlockId;
+		int noUsedExcessEntries = scene->index.GetNoExcessEntries() - 1 - scene->index.GetLastFreeExcessListId();
+
+		if (noAllocatedBlocks > scene->sceneParams->maxHashLoad * scene->index.GetNoOrderedEntries() ||
+			noUsedExcessEntries > scene->sceneParams->maxExcessLoad * scene->index.GetNoExcessEntries())
+			ResizeHashTable(scene, renderState_vh, 2 * scene->index.GetNoOrderedEntries(), 2 * scene->index.GetNoExcessEntries());
+	}
+
 	M_d = trackingState->pose_d->GetM(); M_d.inv(invM_d);
 
 	projParams_d = view->calib->intrinsics_d.projectionParamsSimple.all;
@@ -134,16 +254,21 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 
 	float mu = scene->sceneParams->mu;
 
+	ReserveAllocationEntries(scene->index.noTotalEntries);
+
 	float *depth = view->depth->GetData(MEMORYDEVICE_CPU);
+	TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
 	int *voxelAllocationList = scene->localVBA.GetAllocationList();
 	int *excessAllocationList = scene->index.GetExcessAllocationList();
 	ITMHashEntry *hashTable = scene->index.GetEntries();
+	int *blockOccupancy = scene->index.GetBlockOccupancy();
 	ITMHashSwapState *swapStates = scene->useSwapping ? scene->globalCache->GetSwapStates(false) : 0;
 	int *visibleEntryIDs = renderState_vh->GetVisibleEntryIDs();
 	uchar *entriesVisibleType = renderState_vh->GetEntriesVisibleType();
 	uchar *entriesAllocType = this->entriesAllocType->GetData(MEMORYDEVICE_CPU);
 	Vector4s *blockCoords = this->blockCoords->GetData(MEMORYDEVICE_CPU);
-	int noTotalEntries = scene->index.noTotalEntries;
+	int noTotalEntries = scene->index.noTotalEntries, noOrderedEntries = scene->index.GetNoOrderedEntries();
+	int noEntriesPerBucket = scene->index.GetNoEntriesPerBucket();
 
 	bool useSwapping = scene->useSwapping;
 
@@ -151,6 +276,7 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 
 	int lastFreeVoxelBlockId = scene->localVBA.lastFreeBlockId;
 	int lastFreeExcessListId = scene->index.GetLastFreeExcessListId();
+	int noDroppedAllocations = 0;
 
 	int noVisibleEntries = 0;
 
@@ -159,23 +285,38 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 	for (int i = 0; i < renderState_vh->noVisibleEntries; i++)
 		entriesVisibleType[visibleEntryIDs[i]] = 3; // visible at previous frame and unstreamed
 
-	//build hashVisibility
+	//build hashVisibility, prefetching the hash buckets of a batch of pixels before any of them is searched
+	int noPixels = depthImgSize.x * depthImgSize.y;
 #ifdef WITH_OPENMP
 	#pragma omp parallel for
 #endif
-	for (int locId = 0; locId < depthImgSize.x*depthImgSize.y; locId++)
+	for (int batchStart = 0; batchStart < noPixels; batchStart += ALLOCATION_BATCH_SIZE)
 	{
-		int y = locId / depthImgSize.x;
-		int x = locId - y * depthImgSize.x;
-		buildHashAllocAndVisibleTypePP(entriesAllocType, entriesVisibleType, x, y, blockCoords, depth, invM_d,
-			invProjParams_d, mu, depthImgSize, oneOverVoxelSize, hashTable, scene->sceneParams->viewFrustum_min,
-			scene->sceneParams->viewFrustum_max);
+		Vector3f points[ALLOCATION_BATCH_SIZE], directions[ALLOCATION_BATCH_SIZE];
+		int noSteps[ALLOCATION_BATCH_SIZE];
+		int batchSize = MIN(noPixels - batchStart, ALLOCATION_BATCH_SIZE);
+
+		for (int i = 0; i < batchSize; i++)
+		{
+			int y = (batchStart + i) / depthImgSize.x;
+			int x = (batchStart + i) - y * depthImgSize.x;
+			noSteps[i] = computeAllocationSegment(points[i], directions[i], x, y, depth, invM_d, invProjParams_d, mu, depthImgSize,
+				oneOverVoxelSize, scene->sceneParams->viewFrustum_min, scene->sceneParams->viewFrustum_max);
+
+			Vector3f point = points[i];
+			for (int stepId = 0; stepId < noSteps[i]; stepId++, point += directions[i])
+				PREFETCH_READ(hashTable + hashIndex(TO_SHORT_FLOOR3(point), noOrderedEntries, noEntriesPerBucket));
+		}
+
+		for (int i = 0; i < batchSize; i++)
+			buildHashAllocAndVisibleTypeSegment(entriesAllocType, entriesVisibleType, blockCoords, points[i], directions[i], noSteps[i], hashTable);
 	}
 
 	if (onlyUpdateVisibleList) useSwapping = false;
 	if (!onlyUpdateVisibleList)
 	{
 		//allocate
+		//only take a voxel block and excess list entry if the allocation succeeds, and count the ones that cannot
 		for (int targetIdx = 0; targetIdx < noTotalEntries; targetIdx++)
 		{
 			int vbaIdx, exlIdx;
@@ -184,42 +325,54 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 			switch (hashChangeType)
 			{
 			case 1: //needs allocation, fits in the ordered list
-				vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
-
-				if (vbaIdx >= 0) //there is room in the voxel block array
+				if (lastFreeVoxelBlockId >= 0) //there is room in the voxel block array
 				{
+					vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
+
 					Vector4s pt_block_all = blockCoords[targetIdx];
 
 					ITMHashEntry hashEntry;
 					hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
 					hashEntry.ptr = voxelAllocationList[vbaIdx];
-					hashEntry.offset = 0;
+					resetVoxelBlock(localVBA + hashEntry.ptr * SDF_BLOCK_SIZE3);
+					hashEntry.offset = hashTable[targetIdx].offset; //a freed entry may still lead to the excess list
 
 					hashTable[targetIdx] = hashEntry;
+					updateBlockOccupancy(blockOccupancy, hashEntry.pos, 1);
+					markBlockInFilter(hashTable, hashEntry.pos);
+				}
+				else
+				{
+					entriesVisibleType[targetIdx] = 0; //the entry stays free, so it must not reach the visible list
+					noDroppedAllocations++;
 				}
 
 				break;
 			case 2: //needs allocation in the excess list
-				vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
-				exlIdx = lastFreeExcessListId; lastFreeExcessListId--;
-
-				if (vbaIdx >= 0 && exlIdx >= 0) //there is room in the voxel block array and excess list
+				if (lastFreeVoxelBlockId >= 0 && lastFreeExcessListId >= 0) //there is room in the voxel block array and excess list
 				{
+					vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
+					exlIdx = lastFreeExcessListId; lastFreeExcessListId--;
+
 					Vector4s pt_block_all = blockCoords[targetIdx];
 
 					ITMHashEntry hashEntry;
 					hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
 					hashEntry.ptr = voxelAllocationList[vbaIdx];
+					resetVoxelBlock(localVBA + hashEntry.ptr * SDF_BLOCK_SIZE3);
 					hashEntry.offset = 0;
 
 					int exlOffset = excessAllocationList[exlIdx];
 
 					hashTable[targetIdx].offset = exlOffset + 1; //connect to child
 
-					hashTable[SDF_BUCKET_NUM + exlOffset] = hashEntry; //add child to the excess list
+					hashTable[noOrderedEntries + exlOffset] = hashEntry; //add child to the excess list
+					updateBlockOccupancy(blockOccupancy, hashEntry.pos, 1);
+					markBlockInFilter(hashTable, hashEntry.pos);
 
-					entriesVisibleType[SDF_BUCKET_NUM + exlOffset] = 1; //make child visible and in memory
+					entriesVisibleType[noOrderedEntries + exlOffset] = 1; //make child visible and in memory
 				}
+				else noDroppedAllocations++;
 
 				break;
 			}
@@ -278,16 +431,167 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 
 			if (entriesVisibleType[targetIdx] > 0 && hashEntry.ptr == -1) 
 			{
-				vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
-				if (vbaIdx >= 0) hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+				if (lastFreeVoxelBlockId >= 0)
+				{
+					vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
+					hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+					resetVoxelBlock(localVBA + hashTable[targetIdx].ptr * SDF_BLOCK_SIZE3);
+					updateBlockOccupancy(blockOccupancy, hashEntry.pos, 1);
+					markBlockInFilter(hashTable, hashEntry.pos);
+				}
+				else noDroppedAllocations++;
 			}
 		}
 	}
 
+	//integrate in the order of the voxel block array
+	sortVisibleEntriesByPtr(visibleEntryIDs, noVisibleEntries, hashTable);
 	renderState_vh->noVisibleEntries = noVisibleEntries;
 
 	scene->localVBA.lastFreeBlockId = lastFreeVoxelBlockId;
 	scene->index.SetLastFreeExcessListId(lastFreeExcessListId);
+	scene->index.SetNoDroppedAllocations(scene->index.GetNoDroppedAllocations() + noDroppedAllocations);
+
+	checkBlockOccupancy(&scene->index);
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::CollectGarbage(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMRenderState *renderState,
+	float minSdf, int maxW)
+{
+	//the global cache addresses swapped out blocks by their hash entry, so entries must not be reused behind its back
+	if (scene->useSwapping) return;
+
+	ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState;
+
+	ReserveAllocationEntries(scene->index.noTotalEntries);
+
+	const TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
+	int *voxelAllocationList = scene->localVBA.GetAllocationList();
+	int *excessAllocationList = scene->index.GetExcessAllocationList();
+	ITMHashEntry *hashTable = scene->index.GetEntries();
+	int *blockOccupancy = scene->index.GetBlockOccupancy();
+	const uchar *entriesVisibleType = renderState_vh->GetEntriesVisibleType();
+	uchar *isGarbage = this->entriesAllocType->GetData(MEMORYDEVICE_CPU);
+	int noTotalEntries = scene->index.noTotalEntries, noOrderedEntries = scene->index.GetNoOrderedEntries();
+	int noEntriesPerBucket = scene->index.GetNoEntriesPerBucket();
+
+	//find the garbage in parallel, blocks in view are kept as they would only be allocated again for the next frame
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int entryId = 0; entryId < noTotalEntries; entryId++)
+	{
+		const ITMHashEntry &hashEntry = hashTable[entryId];
+		isGarbage[entryId] = hashEntry.ptr >= 0 && entriesVisibleType[entryId] == 0 &&
+			isBlockGarbage(localVBA + hashEntry.ptr * SDF_BLOCK_SIZE3, minSdf, maxW);
+	}
+
+	int lastFreeVoxelBlockId = scene->localVBA.lastFreeBlockId;
+	int lastFreeExcessListId = scene->index.GetLastFreeExcessListId();
+	int noRemovedEntries = 0;
+
+	//release the blocks and unlink them from the hash table
+	for (int entryId = 0; entryId < noTotalEntries; entryId++)
+	{
+		if (!isGarbage[entryId]) continue;
+
+		ITMHashEntry &hashEntry = hashTable[entryId];
+
+		lastFreeVoxelBlockId++;
+		voxelAllocationList[lastFreeVoxelBlockId] = hashEntry.ptr;
+		updateBlockOccupancy(blockOccupancy, hashEntry.pos, -1);
+
+		if (entryId >= noOrderedEntries)
+		{
+			//the excess list hangs off the last entry of the bucket
+			int prevIdx = hashIndex(hashEntry.pos, noOrderedEntries, noEntriesPerBucket) + noEntriesPerBucket - 1;
+			while (noOrderedEntries + hashTable[prevIdx].offset - 1 != entryId) prevIdx = noOrderedEntries + hashTable[prevIdx].offset - 1;
+
+			hashTable[prevIdx].offset = hashEntry.offset;
+			hashEntry.offset = 0;
+
+			lastFreeExcessListId++;
+			excessAllocationList[lastFreeExcessListId] = entryId - noOrderedEntries;
+		}
+
+		//a freed ordered entry keeps its offset, as it may still lead to the excess list
+		hashEntry.ptr = -2;
+		noRemovedEntries++;
+	}
+
+	scene->localVBA.lastFreeBlockId = lastFreeVoxelBlockId;
+	scene->index.SetLastFreeExcessListId(lastFreeExcessListId);
+
+	// the block filter only loses the removed blocks when it is rebuilt
+	int noFilterRemovals = scene->index.GetNoFilterRemovals() + noRemovedEntries;
+	if (noFilterRemovals >= SDF_FILTER_REBUILD_REMOVALS)
+	{
+		rebuildBlockFilter(&scene->index);
+		noFilterRemovals = 0;
+	}
+	scene->index.SetNoFilterRemovals(noFilterRemovals);
+
+	checkBlockOccupancy(&scene->index);
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::DefragmentVoxelBlocks(ITMScene<TVoxel, ITMVoxelBlockHash> *scene,
+	const ITMRenderState *renderState)
+{
+	ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState;
+
+	TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
+	int *voxelAllocationList = scene->localVBA.GetAllocationList();
+	ITMHashEntry *hashTable = scene->index.GetEntries();
+	int noTotalEntries = scene->index.noTotalEntries, numBlocks = scene->index.getNumAllocatedVoxelBlocks();
+
+	std::vector<MortonOrderedBlock> blocks;
+	blocks.reserve(numBlocks - 1 - scene->localVBA.lastFreeBlockId);
+	for (int entryId = 0; entryId < noTotalEntries; entryId++)
+	{
+		if (hashTable[entryId].ptr < 0) continue;
+
+		MortonOrderedBlock block;
+		block.code = blockMortonCode(hashTable[entryId].pos); block.entryId = entryId;
+		blocks.push_back(block);
+	}
+
+	std::sort(blocks.begin(), blocks.end());
+
+	int noBlocks = (int)blocks.size();
+
+	bool isOrdered = true;
+	for (int blockId = 0; blockId < noBlocks && isOrdered; blockId++) isOrdered = hashTable[blocks[blockId].entryId].ptr == blockId;
+	if (isOrdered) return;
+
+	//gather the blocks in their new order, then copy them back to the start of the array
+	TVoxel *orderedBlocks = (TVoxel*)malloc((size_t)noBlocks * SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+	if (orderedBlocks == NULL) return;
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int blockId = 0; blockId < noBlocks; blockId++)
+		memcpy(orderedBlocks + blockId * SDF_BLOCK_SIZE3, localVBA + hashTable[blocks[blockId].entryId].ptr * SDF_BLOCK_SIZE3, SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int blockId = 0; blockId < noBlocks; blockId++)
+	{
+		memcpy(localVBA + blockId * SDF_BLOCK_SIZE3, orderedBlocks + blockId * SDF_BLOCK_SIZE3, SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+		hashTable[blocks[blockId].entryId].ptr = blockId;
+	}
+
+	free(orderedBlocks);
+
+	//all remaining blocks are free, again handing out the lowest first
+	int noFreeBlocks = numBlocks - noBlocks;
+	for (int i = 0; i < noFreeBlocks; i++) voxelAllocationList[i] = numBlocks - 1 - i;
+	scene->localVBA.lastFreeBlockId = noFreeBlocks - 1;
+
+	sortVisibleEntriesByPtr(renderState_vh->GetVisibleEntryIDs(), renderState_vh->noVisibleEntries, hashTable);
 }
 
 template<class TVoxel>
@@ -304,8 +608,12 @@ void ITMSceneReconstructionEngine_CPU<TVoxel,ITMPlainVoxelArray>::ResetScene(ITM
 	int numBlocks = scene->index.getNumAllocatedVoxelBlocks();
 	int blockSize = scene->index.getVoxelBlockSize();
 
+	int noVoxels = numBlocks * blockSize;
 	TVoxel *voxelBlocks_ptr = scene->localVBA.GetVoxelBlocks();
-	for (int i = 0; i < numBlocks * blockSize; ++i) voxelBlocks_ptr[i] = TVoxel();
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int i = 0; i < noVoxels; ++i) voxelBlocks_ptr[i] = TVoxel();
 	int *vbaAllocationList_ptr = scene->localVBA.GetAllocationList();
 	for (int i = 0; i < numBlocks; ++i) vbaAllocationList_ptr[i] = i;
 	scene->localVBA.lastFreeBlockId = numBlocks - 1;
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "../../ITMSceneReconstructionEngine.h"
+#include "../../../Objects/ITMRenderState_VH.h"
 
 namespace ITMLib
 {
@@ -19,6 +20,15 @@ namespace ITMLib
 			ORUtils::MemoryBlock<unsigned char> *entriesAllocType;
 			ORUtils::MemoryBlock<Vector4s> *blockCoords;
 
+			/// Grow entriesAllocType and blockCoords to hold a hash table with @p noTotalEntries entries
+			void ReserveAllocationEntries(int noTotalEntries);
+
+			/** Rehash all entries in use into a table of the given
+			size and carry the visible list of @p renderState_vh
+			over to the new entries.
+			*/
+			void ResizeHashTable(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState_VH *renderState_vh, int noOrderedEntries, int noExcessEntries);
+
 		public:
 			void ResetScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene);
 
@@ -28,6 +38,10 @@ namespace ITMLib
 			void IntegrateIntoScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMView *view, const ITMTrackingState *trackingState,
 				const ITMRenderState *renderState);
 
+			void CollectGarbage(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMRenderState *renderState, float minSdf, int maxW);
+
+			void DefragmentVoxelBlocks(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMRenderState *renderState);
+
 			ITMSceneReconstructionEngine_CPU(void);
 			~ITMSceneReconstructionEngine_CPU(void);
 		};
@@ -2,6 +2,7 @@
 
 #include "ITMSwappingEngine_CPU.h"
 #include "../../DeviceAgnostic/ITMSwappingEngine.h"
+#include "../../DeviceAgnostic/ITMRepresentationAccess.h"
 #include "../../../Objects/ITMRenderState_VH.h"
 
 using namespace ITMLib::Engine;
@@ -111,6 +112,7 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::SaveToGlobalMemory(ITMSce
 	ITMHashSwapState *swapStates = globalCache->GetSwapStates(false);
 
 	ITMHashEntry *hashTable = scene->index.GetEntries();
+	int *blockOccupancy = scene->index.GetBlockOccupancy();
 	uchar *entriesVisibleType = ((ITMRenderState_VH*)renderState)->GetEntriesVisibleType();
 
 	TVoxel *syncedVoxelBlocks_local = globalCache->GetSyncedVoxelBlocks(false);
@@ -126,8 +128,9 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::SaveToGlobalMemory(ITMSce
 
 	int noTotalEntries = globalCache->noTotalEntries;
 	
-	int noNeededEntries = 0;
+	int noNeededEntries = 0, noRemovedEntries = 0;
 	int noAllocatedVoxelEntries = scene->localVBA.lastFreeBlockId;
+	int noVoxelBlocks = scene->index.getNumAllocatedVoxelBlocks();
 
 	for (int entryDestId = 0; entryDestId < noTotalEntries; entryDestId++)
 	{
@@ -148,13 +151,13 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::SaveToGlobalMemory(ITMSce
 			swapStates[entryDestId].state = 0;
 
 			int vbaIdx = noAllocatedVoxelEntries;
-			if (vbaIdx < SDF_BUCKET_NUM - 1)
+			if (vbaIdx < noVoxelBlocks - 1)
 			{
 				noAllocatedVoxelEntries++;
 				voxelAllocationList[vbaIdx + 1] = localPtr;
 				hashTable[entryDestId].ptr = -1;
-
-				for (int i = 0; i < SDF_BLOCK_SIZE3; i++) localVBALocation[i] = TVoxel();
+				updateBlockOccupancy(blockOccupancy, hashTable[entryDestId].pos, -1);
+				noRemovedEntries++;
 			}
 
 			noNeededEntries++;
@@ -163,6 +166,16 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::SaveToGlobalMemory(ITMSce
 
 	scene->localVBA.lastFreeBlockId = noAllocatedVoxelEntries;
 
+	// the block filter only loses the removed blocks when it is rebuilt
+	int noFilterRemovals = scene->index.GetNoFilterRemovals() + noRemovedEntries;
+	if (noFilterRemovals >= SDF_FILTER_REBUILD_REMOVALS)
+	{
+		rebuildBlockFilter(&scene->index);
+		noFilterRemovals = 0;
+	}
+	scene->index.SetNoFilterRemovals(noFilterRemovals);
+	checkBlockOccupancy(&scene->index);
+
 	// would copy neededEntryIDs_local, hasSyncedData_local and syncedVoxelBlocks_local into *_global here
 
 	if (noNeededEntries > 0)
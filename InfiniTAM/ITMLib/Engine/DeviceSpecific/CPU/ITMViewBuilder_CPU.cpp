@@ -3,21 +3,100 @@
 #include "ITMViewBuilder_CPU.h"
 
 #include "../../DeviceAgnostic/ITMViewBuilder.h"
+#include "../../DeviceAgnostic/ITMLowLevelEngine.h"
 #include "../../../../ORUtils/MetalContext.h"
 
 using namespace ITMLib::Engine;
 using namespace ORUtils;
 
-ITMViewBuilder_CPU::ITMViewBuilder_CPU(const ITMRGBDCalib *calib):ITMViewBuilder(calib) { }
-ITMViewBuilder_CPU::~ITMViewBuilder_CPU(void) { }
+// the range weights are tabulated up to exp(-20), beyond which they are zero
+#define DEPTHFILTER_LUT_SIZE 2048
+#define DEPTHFILTER_LUT_SCALE (DEPTHFILTER_LUT_SIZE / 20.0f)
+
+// number of output rows filtered together by the fused bilateral filter, must be even
+#define DEPTHFILTER_BAND_ROWS 64
+
+/** Same results as computeNormalAndWeight in DeviceAgnostic/ITMViewBuilder.h
+    for the pixels 2 <= x < width - 2 of row @p y. The unnormalised normals
+    are computed for all pixels without branches, so that the compiler can
+    vectorise them. Normalising them and the uncertainties need sqrt and
+    acos and are done for the valid pixels afterwards.
+*/
+static inline void computeNormalAndWeightRow(const float *depth_in, Vector4f *normal_out, float *sigmaZ_out, int y, Vector2i imgDims, Vector4f intrinparam)
+{
+	const float *row = depth_in + y * imgDims.x, *above = row - imgDims.x, *below = row + imgDims.x;
+	Vector4f *normalRow = normal_out + y * imgDims.x;
+	float *sigmaZRow = sigmaZ_out + y * imgDims.x;
+
+	for (int x = 2; x < imgDims.x - 2; x++)
+	{
+		float z = row[x];
+		float xp1_z = row[x + 1], xm1_z = row[x - 1], yp1_z = below[x], ym1_z = above[x];
+
+		// unprojected neighbours, and their differences along x and y
+		float diff_x_x = xp1_z * ((x + 1.0f) - intrinparam.z) * intrinparam.x - xm1_z * ((x - 1.0f) - intrinparam.z) * intrinparam.x;
+		float diff_x_y = xp1_z * (y - intrinparam.w) * intrinparam.y - xm1_z * (y - intrinparam.w) * intrinparam.y;
+		float diff_x_z = xp1_z - xm1_z;
+
+		float diff_y_x = yp1_z * (x - intrinparam.z) * intrinparam.x - ym1_z * (x - intrinparam.z) * intrinparam.x;
+		float diff_y_y = yp1_z * ((y + 1.0f) - intrinparam.w) * intrinparam.y - ym1_z * ((y - 1.0f) - intrinparam.w) * intrinparam.y;
+		float diff_y_z = yp1_z - ym1_z;
+
+		// cross product
+		float n_x = diff_x_y * diff_y_z - diff_x_z * diff_y_y;
+		float n_y = diff_x_z * diff_y_x - diff_x_x * diff_y_z;
+		float n_z = diff_x_x * diff_y_y - diff_x_y * diff_y_x;
+
+		// combined without short circuits, which would be branches
+		bool valid = !(z < 0.0f) & (xp1_z > 0.0f) & (yp1_z > 0.0f) & (xm1_z > 0.0f) & (ym1_z > 0.0f) &
+			!((n_x == 0.0f) & (n_y == 0.0f) & (n_z == 0.0f));
+
+		// only w is meaningful for invalid pixels
+		normalRow[x] = Vector4f(n_x, n_y, n_z, valid ? 1.0f : -1.0f);
+	}
+
+	for (int x = 2; x < imgDims.x - 2; x++)
+	{
+		Vector4f &normal = normalRow[x];
+		if (normal.w < 0.0f) { sigmaZRow[x] = -1; continue; }
+
+		float norm = 1.0f / sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+		normal.x *= norm; normal.y *= norm; normal.z *= norm;
+
+		// now compute weight
+		float z = row[x];
+		float theta = acos(normal.z);
+		float theta_diff = theta / (PI*0.5f - theta);
+
+		sigmaZRow[x] = (0.0012f + 0.0019f * (z - 0.4f) * (z - 0.4f) + 0.0001f / sqrt(z) * theta_diff * theta_diff);
+	}
+}
+
+ITMViewBuilder_CPU::ITMViewBuilder_CPU(const ITMRGBDCalib *calib, int noDepthPyramidLevels):ITMViewBuilder(calib)
+{
+	this->noDepthPyramidLevels = noDepthPyramidLevels;
+	this->depthTable = NULL;
+
+	// same weights as filterDepth, split into exp(spatial) * exp(range)
+	for (int distance = 0; distance < 5; distance++)
+		spatialWeights[distance] = exp(-0.5f * distance * MEAN_SIGMA_L * MEAN_SIGMA_L);
+
+	rangeWeights = new float[DEPTHFILTER_LUT_SIZE + 2];
+	for (int i = 0; i < DEPTHFILTER_LUT_SIZE; i++) rangeWeights[i] = exp(-(float)i / DEPTHFILTER_LUT_SCALE);
+	rangeWeights[DEPTHFILTER_LUT_SIZE] = rangeWeights[DEPTHFILTER_LUT_SIZE + 1] = 0.0f;
+}
+
+ITMViewBuilder_CPU::~ITMViewBuilder_CPU(void)
+{
+	delete[] rangeWeights;
+	if (depthTable != NULL) delete[] depthTable;
+}
 
 void ITMViewBuilder_CPU::UpdateView(ITMView **view_ptr, ITMUChar4Image *rgbImage, ITMShortImage *rawDepthImage, bool useBilateralFilter, bool modelSensorNoise)
 { 
 	if (*view_ptr == NULL)
 	{
 		*view_ptr = new ITMView(calib, rgbImage->noDims, rawDepthImage->noDims, false);
-		if (this->shortImage != NULL) delete this->shortImage;
-		this->shortImage = new ITMShortImage(rawDepthImage->noDims, true, false);
 		if (this->floatImage != NULL) delete this->floatImage;
 		this->floatImage = new ITMFloatImage(rawDepthImage->noDims, true, false);
 
@@ -31,31 +110,46 @@ void ITMViewBuilder_CPU::UpdateView(ITMView **view_ptr, ITMUChar4Image *rgbImage
 	}
 	ITMView *view = *view_ptr;
 
+	if (noDepthPyramidLevels > 1 && view->depthPyramid == NULL)
+	{
+		view->noDepthPyramidLevels = noDepthPyramidLevels;
+		view->depthPyramid = new ITMFloatImage*[noDepthPyramidLevels];
+		view->depthPyramid[0] = view->depth;
+
+		Vector2i levelSize = view->depth->noDims;
+		for (int levelId = 1; levelId < noDepthPyramidLevels; levelId++)
+		{
+			levelSize.x /= 2; levelSize.y /= 2;
+			view->depthPyramid[levelId] = new ITMFloatImage(levelSize, true, false);
+		}
+	}
+
 	view->rgb->SetFrom(rgbImage, MemoryBlock<Vector4u>::CPU_TO_CPU);
-	this->shortImage->SetFrom(rawDepthImage, MemoryBlock<short>::CPU_TO_CPU);
+
+	// the raw depth is converted straight into the view, or into the input of the bilateral filter
+	ITMFloatImage *convertedDepth = useBilateralFilter ? this->floatImage : view->depth;
 
 	switch (view->calib->disparityCalib.type)
 	{
 	case ITMDisparityCalib::TRAFO_KINECT:
-		this->ConvertDisparityToDepth(view->depth, this->shortImage, &(view->calib->intrinsics_d), view->calib->disparityCalib.params);
+		this->ConvertDisparityToDepth(convertedDepth, rawDepthImage, &(view->calib->intrinsics_d), view->calib->disparityCalib.params);
 		break;
 	case ITMDisparityCalib::TRAFO_AFFINE:
-		this->ConvertDepthAffineToFloat(view->depth, this->shortImage, view->calib->disparityCalib.params);
+		this->ConvertDepthAffineToFloat(convertedDepth, rawDepthImage, view->calib->disparityCalib.params);
 		break;
 	default:
 		break;
 	}
 
+	ITMFloatImage *firstSubsampledLevel = view->noDepthPyramidLevels > 1 ? view->depthPyramid[1] : NULL;
+
 	if (useBilateralFilter)
 	{
-		//5 steps of bilateral filtering
-		this->DepthFiltering(this->floatImage, view->depth);
-		this->DepthFiltering(view->depth, this->floatImage);
-		this->DepthFiltering(this->floatImage, view->depth);
-		this->DepthFiltering(view->depth, this->floatImage);
-		this->DepthFiltering(this->floatImage, view->depth);
-		view->depth->SetFrom(this->floatImage, MemoryBlock<float>::CPU_TO_CPU);
+		//5 steps of bilateral filtering, which also yield the first pyramid level
+		this->FilterDepthBands(view->depth, firstSubsampledLevel, this->floatImage, 5);
+		if (firstSubsampledLevel != NULL) this->SubsampleDepthPyramid(view, 2);
 	}
+	else if (firstSubsampledLevel != NULL) this->SubsampleDepthPyramid(view, 1);
 
 	if (modelSensorNoise)
 	{
@@ -79,8 +173,6 @@ void ITMViewBuilder_CPU::UpdateView(ITMView **view_ptr, ITMUChar4Image *rgbImage
 	if (*view_ptr == NULL)
 	{
 		*view_ptr = new ITMViewIMU(calib, rgbImage->noDims, depthImage->noDims, false);
-		if (this->shortImage != NULL) delete this->shortImage;
-		this->shortImage = new ITMShortImage(depthImage->noDims, true, false);
 		if (this->floatImage != NULL) delete this->floatImage;
 		this->floatImage = new ITMFloatImage(depthImage->noDims, true, false);
 	}
@@ -91,42 +183,186 @@ void ITMViewBuilder_CPU::UpdateView(ITMView **view_ptr, ITMUChar4Image *rgbImage
 	this->UpdateView(view_ptr, rgbImage, depthImage, useBilateralFilter);
 }
 
-void ITMViewBuilder_CPU::ConvertDisparityToDepth(ITMFloatImage *depth_out, const ITMShortImage *depth_in, const ITMIntrinsics *depthIntrinsics,
-	Vector2f disparityCalibParams)
+void ITMViewBuilder_CPU::UpdateDepthTable(ITMDisparityCalib::TrafoType type, Vector2f calibParams, float fx_depth)
 {
-	Vector2i imgSize = depth_in->noDims;
+	Vector3f params(calibParams.x, calibParams.y, type == ITMDisparityCalib::TRAFO_KINECT ? fx_depth : 0.0f);
+	if (depthTable != NULL && type == depthTableType && params == depthTableParams) return;
+
+	if (depthTable == NULL) depthTable = new float[1 << 16];
+	depthTableType = type; depthTableParams = params;
+
+	// evaluate the per-pixel conversions on every raw value, so the table gives identical depths
+	Vector2i tableEntrySize(1, 1);
+	for (int i = 0; i < (1 << 16); i++)
+	{
+		short rawValue = (short)(unsigned short)i;
+
+		if (type == ITMDisparityCalib::TRAFO_KINECT) convertDisparityToDepth(depthTable + i, 0, 0, &rawValue, calibParams, fx_depth, tableEntrySize);
+		else convertDepthAffineToFloat(depthTable + i, 0, 0, &rawValue, tableEntrySize, calibParams);
+	}
+}
+
+void ITMViewBuilder_CPU::ConvertDepthWithTable(ITMFloatImage *depth_out, const ITMShortImage *depth_in)
+{
+	int noPixels = depth_in->noDims.x * depth_in->noDims.y;
 
 	const short *d_in = depth_in->GetData(MEMORYDEVICE_CPU);
 	float *d_out = depth_out->GetData(MEMORYDEVICE_CPU);
 
-	float fx_depth = depthIntrinsics->projectionParamsSimple.fx;
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int locId = 0; locId < noPixels; locId++) d_out[locId] = depthTable[(unsigned short)d_in[locId]];
+}
 
-	for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
-		convertDisparityToDepth(d_out, x, y, d_in, disparityCalibParams, fx_depth, imgSize);
+void ITMViewBuilder_CPU::ConvertDisparityToDepth(ITMFloatImage *depth_out, const ITMShortImage *depth_in, const ITMIntrinsics *depthIntrinsics,
+	Vector2f disparityCalibParams)
+{
+	UpdateDepthTable(ITMDisparityCalib::TRAFO_KINECT, disparityCalibParams, depthIntrinsics->projectionParamsSimple.fx);
+	ConvertDepthWithTable(depth_out, depth_in);
 }
 
 void ITMViewBuilder_CPU::ConvertDepthAffineToFloat(ITMFloatImage *depth_out, const ITMShortImage *depth_in, const Vector2f depthCalibParams)
 {
-	Vector2i imgSize = depth_in->noDims;
+	UpdateDepthTable(ITMDisparityCalib::TRAFO_AFFINE, depthCalibParams, 0.0f);
+	ConvertDepthWithTable(depth_out, depth_in);
+}
 
-	const short *d_in = depth_in->GetData(MEMORYDEVICE_CPU);
-	float *d_out = depth_out->GetData(MEMORYDEVICE_CPU);
+void ITMViewBuilder_CPU::FilterDepthRow(float *row_out, const float *rows_in[5], float *rowBuffers, Vector2i imgDims) const
+{
+	// the taps are applied one after another to the whole row, so that the
+	// inner loops run over consecutive pixels without branches
+	float *rangeScales = rowBuffers, *w_sums = rowBuffers + imgDims.x, *final_depths = rowBuffers + 2 * imgDims.x;
+	const float *centre = rows_in[2], *lut = rangeWeights;
+
+	for (int x = 2; x < imgDims.x - 2; x++)
+	{
+		float z = MAX(centre[x], 0.0001f);
+		float sigma_z = 1.0f / (0.0012f + 0.0019f*(z - 0.4f)*(z - 0.4f) + 0.0001f / sqrtf(z) * 0.25f);
 
-	for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
-		convertDepthAffineToFloat(d_out, x, y, d_in, imgSize, depthCalibParams);
+		rangeScales[x] = 0.5f * sigma_z * sigma_z * DEPTHFILTER_LUT_SCALE;
+		w_sums[x] = 0.0f; final_depths[x] = 0.0f;
+	}
+
+	for (int i = -2; i <= 2; i++) for (int j = -2; j <= 2; j++)
+	{
+		const float *taps = rows_in[i + 2] + j;
+		float spatialWeight = spatialWeights[abs(i) + abs(j)];
+
+		for (int x = 2; x < imgDims.x - 2; x++)
+		{
+			float tmpz = taps[x];
+			float dz = tmpz - centre[x];
+
+			float lutPos = MIN(dz * dz * rangeScales[x], (float)DEPTHFILTER_LUT_SIZE);
+			int lutId = (int)lutPos; float frac = lutPos - (float)lutId;
+			float w = lut[lutId] + frac * (lut[lutId + 1] - lut[lutId]);
+
+			w = tmpz < 0.0f ? 0.0f : w * spatialWeight;
+			w_sums[x] += w;
+			final_depths[x] += w * tmpz;
+		}
+	}
+
+	row_out[0] = row_out[1] = 0.0f;
+	row_out[imgDims.x - 2] = row_out[imgDims.x - 1] = 0.0f;
+
+	for (int x = 2; x < imgDims.x - 2; x++)
+		row_out[x] = centre[x] < 0.0f ? -1.0f : final_depths[x] / w_sums[x];
 }
 
 void ITMViewBuilder_CPU::DepthFiltering(ITMFloatImage *image_out, const ITMFloatImage *image_in)
 {
-	Vector2i imgSize = image_in->noDims;
+	DepthFiltering(image_out, image_in, 1);
+}
+
+void ITMViewBuilder_CPU::DepthFiltering(ITMFloatImage *image_out, const ITMFloatImage *image_in, int noIterations)
+{
+	FilterDepthBands(image_out, NULL, image_in, noIterations);
+}
 
-	image_out->Clear();
+void ITMViewBuilder_CPU::FilterDepthBands(ITMFloatImage *image_out, ITMFloatImage *subsampled_out, const ITMFloatImage *image_in, int noIterations)
+{
+	Vector2i imgSize = image_in->noDims;
 
 	float *imout = image_out->GetData(MEMORYDEVICE_CPU);
 	const float *imin = image_in->GetData(MEMORYDEVICE_CPU);
 
-	for (int y = 2; y < imgSize.y - 2; y++) for (int x = 2; x < imgSize.x - 2; x++)
-		filterDepth(imout, imin, x, y, imgSize);
+	int noBands = (imgSize.y + DEPTHFILTER_BAND_ROWS - 1) / DEPTHFILTER_BAND_ROWS;
+
+	// each pass shrinks the valid region by two rows, so every band starts
+	// from 2 * noIterations extra rows on either side of its output rows
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int bandId = 0; bandId < noBands; bandId++)
+	{
+		int y0 = bandId * DEPTHFILTER_BAND_ROWS, y1 = MIN(y0 + DEPTHFILTER_BAND_ROWS, imgSize.y);
+		int bufferBegin = MAX(y0 - 2 * noIterations, 0), bufferEnd = MIN(y1 + 2 * noIterations, imgSize.y);
+		int bufferRows = bufferEnd - bufferBegin;
+
+		float *buffers = new float[(2 * bufferRows + 3) * imgSize.x];
+		float *rowBuffers = buffers + 2 * bufferRows * imgSize.x;
+
+		const float *src = imin; int srcBegin = 0;
+
+		for (int iterNo = 0; iterNo < noIterations; iterNo++)
+		{
+			int margin = 2 * (noIterations - 1 - iterNo);
+			int rowBegin = MAX(y0 - margin, 0), rowEnd = MIN(y1 + margin, imgSize.y);
+
+			bool lastIteration = iterNo == noIterations - 1;
+			float *dst = lastIteration ? imout : buffers + (iterNo % 2) * bufferRows * imgSize.x;
+			int dstBegin = lastIteration ? 0 : bufferBegin;
+
+			for (int y = rowBegin; y < rowEnd; y++)
+			{
+				float *row_out = dst + (y - dstBegin) * imgSize.x;
+
+				// the border rows are cleared, as by DepthFiltering on the other devices
+				if (y < 2 || y >= imgSize.y - 2) { memset(row_out, 0, imgSize.x * sizeof(float)); continue; }
+
+				const float *rows_in[5];
+				for (int i = 0; i < 5; i++) rows_in[i] = src + (y - 2 + i - srcBegin) * imgSize.x;
+
+				FilterDepthRow(row_out, rows_in, rowBuffers, imgSize);
+			}
+
+			src = dst; srcBegin = dstBegin;
+		}
+
+		if (subsampled_out != NULL)
+		{
+			// the bands have an even number of rows, so every subsampled row lies within one band
+			Vector2i newDims = subsampled_out->noDims;
+			float *subsampledData = subsampled_out->GetData(MEMORYDEVICE_CPU);
+
+			for (int y = y0 / 2; y < MIN(y1 / 2, newDims.y); y++) for (int x = 0; x < newDims.x; x++)
+				filterSubsampleWithHoles(subsampledData, x, y, newDims, imout, imgSize);
+		}
+
+		delete[] buffers;
+	}
+}
+
+void ITMViewBuilder_CPU::SubsampleDepthPyramid(ITMView *view, int firstLevelId)
+{
+	for (int levelId = firstLevelId; levelId < view->noDepthPyramidLevels; levelId++)
+	{
+		const ITMFloatImage *image_in = view->depthPyramid[levelId - 1];
+		ITMFloatImage *image_out = view->depthPyramid[levelId];
+
+		Vector2i oldDims = image_in->noDims, newDims = image_out->noDims;
+
+		const float *imageData_in = image_in->GetData(MEMORYDEVICE_CPU);
+		float *imageData_out = image_out->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < newDims.y; y++) for (int x = 0; x < newDims.x; x++)
+			filterSubsampleWithHoles(imageData_out, x, y, newDims, imageData_in, oldDims);
+	}
 }
 
 void ITMLib::Engine::ITMViewBuilder_CPU::ComputeNormalAndWeights(ITMFloat4Image *normal_out, ITMFloatImage *sigmaZ_out, const ITMFloatImage *depth_in, Vector4f intrinsic)
@@ -138,6 +374,9 @@ void ITMLib::Engine::ITMViewBuilder_CPU::ComputeNormalAndWeights(ITMFloat4Image
 	float *sigmaZData_out = sigmaZ_out->GetData(MEMORYDEVICE_CPU);
 	Vector4f *normalData_out = normal_out->GetData(MEMORYDEVICE_CPU);
 
-	for (int y = 2; y < imgDims.y - 2; y++) for (int x = 2; x < imgDims.x - 2; x++)
-		computeNormalAndWeight(depthData_in, normalData_out, sigmaZData_out, x, y, imgDims, intrinsic);
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 2; y < imgDims.y - 2; y++)
+		computeNormalAndWeightRow(depthData_in, normalData_out, sigmaZData_out, y, imgDims, intrinsic);
 }
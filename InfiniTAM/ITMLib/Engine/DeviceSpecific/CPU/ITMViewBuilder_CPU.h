@@ -10,12 +10,47 @@ namespace ITMLib
 	{
 		class ITMViewBuilder_CPU : public ITMViewBuilder
 		{
+		private:
+			/// Bilateral filter weights for taps at Manhattan distance 0 to 4
+			float spatialWeights[5];
+
+			/// Range weights exp(-u) of the bilateral filter, sampled at u = k / DEPTHFILTER_LUT_SCALE
+			float *rangeWeights;
+
+			/// Depths for all 2^16 raw values, for the calibration stored in depthTableParams
+			float *depthTable;
+			ITMDisparityCalib::TrafoType depthTableType;
+			Vector3f depthTableParams;
+
+			/// Number of levels of the depth pyramid built for every view
+			int noDepthPyramidLevels;
+
+			void UpdateDepthTable(ITMDisparityCalib::TrafoType type, Vector2f calibParams, float fx_depth);
+			void ConvertDepthWithTable(ITMFloatImage *depth_out, const ITMShortImage *depth_in);
+
+			void FilterDepthRow(float *row_out, const float *rows_in[5], float *rowBuffers, Vector2i imgDims) const;
+
+			/** DepthFiltering with @p noIterations passes. If
+			    @p subsampled_out is given, the first pyramid level is
+			    computed from each band as soon as it is filtered.
+			*/
+			void FilterDepthBands(ITMFloatImage *image_out, ITMFloatImage *subsampled_out, const ITMFloatImage *image_in, int noIterations);
+
+			/// Subsample the depth pyramid of the view from level @p firstLevelId onwards
+			void SubsampleDepthPyramid(ITMView *view, int firstLevelId);
+
 		public:
 			void ConvertDisparityToDepth(ITMFloatImage *depth_out, const ITMShortImage *disp_in, const ITMIntrinsics *depthIntrinsics, 
 				Vector2f disparityCalibParams);
 			void ConvertDepthAffineToFloat(ITMFloatImage *depth_out, const ITMShortImage *depth_in, Vector2f depthCalibParams);
 
 			void DepthFiltering(ITMFloatImage *image_out, const ITMFloatImage *image_in);
+
+			/** Apply @p noIterations passes of DepthFiltering in one
+			    sweep over bands of rows that stay in the cache.
+			    @p image_out and @p image_in must be different images.
+			*/
+			void DepthFiltering(ITMFloatImage *image_out, const ITMFloatImage *image_in, int noIterations);
 			void ComputeNormalAndWeights(ITMFloat4Image *normal_out, ITMFloatImage *sigmaZ_out, const ITMFloatImage *depth_in, Vector4f intrinsic);
 			
 			void UpdateView(ITMView **view, ITMUChar4Image *rgbImage, ITMShortImage *rawDepthImage, bool useBilateralFilter, bool modelSensorNoise = false);
@@ -23,7 +58,12 @@ namespace ITMLib
 
 			void UpdateView(ITMView **view, ITMUChar4Image *rgbImage, ITMShortImage *depthImage, bool useBilateralFilter, ITMIMUMeasurement *imuMeasurement);
 
-			ITMViewBuilder_CPU(const ITMRGBDCalib *calib);
+			/** If @p noDepthPyramidLevels is larger than one, every
+			    view also gets a depth pyramid of that many levels,
+			    which the depth trackers use instead of building their
+			    own.
+			*/
+			ITMViewBuilder_CPU(const ITMRGBDCalib *calib, int noDepthPyramidLevels = 0);
 			~ITMViewBuilder_CPU(void);
 		};
 	}
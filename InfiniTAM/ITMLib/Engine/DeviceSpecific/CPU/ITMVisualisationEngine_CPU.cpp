@@ -8,6 +8,10 @@
 
 #include <vector>
 
+#if defined(WITH_OPENMP) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 using namespace ITMLib::Engine;
 
 template<class TVoxel, class TIndex>
@@ -15,6 +19,25 @@ static int RenderPointCloud(Vector4u *outRendering, Vector4f *locations, Vector4
 	const TVoxel *voxelData, const typename TIndex::IndexData *voxelIndex, bool skipPoints, float voxelSize, 
 	Vector2i imgSize, Vector3f lightSource);
 
+template<class TVoxel>
+ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash>::ITMVisualisationEngine_CPU(ITMScene<TVoxel, ITMVoxelBlockHash> *scene,
+	bool useTemporalRaycastSeeding) : ITMVisualisationEngine<TVoxel, ITMVoxelBlockHash>(scene)
+{
+	projectedBlocks = new RenderingBlock[MAX_RENDERING_BLOCKS];
+	tileBlockIds = new int[MAX_RENDERING_BLOCKS];
+	tileOffsets = new ITMIntImage(true, false);
+	raycastSeeds = useTemporalRaycastSeeding ? new ITMFloatImage(true, false) : NULL;
+}
+
+template<class TVoxel>
+ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash>::~ITMVisualisationEngine_CPU(void)
+{
+	delete[] projectedBlocks;
+	delete[] tileBlockIds;
+	delete tileOffsets;
+	delete raycastSeeds;
+}
+
 template<class TVoxel, class TIndex>
 ITMRenderState* ITMVisualisationEngine_CPU<TVoxel, TIndex>::CreateRenderState(const Vector2i & imgSize) const
 {
@@ -27,7 +50,7 @@ template<class TVoxel>
 ITMRenderState_VH* ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash>::CreateRenderState(const Vector2i & imgSize) const
 {
 	return new ITMRenderState_VH(
-		ITMVoxelBlockHash::noTotalEntries, imgSize, this->scene->sceneParams->viewFrustum_min, this->scene->sceneParams->viewFrustum_max, MEMORYDEVICE_CPU
+		this->scene->index.noTotalEntries, this->scene->index.getNumAllocatedVoxelBlocks(), imgSize, this->scene->sceneParams->viewFrustum_min, this->scene->sceneParams->viewFrustum_max, MEMORYDEVICE_CPU
 	);
 }
 
@@ -73,6 +96,7 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::FindVisibleBlocks(con
 		}
 	}
 
+	sortVisibleEntriesByPtr(visibleEntryIDs, noVisibleEntries, hashTable);
 	renderState_vh->noVisibleEntries = noVisibleEntries;
 }
 
@@ -97,62 +121,410 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreateExpectedDepths(
 	Vector2i imgSize = renderState->renderingRangeImage->noDims;
 	Vector2f *minmaxData = renderState->renderingRangeImage->GetData(MEMORYDEVICE_CPU);
 
-	for (int locId = 0; locId < imgSize.x*imgSize.y; ++locId) {
-		Vector2f & pixel = minmaxData[locId];
-		pixel.x = FAR_AWAY;
-		pixel.y = VERY_CLOSE;
-	}
-
 	float voxelSize = this->scene->sceneParams->voxelSize;
-
-	std::vector<RenderingBlock> renderingBlocks(MAX_RENDERING_BLOCKS);
-	int numRenderingBlocks = 0;
+	Matrix4f M = pose->GetM();
+	Vector4f projParams = intrinsics->projectionParamsSimple.all;
 
 	ITMRenderState_VH* renderState_vh = (ITMRenderState_VH*)renderState;
 
+	const ITMHashEntry *hashTable = this->scene->index.GetEntries();
 	const int *visibleEntryIDs = renderState_vh->GetVisibleEntryIDs();
-	int noVisibleEntries = renderState_vh->noVisibleEntries;
+	int noVisibleEntries = MIN(renderState_vh->noVisibleEntries, MAX_RENDERING_BLOCKS);
 
-	//go through list of visible 8x8x8 blocks
-	for (int blockNo = 0; blockNo < noVisibleEntries; ++blockNo) {
-		const ITMHashEntry & blockData(this->scene->index.GetEntries()[visibleEntryIDs[blockNo]]);
+	// project the visible 8x8x8 blocks, marking the invalid ones with an empty box
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int blockNo = 0; blockNo < noVisibleEntries; ++blockNo)
+	{
+		const ITMHashEntry & blockData(hashTable[visibleEntryIDs[blockNo]]);
+		RenderingBlock & b(projectedBlocks[blockNo]);
 
 		Vector2i upperLeft, lowerRight;
 		Vector2f zRange;
 		bool validProjection = false;
-		if (blockData.ptr>=0) {
-			validProjection = ProjectSingleBlock(blockData.pos, pose->GetM(), intrinsics->projectionParamsSimple.all, imgSize, voxelSize, upperLeft, lowerRight, zRange);
-		}
-		if (!validProjection) continue;
+		if (blockData.ptr >= 0) validProjection = ProjectSingleBlock(blockData.pos, M, projParams, imgSize, voxelSize, upperLeft, lowerRight, zRange);
+
+		if (!validProjection) { b.upperLeft = Vector2s(0, 0); b.lowerRight = Vector2s(-1, -1); continue; }
 
-		Vector2i requiredRenderingBlocks((int)ceilf((float)(lowerRight.x - upperLeft.x + 1) / (float)renderingBlockSizeX), 
-			(int)ceilf((float)(lowerRight.y - upperLeft.y + 1) / (float)renderingBlockSizeY));
-		int requiredNumBlocks = requiredRenderingBlocks.x * requiredRenderingBlocks.y;
+		b.upperLeft = Vector2s((short)upperLeft.x, (short)upperLeft.y);
+		b.lowerRight = Vector2s((short)lowerRight.x, (short)lowerRight.y);
+		b.zRange = zRange;
+	}
+
+	// bin the boxes into tiles of renderingBlockSizeX x renderingBlockSizeY pixels, so that every
+	// tile can be filled on its own. As before, a block is dropped if it would need more than
+	// MAX_RENDERING_BLOCKS rendering blocks in total.
+	Vector2i noTiles((imgSize.x + renderingBlockSizeX - 1) / renderingBlockSizeX, (imgSize.y + renderingBlockSizeY - 1) / renderingBlockSizeY);
+	this->tileOffsets->ChangeDims(Vector2i(noTiles.x * noTiles.y + 1, 1));
+	int *tileOffsets = this->tileOffsets->GetData(MEMORYDEVICE_CPU);
+	for (int tileId = 0; tileId <= noTiles.x * noTiles.y; tileId++) tileOffsets[tileId] = 0;
 
-		if (numRenderingBlocks + requiredNumBlocks >= MAX_RENDERING_BLOCKS) continue;
-		int offset = numRenderingBlocks;
-		numRenderingBlocks += requiredNumBlocks;
+	int noRenderingBlocks = 0;
+	for (int blockNo = 0; blockNo < noVisibleEntries; ++blockNo)
+	{
+		RenderingBlock & b(projectedBlocks[blockNo]);
+		if (b.lowerRight.x < b.upperLeft.x) continue;
 
-		CreateRenderingBlocks(&(renderingBlocks[0]), offset, upperLeft, lowerRight, zRange);
+		int tileMinX = b.upperLeft.x / renderingBlockSizeX, tileMaxX = b.lowerRight.x / renderingBlockSizeX;
+		int tileMinY = b.upperLeft.y / renderingBlockSizeY, tileMaxY = b.lowerRight.y / renderingBlockSizeY;
+
+		int requiredNumBlocks = (tileMaxX - tileMinX + 1) * (tileMaxY - tileMinY + 1);
+		if (noRenderingBlocks + requiredNumBlocks >= MAX_RENDERING_BLOCKS) { b.upperLeft = Vector2s(0, 0); b.lowerRight = Vector2s(-1, -1); continue; }
+		noRenderingBlocks += requiredNumBlocks;
+
+		for (int ty = tileMinY; ty <= tileMaxY; ty++) for (int tx = tileMinX; tx <= tileMaxX; tx++) tileOffsets[tx + ty * noTiles.x + 1]++;
+	}
+
+	for (int tileId = 0; tileId < noTiles.x * noTiles.y; tileId++) tileOffsets[tileId + 1] += tileOffsets[tileId];
+
+	for (int blockNo = 0; blockNo < noVisibleEntries; ++blockNo)
+	{
+		const RenderingBlock & b(projectedBlocks[blockNo]);
+		if (b.lowerRight.x < b.upperLeft.x) continue;
+
+		for (int ty = b.upperLeft.y / renderingBlockSizeY; ty <= b.lowerRight.y / renderingBlockSizeY; ty++)
+			for (int tx = b.upperLeft.x / renderingBlockSizeX; tx <= b.lowerRight.x / renderingBlockSizeX; tx++)
+				tileBlockIds[tileOffsets[tx + ty * noTiles.x]++] = blockNo;
 	}
 
-	// go through rendering blocks
-	for (int blockNo = 0; blockNo < numRenderingBlocks; ++blockNo) {
-		// fill minmaxData
-		const RenderingBlock & b(renderingBlocks[blockNo]);
+	// the offsets now mark the ends of the bins, so each bin starts at the end of the previous one
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int tileId = 0; tileId < noTiles.x * noTiles.y; tileId++)
+	{
+		int tx = tileId % noTiles.x, ty = tileId / noTiles.x;
+		int x0 = tx * renderingBlockSizeX, x1 = MIN(x0 + renderingBlockSizeX, imgSize.x) - 1;
+		int y0 = ty * renderingBlockSizeY, y1 = MIN(y0 + renderingBlockSizeY, imgSize.y) - 1;
+
+		for (int y = y0; y <= y1; ++y) for (int x = x0; x <= x1; ++x)
+		{
+			Vector2f & pixel = minmaxData[x + y * imgSize.x];
+			pixel.x = FAR_AWAY;
+			pixel.y = VERY_CLOSE;
+		}
 
-		for (int y = b.upperLeft.y; y <= b.lowerRight.y; ++y) {
-			for (int x = b.upperLeft.x; x <= b.lowerRight.x; ++x) {
-				Vector2f & pixel(minmaxData[x + y*imgSize.x]);
-				if (pixel.x > b.zRange.x) pixel.x = b.zRange.x;
-				if (pixel.y < b.zRange.y) pixel.y = b.zRange.y;
+		for (int binPos = tileId > 0 ? tileOffsets[tileId - 1] : 0; binPos < tileOffsets[tileId]; binPos++)
+		{
+			const RenderingBlock & b(projectedBlocks[tileBlockIds[binPos]]);
+
+			for (int y = MAX(b.upperLeft.y, y0); y <= MIN(b.lowerRight.y, y1); ++y) {
+				for (int x = MAX(b.upperLeft.x, x0); x <= MIN(b.lowerRight.x, x1); ++x) {
+					Vector2f & pixel(minmaxData[x + y*imgSize.x]);
+					if (pixel.x > b.zRange.x) pixel.x = b.zRange.x;
+					if (pixel.y < b.zRange.y) pixel.y = b.zRange.y;
+				}
 			}
 		}
 	}
 }
 
+// half width of the depth interval around the seed depth of a tracking raycast, in multiples of mu
+#define RAYCAST_SEED_MARGIN 1.0f
+
+// rays are marched in packets of RAYPACKET_SIZE x RAYPACKET_SIZE pixels, which must divide minmaximg_subsample
+#define RAYPACKET_SIZE 4
+#define RAYPACKET_NO_RAYS (RAYPACKET_SIZE * RAYPACKET_SIZE)
+
+// number of blocks a packet remembers from its recent hash lookups
+#define RAYPACKET_CACHE_SIZE 8
+
+// the rays of a packet continue one by one once fewer than this many are still marching
+#define RAYPACKET_MIN_ACTIVE_RAYS 4
+
+/// Blocks recently looked up by the rays of a packet, including blocks that are not allocated
+struct RayPacketBlockCache
+{
+	Vector3i blockPos[RAYPACKET_CACHE_SIZE];
+	int blockPtr[RAYPACKET_CACHE_SIZE];
+	int noEntries, nextEntry;
+
+	RayPacketBlockCache(void) : noEntries(0), nextEntry(0) {}
+
+	/// Whether the block is cached, and if so its voxel offset or -1 in @p ptr
+	bool Lookup(const Vector3i & pos, int & ptr) const
+	{
+		for (int i = 0; i < noEntries; i++) if IS_EQUAL3(blockPos[i], pos) { ptr = blockPtr[i]; return true; }
+		return false;
+	}
+
+	void Insert(const Vector3i & pos, int ptr)
+	{
+		blockPos[nextEntry] = pos; blockPtr[nextEntry] = ptr;
+		nextEntry = (nextEntry + 1) % RAYPACKET_CACHE_SIZE;
+		if (noEntries < RAYPACKET_CACHE_SIZE) noEntries++;
+	}
+
+	/// Voxel offset of the block, or -1 if it is not allocated, searching the hash table if it is not cached
+	int Find(const ITMHashEntry *hashTable, const Vector3i & pos)
+	{
+		int ptr;
+		if (Lookup(pos, ptr)) return ptr;
+
+		findVoxelBlocks(&ptr, hashTable, &pos, 1);
+		Insert(pos, ptr);
+
+		return ptr;
+	}
+};
+
+/** Length of a step from @p pt, inside the unallocated block @p blockPos,
+    to the last point before the ray leaves the largest super-block around
+    it that holds no allocated blocks. The step is a multiple of the
+    SDF_BLOCK_SIZE steps castRay takes through unallocated blocks.
+*/
+static inline float emptySpaceStep(const Vector3f & pt, const Vector3f & rayDirection, const Vector3i & blockPos, const int *blockOccupancy)
+{
+	for (int levelId = SDF_SUPERBLOCK_LEVELS - 1; levelId >= 0; levelId--)
+	{
+		Vector3i superBlockPos = blockToSuperBlockPos(blockPos, levelId);
+		if (blockOccupancy[occupancyIndex(superBlockPos, levelId)] > 0) continue;
+
+		// the super-block holds voxels [lo, lo + size), i.e. the points [lo - 0.5, lo + size - 0.5) before rounding
+		int size = SDF_BLOCK_SIZE << (SDF_SUPERBLOCK_SHIFT * (levelId + 1));
+		Vector3f lo((float)(superBlockPos.x * size) - 0.5f, (float)(superBlockPos.y * size) - 0.5f, (float)(superBlockPos.z * size) - 0.5f);
+
+		float exitLength = 1e20f;
+		for (int i = 0; i < 3; i++)
+		{
+			if (rayDirection[i] > 0.0f) exitLength = MIN(exitLength, (lo[i] + (float)size - pt[i]) / rayDirection[i]);
+			else if (rayDirection[i] < 0.0f) exitLength = MIN(exitLength, (lo[i] - pt[i]) / rayDirection[i]);
+		}
+
+		// whole steps of castRay, so that the ray samples the same points once it leaves the super-block
+		return (float)SDF_BLOCK_SIZE * MAX(floor(exitLength / (float)SDF_BLOCK_SIZE), 1.0f);
+	}
+
+	return (float)SDF_BLOCK_SIZE;
+}
+
+/** Casts the rays of a packet, with exactly the results of castRay for
+    each pixel. @p rayRanges holds the depth range of each ray, in the
+    order of the pixels in the packet. This generic version simply
+    casts the rays one by one.
+*/
+template<class TVoxel, class TIndex>
+struct RayPacketCaster
+{
+	static void Cast(Vector4f *pointsRay, int x0, int y0, const Vector2i & imgSize, const TVoxel *voxelData, const TIndex *index,
+		const Matrix4f & invM, const Vector4f & projParams, float oneOverVoxelSize, float mu, const Vector2f *rayRanges)
+	{
+		const typename TIndex::IndexData *voxelIndex = index->getIndexData();
+
+		int rayId = 0;
+		for (int y = y0; y < MIN(y0 + RAYPACKET_SIZE, imgSize.y); y++) for (int x = x0; x < MIN(x0 + RAYPACKET_SIZE, imgSize.x); x++, rayId++)
+			castRay<TVoxel, TIndex>(pointsRay[x + y * imgSize.x], x, y, voxelData, voxelIndex, invM, projParams, oneOverVoxelSize, mu, rayRanges[rayId]);
+	}
+};
+
+/** With the voxel block hash, the rays of a packet march in lock step.
+    Their hash lookups go through a small cache shared by the packet, so
+    neighbouring rays entering the same block, or the same unallocated
+    space, only search the hash table once, and the blocks the rays of
+    a step miss in the cache are searched together with findVoxelBlocks. Unallocated space is
+    crossed one empty super-block at a time, using the block occupancy
+    hierarchy of the hash. The ray positions are kept
+    as separate coordinate arrays and advanced together with SIMD. Once
+    the packet diverges, i.e. only a few rays are left or the rays look
+    up more blocks than the cache holds, the remaining rays finish one
+    by one.
+*/
+template<class TVoxel>
+struct RayPacketCaster<TVoxel, ITMVoxelBlockHash>
+{
+	static void Cast(Vector4f *pointsRay, int x0, int y0, const Vector2i & imgSize, const TVoxel *voxelData, const ITMVoxelBlockHash *index,
+		const Matrix4f & invM, const Vector4f & projParams, float oneOverVoxelSize, float mu, const Vector2f *rayRanges)
+	{
+		const ITMHashEntry *hashTable = index->GetEntries();
+		const int *blockOccupancy = index->GetBlockOccupancy();
+
+		float pt_x[RAYPACKET_NO_RAYS], pt_y[RAYPACKET_NO_RAYS], pt_z[RAYPACKET_NO_RAYS];
+		float dir_x[RAYPACKET_NO_RAYS], dir_y[RAYPACKET_NO_RAYS], dir_z[RAYPACKET_NO_RAYS];
+		float totalLength[RAYPACKET_NO_RAYS], totalLengthMax[RAYPACKET_NO_RAYS], stepLength[RAYPACKET_NO_RAYS], sdfValue[RAYPACKET_NO_RAYS];
+		bool isActive[RAYPACKET_NO_RAYS];
+		int locIds[RAYPACKET_NO_RAYS];
+		ITMVoxelBlockHash::IndexCache caches[RAYPACKET_NO_RAYS];
+
+		float stepScale = mu * oneOverVoxelSize;
+
+		// same setup as in castRay
+		int noRays = 0, noActive = 0;
+		for (int y = y0; y < MIN(y0 + RAYPACKET_SIZE, imgSize.y); y++) for (int x = x0; x < MIN(x0 + RAYPACKET_SIZE, imgSize.x); x++, noRays++)
+		{
+			Vector4f pt_camera_f; Vector3f pt_block_s, pt_block_e, rayDirection;
+
+			pt_camera_f.z = rayRanges[noRays].x;
+			pt_camera_f.x = pt_camera_f.z * ((float(x) - projParams.z) * projParams.x);
+			pt_camera_f.y = pt_camera_f.z * ((float(y) - projParams.w) * projParams.y);
+			pt_camera_f.w = 1.0f;
+			totalLength[noRays] = length(TO_VECTOR3(pt_camera_f)) * oneOverVoxelSize;
+			pt_block_s = TO_VECTOR3(invM * pt_camera_f) * oneOverVoxelSize;
+
+			pt_camera_f.z = rayRanges[noRays].y;
+			pt_camera_f.x = pt_camera_f.z * ((float(x) - projParams.z) * projParams.x);
+			pt_camera_f.y = pt_camera_f.z * ((float(y) - projParams.w) * projParams.y);
+			pt_camera_f.w = 1.0f;
+			totalLengthMax[noRays] = length(TO_VECTOR3(pt_camera_f)) * oneOverVoxelSize;
+			pt_block_e = TO_VECTOR3(invM * pt_camera_f) * oneOverVoxelSize;
+
+			rayDirection = pt_block_e - pt_block_s;
+			float direction_norm = 1.0f / sqrt(rayDirection.x * rayDirection.x + rayDirection.y * rayDirection.y + rayDirection.z * rayDirection.z);
+			rayDirection *= direction_norm;
+
+			pt_x[noRays] = pt_block_s.x; pt_y[noRays] = pt_block_s.y; pt_z[noRays] = pt_block_s.z;
+			dir_x[noRays] = rayDirection.x; dir_y[noRays] = rayDirection.y; dir_z[noRays] = rayDirection.z;
+
+			locIds[noRays] = x + y * imgSize.x;
+			sdfValue[noRays] = 1.0f;
+			isActive[noRays] = totalLength[noRays] < totalLengthMax[noRays];
+			if (isActive[noRays]) noActive++;
+		}
+
+		RayPacketBlockCache packetCache;
+		bool isCoherent = true;
+
+		Vector3i blockPos[RAYPACKET_NO_RAYS], missedBlockPos[RAYPACKET_NO_RAYS];
+		int linearIdx[RAYPACKET_NO_RAYS], blockPtr[RAYPACKET_NO_RAYS], missedBlockPtr[RAYPACKET_NO_RAYS], missIds[RAYPACKET_NO_RAYS];
+
+		// lock step marching while the packet is coherent
+		while (isCoherent && noActive >= RAYPACKET_MIN_ACTIVE_RAYS)
+		{
+			int noMisses = 0;
+			for (int rayId = 0; rayId < noRays; rayId++)
+			{
+				missIds[rayId] = -1;
+				if (!isActive[rayId]) continue;
+
+				linearIdx[rayId] = pointToVoxelBlockPos(Vector3i((int)ROUND(pt_x[rayId]), (int)ROUND(pt_y[rayId]), (int)ROUND(pt_z[rayId])), blockPos[rayId]);
+
+				if IS_EQUAL3(blockPos[rayId], caches[rayId].blockPos) { blockPtr[rayId] = caches[rayId].blockPtr; continue; }
+				if (packetCache.Lookup(blockPos[rayId], blockPtr[rayId])) continue;
+
+				for (int missId = 0; missId < noMisses && missIds[rayId] < 0; missId++)
+					if IS_EQUAL3(missedBlockPos[missId], blockPos[rayId]) missIds[rayId] = missId;
+				if (missIds[rayId] < 0) { missIds[rayId] = noMisses; missedBlockPos[noMisses++] = blockPos[rayId]; }
+			}
+
+			findVoxelBlocks(missedBlockPtr, hashTable, missedBlockPos, noMisses);
+			for (int missId = 0; missId < noMisses; missId++) packetCache.Insert(missedBlockPos[missId], missedBlockPtr[missId]);
+
+			for (int rayId = 0; rayId < noRays; rayId++)
+			{
+				stepLength[rayId] = 0.0f;
+				if (!isActive[rayId]) continue;
+
+				if (missIds[rayId] >= 0) blockPtr[rayId] = missedBlockPtr[missIds[rayId]];
+				MarchStep(rayId, blockPos[rayId], linearIdx[rayId], blockPtr[rayId], pt_x, pt_y, pt_z, dir_x, dir_y, dir_z, stepLength, sdfValue,
+					isActive, caches, voxelData, hashTable, blockOccupancy, stepScale);
+			}
+
+			for (int rayId = 0; rayId < noRays; rayId++)
+			{
+				pt_x[rayId] += stepLength[rayId] * dir_x[rayId];
+				pt_y[rayId] += stepLength[rayId] * dir_y[rayId];
+				pt_z[rayId] += stepLength[rayId] * dir_z[rayId];
+				totalLength[rayId] += stepLength[rayId];
+			}
+
+			noActive = 0;
+			for (int rayId = 0; rayId < noRays; rayId++)
+			{
+				isActive[rayId] = isActive[rayId] && totalLength[rayId] < totalLengthMax[rayId];
+				if (isActive[rayId]) noActive++;
+			}
+
+			isCoherent = noMisses <= RAYPACKET_CACHE_SIZE / 2;
+		}
+
+		// the remaining rays on their own
+		for (int rayId = 0; rayId < noRays; rayId++)
+		{
+			while (isActive[rayId])
+			{
+				linearIdx[rayId] = pointToVoxelBlockPos(Vector3i((int)ROUND(pt_x[rayId]), (int)ROUND(pt_y[rayId]), (int)ROUND(pt_z[rayId])), blockPos[rayId]);
+
+				blockPtr[rayId] = caches[rayId].blockPtr;
+				if (!IS_EQUAL3(blockPos[rayId], caches[rayId].blockPos)) blockPtr[rayId] = packetCache.Find(hashTable, blockPos[rayId]);
+
+				MarchStep(rayId, blockPos[rayId], linearIdx[rayId], blockPtr[rayId], pt_x, pt_y, pt_z, dir_x, dir_y, dir_z, stepLength, sdfValue,
+					isActive, caches, voxelData, hashTable, blockOccupancy, stepScale);
+				if (!isActive[rayId]) break;
+
+				pt_x[rayId] += stepLength[rayId] * dir_x[rayId];
+				pt_y[rayId] += stepLength[rayId] * dir_y[rayId];
+				pt_z[rayId] += stepLength[rayId] * dir_z[rayId];
+				totalLength[rayId] += stepLength[rayId];
+
+				isActive[rayId] = totalLength[rayId] < totalLengthMax[rayId];
+			}
+		}
+
+		// same refinement as in castRay
+		for (int rayId = 0; rayId < noRays; rayId++)
+		{
+			Vector3f pt_result(pt_x[rayId], pt_y[rayId], pt_z[rayId]), rayDirection(dir_x[rayId], dir_y[rayId], dir_z[rayId]);
+			bool pt_found, hash_found;
+			float sdf = sdfValue[rayId];
+
+			if (sdf <= 0.0f)
+			{
+				float step = sdf * stepScale;
+				pt_result += step * rayDirection;
+
+				sdf = readFromSDF_float_interpolated(voxelData, hashTable, pt_result, hash_found, caches[rayId]);
+				step = sdf * stepScale;
+				pt_result += step * rayDirection;
+
+				pt_found = true;
+			} else pt_found = false;
+
+			Vector4f & pt_out = pointsRay[locIds[rayId]];
+			pt_out.x = pt_result.x; pt_out.y = pt_result.y; pt_out.z = pt_result.z;
+			if (pt_found) pt_out.w = 1.0f; else pt_out.w = 0.0f;
+		}
+	}
+
+	/** One iteration of the loop in castRay for one ray, without moving
+	    the ray, except that unallocated space is left through the
+	    largest empty super-block. The ray is at voxel @p linearIdx of the
+	    block @p blockPos, whose voxel offset @p blockPtr has already been
+	    looked up.
+	*/
+	static void MarchStep(int rayId, const Vector3i & blockPos, int linearIdx, int blockPtr, const float *pt_x, const float *pt_y, const float *pt_z,
+		const float *dir_x, const float *dir_y, const float *dir_z, float *stepLength, float *sdfValue, bool *isActive, ITMVoxelBlockHash::IndexCache *caches,
+		const TVoxel *voxelData, const ITMHashEntry *hashTable, const int *blockOccupancy, float stepScale)
+	{
+		Vector3f pt_result(pt_x[rayId], pt_y[rayId], pt_z[rayId]);
+		ITMVoxelBlockHash::IndexCache & cache = caches[rayId];
+
+		if (blockPtr >= 0) { cache.blockPos = blockPos; cache.blockPtr = blockPtr; }
+
+		if (blockPtr < 0)
+		{
+			sdfValue[rayId] = TVoxel::SDF_valueToFloat(TVoxel().sdf);
+			stepLength[rayId] = emptySpaceStep(pt_result, Vector3f(dir_x[rayId], dir_y[rayId], dir_z[rayId]), blockPos, blockOccupancy);
+			return;
+		}
+
+		bool hash_found;
+		float sdf = TVoxel::SDF_valueToFloat(voxelData[blockPtr + linearIdx].sdf);
+		if ((sdf <= 0.1f) && (sdf >= -0.5f)) sdf = readFromSDF_float_interpolated(voxelData, hashTable, pt_result, hash_found, cache);
+		sdfValue[rayId] = sdf;
+
+		if (sdf <= 0.0f) { stepLength[rayId] = 0.0f; isActive[rayId] = false; }
+		else stepLength[rayId] = MAX(sdf * stepScale, 1.0f);
+	}
+};
+
+/** Raycasts the scene into renderState->raycastResult. If @p seedDepths
+    is given, rays with a seed depth only march within @p seedMargin of
+    it, and march the full range of the min/max image again if they find
+    no surface there.
+*/
 template<class TVoxel, class TIndex>
-static void GenericRaycast(const ITMScene<TVoxel,TIndex> *scene, const Vector2i& imgSize, const Matrix4f& invM, Vector4f projParams, const ITMRenderState *renderState)
+static void GenericRaycast(const ITMScene<TVoxel,TIndex> *scene, const Vector2i& imgSize, const Matrix4f& invM, Vector4f projParams, const ITMRenderState *renderState,
+	const float *seedDepths = NULL, float seedMargin = 0.0f)
 {
 	projParams.x = 1.0f / projParams.x;
 	projParams.y = 1.0f / projParams.y;
@@ -162,28 +534,45 @@ static void GenericRaycast(const ITMScene<TVoxel,TIndex> *scene, const Vector2i&
 	float oneOverVoxelSize = 1.0f / scene->sceneParams->voxelSize;
 	Vector4f *pointsRay = renderState->raycastResult->GetData(MEMORYDEVICE_CPU);
 	const TVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
-	const typename TIndex::IndexData *voxelIndex = scene->index.getIndexData();
+
+	Vector2i noPackets((imgSize.x + RAYPACKET_SIZE - 1) / RAYPACKET_SIZE, (imgSize.y + RAYPACKET_SIZE - 1) / RAYPACKET_SIZE);
 
 #ifdef WITH_OPENMP
 	#pragma omp parallel for
 #endif
-	for (int locId = 0; locId < imgSize.x*imgSize.y; ++locId)
+	for (int packetId = 0; packetId < noPackets.x * noPackets.y; ++packetId)
 	{
-		int y = locId/imgSize.x;
-		int x = locId - y*imgSize.x;
+		int y = (packetId / noPackets.x) * RAYPACKET_SIZE;
+		int x = (packetId % noPackets.x) * RAYPACKET_SIZE;
+
+		// all rays of a packet fall into the same pixel of the min/max image
 		int locId2 = (int)floor((float)x / minmaximg_subsample) + (int)floor((float)y / minmaximg_subsample) * imgSize.x;
 
-		castRay<TVoxel, TIndex>(
-			pointsRay[locId],
-			x, y,
-			voxelData,
-			voxelIndex,
-			invM,
-			projParams,
-			oneOverVoxelSize,
-			mu,
-			minmaximg[locId2]
-		);
+		Vector2f rayRanges[RAYPACKET_NO_RAYS];
+		bool isSeeded[RAYPACKET_NO_RAYS];
+
+		int rayId = 0;
+		for (int yy = y; yy < MIN(y + RAYPACKET_SIZE, imgSize.y); yy++) for (int xx = x; xx < MIN(x + RAYPACKET_SIZE, imgSize.x); xx++, rayId++)
+		{
+			float seedDepth = (seedDepths != NULL) ? seedDepths[xx + yy * imgSize.x] : 0.0f;
+
+			isSeeded[rayId] = seedDepth > 0.0f;
+			rayRanges[rayId] = minmaximg[locId2];
+			if (isSeeded[rayId]) rayRanges[rayId] = Vector2f(MAX(rayRanges[rayId].x, seedDepth - seedMargin), MIN(rayRanges[rayId].y, seedDepth + seedMargin));
+		}
+
+		RayPacketCaster<TVoxel, TIndex>::Cast(pointsRay, x, y, imgSize, voxelData, &(scene->index), invM, projParams, oneOverVoxelSize, mu, rayRanges);
+
+		if (seedDepths == NULL) continue;
+
+		rayId = 0;
+		for (int yy = y; yy < MIN(y + RAYPACKET_SIZE, imgSize.y); yy++) for (int xx = x; xx < MIN(x + RAYPACKET_SIZE, imgSize.x); xx++, rayId++)
+		{
+			Vector4f & pt_out = pointsRay[xx + yy * imgSize.x];
+			if (!isSeeded[rayId] || pt_out.w > 0.0f) continue;
+
+			castRay<TVoxel, TIndex>(pt_out, xx, yy, voxelData, scene->index.getIndexData(), invM, projParams, oneOverVoxelSize, mu, minmaximg[locId2]);
+		}
 	}
 }
 
@@ -263,13 +652,105 @@ static void CreatePointCloud_common(const ITMScene<TVoxel,TIndex> *scene, const
 	);
 }
 
+/// Atomic if several threads may update @p target at once. Returns the previous value of @p target.
+static inline int compareAndSwap(int *target, int expected, int desired)
+{
+#if defined(WITH_OPENMP) && defined(_MSC_VER)
+	return (int)_InterlockedCompareExchange((volatile long*)target, (long)desired, (long)expected);
+#elif defined(WITH_OPENMP)
+	return __sync_val_compare_and_swap(target, expected, desired);
+#else
+	int previous = *target;
+	if (previous == expected) *target = desired;
+	return previous;
+#endif
+}
+
+/// Depth of a raycast point in the camera it is forward projected into
+static inline float forwardProjectedDepth(const Vector4f & pixel, const Matrix4f & M, float voxelSize)
+{
+	Vector4f pt = pixel * voxelSize; pt.w = 1.0f;
+	return (M * pt).z;
+}
+
+/** Whether the point from source pixel @p locId replaces the one from
+    @p otherLocId when both are splatted into the same pixel. Ties go to
+    the later pixel, as with serial splatting in scan order.
+*/
+static inline bool isNearerSplat(float z, int locId, float otherZ, int otherLocId)
+{
+	return z < otherZ || (z == otherZ && locId > otherLocId);
+}
+
+/** Splat the raycast points @p pointsRay into the view with pose @p M,
+    storing the id of the nearest point that lands in each pixel, or -1,
+    in @p sources.
+*/
+static void SplatNearestPoints(int *sources, const Vector4f *pointsRay, const Matrix4f & M, const Vector4f & projParams, float voxelSize,
+	const Vector2i & imgSize)
+{
+	for (int locId = 0; locId < imgSize.x * imgSize.y; locId++) sources[locId] = -1;
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int locId = 0; locId < imgSize.x * imgSize.y; locId++)
+	{
+		int locId_new = forwardProjectPixel(pointsRay[locId] * voxelSize, M, projParams, imgSize);
+		if (locId_new < 0) continue;
+
+		float z = forwardProjectedDepth(pointsRay[locId], M, voxelSize);
+		if (!(z > 0.0f)) continue;
+
+		int current = sources[locId_new];
+		while (current < 0 || isNearerSplat(z, locId, forwardProjectedDepth(pointsRay[current], M, voxelSize), current))
+		{
+			int previous = compareAndSwap(&sources[locId_new], current, locId);
+			if (previous == current) break;
+			current = previous;
+		}
+	}
+}
+
+/** Reproject the surface found by the previous raycast into the view
+    with pose @p M, giving the depth near which each new ray should find
+    the surface, or 0 where the previous raycast saw none. @p sources is
+    scratch space of the image size.
+*/
+static void ComputeRaycastSeeds(float *seedDepths, int *sources, const Vector4f *pointsRay, const Matrix4f & M, const Vector4f & projParams,
+	float voxelSize, const Vector2i & imgSize)
+{
+	SplatNearestPoints(sources, pointsRay, M, projParams, voxelSize, imgSize);
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int locId = 0; locId < imgSize.x * imgSize.y; locId++)
+	{
+		int sourceId = sources[locId];
+		seedDepths[locId] = (sourceId >= 0 && pointsRay[sourceId].w > 0.0f) ? forwardProjectedDepth(pointsRay[sourceId], M, voxelSize) : 0.0f;
+	}
+}
+
 template<class TVoxel, class TIndex>
-static void CreateICPMaps_common(const ITMScene<TVoxel,TIndex> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState)
+static void CreateICPMaps_common(const ITMScene<TVoxel,TIndex> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState,
+	ITMFloatImage *raycastSeeds)
 {
 	Vector2i imgSize = renderState->raycastResult->noDims;
 	Matrix4f invM = trackingState->pose_d->GetInvM();
 
-	GenericRaycast(scene, imgSize, invM, view->calib->intrinsics_d.projectionParamsSimple.all, renderState);
+	const float *seedDepths = NULL;
+	if (raycastSeeds != NULL)
+	{
+		raycastSeeds->ChangeDims(imgSize);
+		ComputeRaycastSeeds(raycastSeeds->GetData(MEMORYDEVICE_CPU), renderState->fwdProjMissingPoints->GetData(MEMORYDEVICE_CPU),
+			renderState->raycastResult->GetData(MEMORYDEVICE_CPU), trackingState->pose_d->GetM(), view->calib->intrinsics_d.projectionParamsSimple.all,
+			scene->sceneParams->voxelSize, imgSize);
+		seedDepths = raycastSeeds->GetData(MEMORYDEVICE_CPU);
+	}
+
+	GenericRaycast(scene, imgSize, invM, view->calib->intrinsics_d.projectionParamsSimple.all, renderState, seedDepths,
+		RAYCAST_SEED_MARGIN * scene->sceneParams->mu);
 	trackingState->pose_pointCloud->SetFrom(trackingState->pose_d);
 
 	Vector3f lightSource = -Vector3f(invM.getColumn(2));
@@ -279,6 +760,21 @@ static void CreateICPMaps_common(const ITMScene<TVoxel,TIndex> *scene, const ITM
 	Vector4f *pointsRay = renderState->raycastResult->GetData(MEMORYDEVICE_CPU);
 	float voxelSize = scene->sceneParams->voxelSize;
 
+	if (trackingState->pointCloud->compactDepth != NULL)
+	{
+		float *compactDepthMap = trackingState->pointCloud->compactDepth->GetData(MEMORYDEVICE_CPU);
+		Vector2s_ *compactNormalsMap = trackingState->pointCloud->compactNormals->GetData(MEMORYDEVICE_CPU);
+		Matrix4f M = trackingState->pose_d->GetM();
+
+#ifdef WITH_OPENMP
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
+			processPixelICP<true>(outRendering, compactDepthMap, compactNormalsMap, pointsRay, imgSize, x, y, voxelSize, lightSource, M);
+
+		return;
+	}
+
 #ifdef WITH_OPENMP
 	#pragma omp parallel for
 #endif
@@ -286,6 +782,20 @@ static void CreateICPMaps_common(const ITMScene<TVoxel,TIndex> *scene, const ITM
 		processPixelICP<true>(outRendering, pointsMap, normalsMap, pointsRay, imgSize, x, y, voxelSize, lightSource);
 }
 
+/// Whether a pixel received no valid forward projected point and has to be raycast again
+static inline bool isMissingForwardPoint(int x, int y, const Vector4f *forwardProjection, const float *currentDepth, const Vector2f *minmaximg,
+	const Vector2i & imgSize)
+{
+	int locId = x + y * imgSize.x;
+	int locId2 = (int)floor((float)x / minmaximg_subsample) + (int)floor((float)y / minmaximg_subsample) * imgSize.x;
+
+	Vector4f fwdPoint = forwardProjection[locId];
+	Vector2f minmaxval = minmaximg[locId2];
+	float depth = currentDepth[locId];
+
+	return (fwdPoint.w <= 0) && ((fwdPoint.x == 0 && fwdPoint.y == 0 && fwdPoint.z == 0) || (depth >= 0)) && (minmaxval.x < minmaxval.y);
+}
+
 template<class TVoxel, class TIndex>
 static void ForwardRender_common(const ITMScene<TVoxel, TIndex> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState)
 {
@@ -308,37 +818,51 @@ static void ForwardRender_common(const ITMScene<TVoxel, TIndex> *scene, const IT
 	const TVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
 	const typename TIndex::IndexData *voxelIndex = scene->index.getIndexData();
 
-	renderState->forwardProjection->Clear();
+	// splat the raycast points into the new view, with the source pixel ids kept in fwdProjMissingPoints
+	int *fwdProjSources = fwdProjMissingPoints;
+	SplatNearestPoints(fwdProjSources, pointsRay, M, projParams, voxelSize, imgSize);
 
-	for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int locId = 0; locId < imgSize.x * imgSize.y; locId++)
 	{
-		int locId = x + y * imgSize.x;
-		Vector4f pixel = pointsRay[locId];
-
-		int locId_new = forwardProjectPixel(pixel * voxelSize, M, projParams, imgSize);
-		if (locId_new >= 0) forwardProjection[locId_new] = pixel;
+		int sourceId = fwdProjSources[locId];
+		forwardProjection[locId] = (sourceId >= 0) ? pointsRay[sourceId] : Vector4f(0.0f);
 	}
 
-	int noMissingPoints = 0;
-	for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
+	// collect the pixels to raycast again, in scan order: count them per row first, then write each row at its offset
+	std::vector<int> rowOffsets(imgSize.y + 1, 0);
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < imgSize.y; y++)
 	{
-		int locId = x + y * imgSize.x;
-		int locId2 = (int)floor((float)x / minmaximg_subsample) + (int)floor((float)y / minmaximg_subsample) * imgSize.x;
+		int noRowPoints = 0;
+		for (int x = 0; x < imgSize.x; x++)
+			if (isMissingForwardPoint(x, y, forwardProjection, currentDepth, minmaximg, imgSize)) noRowPoints++;
+		rowOffsets[y + 1] = noRowPoints;
+	}
 
-		Vector4f fwdPoint = forwardProjection[locId];
-		Vector2f minmaxval = minmaximg[locId2];
-		float depth = currentDepth[locId];
+	for (int y = 0; y < imgSize.y; y++) rowOffsets[y + 1] += rowOffsets[y];
 
-		if ((fwdPoint.w <= 0) && ((fwdPoint.x == 0 && fwdPoint.y == 0 && fwdPoint.z == 0) || (depth >= 0)) && (minmaxval.x < minmaxval.y))
-		//if ((fwdPoint.w <= 0) && (minmaxval.x < minmaxval.y))
-		{
-			fwdProjMissingPoints[noMissingPoints] = locId;
-			noMissingPoints++;
-		}
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < imgSize.y; y++)
+	{
+		int offset = rowOffsets[y];
+		for (int x = 0; x < imgSize.x; x++)
+			if (isMissingForwardPoint(x, y, forwardProjection, currentDepth, minmaximg, imgSize)) fwdProjMissingPoints[offset++] = x + y * imgSize.x;
 	}
 
+	int noMissingPoints = rowOffsets[imgSize.y];
 	renderState->noFwdProjMissingPoints = noMissingPoints;
-    
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for schedule(dynamic, 64)
+#endif
 	for (int pointId = 0; pointId < noMissingPoints; pointId++)
 	{
 		int locId = fwdProjMissingPoints[pointId];
@@ -349,6 +873,9 @@ static void ForwardRender_common(const ITMScene<TVoxel, TIndex> *scene, const IT
 			1.0f / scene->sceneParams->voxelSize, scene->sceneParams->mu, minmaximg[locId2]);
 	}
 
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
 	for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
 		processPixelForwardRender<true>(outRendering, forwardProjection, imgSize, x, y, voxelSize, lightSource);
 }
@@ -397,14 +924,14 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreatePointCloud(cons
 template<class TVoxel, class TIndex>
 void ITMVisualisationEngine_CPU<TVoxel,TIndex>::CreateICPMaps(const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState) const
 {
-	CreateICPMaps_common(this->scene, view, trackingState, renderState);
+	CreateICPMaps_common(this->scene, view, trackingState, renderState, raycastSeeds);
 }
 
 template<class TVoxel>
 void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreateICPMaps(const ITMView *view, ITMTrackingState *trackingState, 
 	ITMRenderState *renderState) const
 {
-	CreateICPMaps_common(this->scene, view, trackingState, renderState);
+	CreateICPMaps_common(this->scene, view, trackingState, renderState, raycastSeeds);
 }
 
 template<class TVoxel, class TIndex>
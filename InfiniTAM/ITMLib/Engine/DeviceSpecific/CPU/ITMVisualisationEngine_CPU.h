@@ -4,6 +4,8 @@
 
 #include "../../ITMVisualisationEngine.h"
 
+struct RenderingBlock;
+
 namespace ITMLib
 {
 	namespace Engine
@@ -11,9 +13,18 @@ namespace ITMLib
 		template<class TVoxel, class TIndex>
 		class ITMVisualisationEngine_CPU : public ITMVisualisationEngine < TVoxel, TIndex >
 		{
+		private:
+			/// Start depths of the tracking raycasts, reprojected from the previous raycast, or NULL if seeding is disabled
+			ITMFloatImage *raycastSeeds;
+
 		public:
-			explicit ITMVisualisationEngine_CPU(ITMScene<TVoxel, TIndex> *scene) : ITMVisualisationEngine<TVoxel, TIndex>(scene) { }
-			~ITMVisualisationEngine_CPU(void) { }
+			explicit ITMVisualisationEngine_CPU(ITMScene<TVoxel, TIndex> *scene, bool useTemporalRaycastSeeding = false)
+				: ITMVisualisationEngine<TVoxel, TIndex>(scene)
+			{
+				raycastSeeds = useTemporalRaycastSeeding ? new ITMFloatImage(true, false) : NULL;
+			}
+
+			~ITMVisualisationEngine_CPU(void) { delete raycastSeeds; }
 
 			void FindVisibleBlocks(const ITMPose *pose, const ITMIntrinsics *intrinsics, ITMRenderState *renderState) const;
 			void CreateExpectedDepths(const ITMPose *pose, const ITMIntrinsics *intrinsics, ITMRenderState *renderState) const;
@@ -30,10 +41,22 @@ namespace ITMLib
 		template<class TVoxel>
 		class ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash> : public ITMVisualisationEngine < TVoxel, ITMVoxelBlockHash >
 		{
+		private:
+			/// Image space bounding boxes of the visible blocks, kept between calls of CreateExpectedDepths
+			RenderingBlock *projectedBlocks;
+
+			/// Ids of the projected blocks overlapping each tile of the min/max image, grouped by tile
+			int *tileBlockIds;
+
+			/// Bin offsets of the tiles in tileBlockIds, only reallocated when the number of tiles changes
+			ITMIntImage *tileOffsets;
+
+			/// Start depths of the tracking raycasts, reprojected from the previous raycast, or NULL if seeding is disabled
+			ITMFloatImage *raycastSeeds;
+
 		public:
-			explicit ITMVisualisationEngine_CPU(ITMScene<TVoxel, ITMVoxelBlockHash> *scene) 
-				: ITMVisualisationEngine<TVoxel, ITMVoxelBlockHash>(scene) { }
-			~ITMVisualisationEngine_CPU(void) { }
+			explicit ITMVisualisationEngine_CPU(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, bool useTemporalRaycastSeeding = false);
+			~ITMVisualisationEngine_CPU(void);
 
 			void FindVisibleBlocks(const ITMPose *pose, const ITMIntrinsics *intrinsics, ITMRenderState *renderState) const;
 			void CreateExpectedDepths(const ITMPose *pose, const ITMIntrinsics *intrinsics, ITMRenderState *renderState) const;
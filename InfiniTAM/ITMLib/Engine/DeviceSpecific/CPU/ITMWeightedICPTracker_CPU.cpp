@@ -5,9 +5,31 @@
 
 using namespace ITMLib::Engine;
 
+template<class TPoint, class TNormal>
+static inline bool computePerPointGH_wICP_CPU(TrackerIterationType iterationType, float *localNabla, float *localHessian, float &localF, float &localWeight, int x, int y,
+	float depth, const Vector2i &viewImageSize, const Vector4f &viewIntrinsics, const Vector2i &sceneImageSize, const Vector4f &sceneIntrinsics,
+	const Matrix4f &approxInvPose, const Matrix4f &scenePose, const TPoint *pointsMap, const TNormal *normalsMap, float distThresh)
+{
+	switch (iterationType)
+	{
+	case TRACKER_ITERATION_ROTATION:
+		return computePerPointGH_wICP<true, true>(localNabla, localHessian, localF, localWeight, x, y, depth, viewImageSize,
+			viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh);
+	case TRACKER_ITERATION_TRANSLATION:
+		return computePerPointGH_wICP<true, false>(localNabla, localHessian, localF, localWeight, x, y, depth, viewImageSize,
+			viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh);
+	case TRACKER_ITERATION_BOTH:
+		return computePerPointGH_wICP<false, false>(localNabla, localHessian, localF, localWeight, x, y, depth, viewImageSize,
+			viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh);
+	default:
+		return false;
+	}
+}
+
 ITMWeightedICPTracker_CPU::ITMWeightedICPTracker_CPU(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, int noICPRunTillLevel,
-	float distThresh, float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine) :ITMWeightedICPTracker(imgSize, trackingRegime, noHierarchyLevels,
-	noICPRunTillLevel, distThresh, terminationThreshold, lowLevelEngine, MEMORYDEVICE_CPU) { }
+	float distThresh, float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine, ITMLibSettings::PixelSelectionType pixelSelectionType,
+	int pixelSelectionStride) :ITMWeightedICPTracker(imgSize, trackingRegime, noHierarchyLevels, noICPRunTillLevel, distThresh, terminationThreshold,
+	lowLevelEngine, MEMORYDEVICE_CPU, pixelSelectionType, pixelSelectionStride) { }
 
 ITMWeightedICPTracker_CPU::~ITMWeightedICPTracker_CPU(void) { }
 
@@ -15,6 +37,8 @@ int ITMWeightedICPTracker_CPU::ComputeGandH(float &f, float *nabla, float *hessi
 {
 	Vector4f *pointsMap = sceneHierarchyLevel->pointsMap->GetData(MEMORYDEVICE_CPU);
 	Vector4f *normalsMap = sceneHierarchyLevel->normalsMap->GetData(MEMORYDEVICE_CPU);
+	float *compactDepthMap = (sceneHierarchyLevel->compactDepthMap != NULL) ? sceneHierarchyLevel->compactDepthMap->GetData(MEMORYDEVICE_CPU) : NULL;
+	Vector2s_ *compactNormalsMap = (sceneHierarchyLevel->compactNormalsMap != NULL) ? sceneHierarchyLevel->compactNormalsMap->GetData(MEMORYDEVICE_CPU) : NULL;
 	Vector4f sceneIntrinsics = sceneHierarchyLevel->intrinsics;
 	Vector2i sceneImageSize = sceneHierarchyLevel->pointsMap->noDims;
 
@@ -37,9 +61,14 @@ int ITMWeightedICPTracker_CPU::ComputeGandH(float &f, float *nabla, float *hessi
 	memset(sumHessian, 0, sizeof(float) * noParaSQ);
 	memset(sumNabla, 0, sizeof(float) * noPara);
 
+	int noPixels = (selectionHierarchyLevel != NULL) ? selectionHierarchyLevel->noSelected : viewImageSize.x * viewImageSize.y;
+	const int *selectedPixels = (selectionHierarchyLevel != NULL) ? selectionHierarchyLevel->indices->GetData(MEMORYDEVICE_CPU) : NULL;
 
-	for (int y = 0; y < viewImageSize.y; y++) for (int x = 0; x < viewImageSize.x; x++)
+	for (int pixelId = 0; pixelId < noPixels; pixelId++)
 	{
+		int locId = (selectedPixels != NULL) ? selectedPixels[pixelId] : pixelId;
+		int y = locId / viewImageSize.x, x = locId - y * viewImageSize.x;
+
 		float localWeight = weight[x + y*viewImageSize.x] > 0 ? minSigmaZ / weight[x + y*viewImageSize.x] * 0.5f + 0.5f : 0.0f;
 
 		float localHessian[6 + 5 + 4 + 3 + 2 + 1], localNabla[6], localF = 0;
@@ -49,24 +78,12 @@ int ITMWeightedICPTracker_CPU::ComputeGandH(float &f, float *nabla, float *hessi
 
 		bool isValidPoint;
         
-		switch (iterationType)
-		{
-		case TRACKER_ITERATION_ROTATION:
-			isValidPoint = computePerPointGH_wICP<true, true>(localNabla, localHessian, localF, localWeight, x, y, depth[x + y * viewImageSize.x], viewImageSize,
-				viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh[levelId]);
-			break;
-		case TRACKER_ITERATION_TRANSLATION:
-			isValidPoint = computePerPointGH_wICP<true, false>(localNabla, localHessian, localF, localWeight, x, y, depth[x + y * viewImageSize.x], viewImageSize,
+		if (compactDepthMap != NULL)
+			isValidPoint = computePerPointGH_wICP_CPU(iterationType, localNabla, localHessian, localF, localWeight, x, y, depth[x + y * viewImageSize.x], viewImageSize,
+				viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, compactDepthMap, compactNormalsMap, distThresh[levelId]);
+		else
+			isValidPoint = computePerPointGH_wICP_CPU(iterationType, localNabla, localHessian, localF, localWeight, x, y, depth[x + y * viewImageSize.x], viewImageSize,
 				viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh[levelId]);
-			break;
-		case TRACKER_ITERATION_BOTH:
-			isValidPoint = computePerPointGH_wICP<false, false>(localNabla, localHessian, localF, localWeight, x, y, depth[x + y * viewImageSize.x], viewImageSize,
-				viewIntrinsics, sceneImageSize, sceneIntrinsics, approxInvPose, scenePose, pointsMap, normalsMap, distThresh[levelId]);
-			break;
-		default:
-			isValidPoint = false;
-			break;
-		}
 
 		if (isValidPoint)
 		{
@@ -18,6 +18,10 @@ __global__ void filterSubsampleWithHoles_device(Vector4f *imageData_out, Vector2
 __global__ void gradientX_device(Vector4s *grad, const Vector4u *image, Vector2i imgSize);
 __global__ void gradientY_device(Vector4s *grad, const Vector4u *image, Vector2i imgSize);
 
+__global__ void convertColourToIntensity_device(uchar *imageData_out, Vector2i imgSize, const Vector4u *imageData_in);
+__global__ void filterSubsample_device(uchar *imageData_out, Vector2i newDims, const uchar *imageData_in, Vector2i oldDims);
+__global__ void gradient_device(Vector2s_ *grad, const uchar *image, Vector2i imgSize);
+
 // host methods
 
 void ITMLowLevelEngine_CUDA::CopyImage(ITMUChar4Image *image_out, const ITMUChar4Image *image_in) const
@@ -124,6 +128,52 @@ void ITMLowLevelEngine_CUDA::GradientY(ITMShort4Image *grad_out, const ITMUChar4
 	gradientY_device << <gridSize, blockSize >> >(grad, image, imgSize);
 }
 
+void ITMLowLevelEngine_CUDA::ConvertColourToIntensity(ITMUCharImage *image_out, const ITMUChar4Image *image_in) const
+{
+	Vector2i imgSize = image_in->noDims;
+	image_out->ChangeDims(imgSize);
+
+	const Vector4u *imageData_in = image_in->GetData(MEMORYDEVICE_CUDA);
+	uchar *imageData_out = image_out->GetData(MEMORYDEVICE_CUDA);
+
+	dim3 blockSize(16, 16);
+	dim3 gridSize((int)ceil((float)imgSize.x / (float)blockSize.x), (int)ceil((float)imgSize.y / (float)blockSize.y));
+
+	convertColourToIntensity_device << <gridSize, blockSize >> >(imageData_out, imgSize, imageData_in);
+}
+
+void ITMLowLevelEngine_CUDA::FilterSubsample(ITMUCharImage *image_out, const ITMUCharImage *image_in) const
+{
+	Vector2i oldDims = image_in->noDims;
+	Vector2i newDims; newDims.x = image_in->noDims.x / 2; newDims.y = image_in->noDims.y / 2;
+
+	image_out->ChangeDims(newDims);
+
+	const uchar *imageData_in = image_in->GetData(MEMORYDEVICE_CUDA);
+	uchar *imageData_out = image_out->GetData(MEMORYDEVICE_CUDA);
+
+	dim3 blockSize(16, 16);
+	dim3 gridSize((int)ceil((float)newDims.x / (float)blockSize.x), (int)ceil((float)newDims.y / (float)blockSize.y));
+
+	filterSubsample_device << <gridSize, blockSize >> >(imageData_out, newDims, imageData_in, oldDims);
+}
+
+void ITMLowLevelEngine_CUDA::Gradient(ITMShort2Image *grad_out, const ITMUCharImage *image_in) const
+{
+	grad_out->ChangeDims(image_in->noDims);
+	Vector2i imgSize = image_in->noDims;
+
+	Vector2s_ *grad = grad_out->GetData(MEMORYDEVICE_CUDA);
+	const uchar *image = image_in->GetData(MEMORYDEVICE_CUDA);
+
+	dim3 blockSize(16, 16);
+	dim3 gridSize((int)ceil((float)imgSize.x / (float)blockSize.x), (int)ceil((float)imgSize.y / (float)blockSize.y));
+
+	ITMSafeCall(cudaMemset(grad, 0, imgSize.x * imgSize.y * sizeof(Vector2s)));
+
+	gradient_device << <gridSize, blockSize >> >(grad, image, imgSize);
+}
+
 // device functions
 
 __global__ void filterSubsample_device(Vector4u *imageData_out, Vector2i newDims, const Vector4u *imageData_in, Vector2i oldDims)
@@ -170,3 +220,30 @@ __global__ void gradientY_device(Vector4s *grad, const Vector4u *image, Vector2i
 
 	gradientY(grad, x, y, image, imgSize);
 }
+
+__global__ void convertColourToIntensity_device(uchar *imageData_out, Vector2i imgSize, const Vector4u *imageData_in)
+{
+	int x = threadIdx.x + blockIdx.x * blockDim.x, y = threadIdx.y + blockIdx.y * blockDim.y;
+
+	if (x > imgSize.x - 1 || y > imgSize.y - 1) return;
+
+	convertColourToIntensity(imageData_out, x, y, imgSize, imageData_in);
+}
+
+__global__ void filterSubsample_device(uchar *imageData_out, Vector2i newDims, const uchar *imageData_in, Vector2i oldDims)
+{
+	int x = threadIdx.x + blockIdx.x * blockDim.x, y = threadIdx.y + blockIdx.y * blockDim.y;
+
+	if (x > newDims.x - 1 || y > newDims.y - 1) return;
+
+	filterSubsample(imageData_out, x, y, newDims, imageData_in, oldDims);
+}
+
+__global__ void gradient_device(Vector2s_ *grad, const uchar *image, Vector2i imgSize)
+{
+	int x = threadIdx.x + blockIdx.x * blockDim.x, y = threadIdx.y + blockIdx.y * blockDim.y;
+
+	if (x < 1 || x > imgSize.x - 2 || y < 1 || y > imgSize.y - 2) return;
+
+	gradient(grad, x, y, image, imgSize);
+}
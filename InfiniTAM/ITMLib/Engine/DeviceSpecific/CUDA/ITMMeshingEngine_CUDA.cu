@@ -17,14 +17,15 @@ using namespace ITMLib::Engine;
 template<class TVoxel>
 ITMMeshingEngine_CUDA<TVoxel,ITMVoxelBlockHash>::ITMMeshingEngine_CUDA(void) 
 {
-	ITMSafeCall(cudaMalloc((void**)&visibleBlockGlobalPos_device, SDF_LOCAL_BLOCK_NUM * sizeof(Vector4s)));
+	// sized for the voxel block array of the scene on first use
+	visibleBlockGlobalPos_device = NULL; noVisibleBlockGlobalPos = 0;
 	ITMSafeCall(cudaMalloc((void**)&noTriangles_device, sizeof(unsigned int)));
 }
 
 template<class TVoxel>
 ITMMeshingEngine_CUDA<TVoxel,ITMVoxelBlockHash>::~ITMMeshingEngine_CUDA(void) 
 {
-	ITMSafeCall(cudaFree(visibleBlockGlobalPos_device));
+	if (visibleBlockGlobalPos_device != NULL) ITMSafeCall(cudaFree(visibleBlockGlobalPos_device));
 	ITMSafeCall(cudaFree(noTriangles_device));
 }
 
@@ -36,10 +37,19 @@ void ITMMeshingEngine_CUDA<TVoxel, ITMVoxelBlockHash>::MeshScene(ITMMesh *mesh,
 	const ITMHashEntry *hashTable = scene->index.GetEntries();
 
 	int noMaxTriangles = mesh->noMaxTriangles, noTotalEntries = scene->index.noTotalEntries;
+	// padded to the 16 rows of the meshing grid, the padding stays marked as unused
+	int noVoxelBlocks = (scene->index.getNumAllocatedVoxelBlocks() + 15) / 16 * 16;
 	float factor = scene->sceneParams->voxelSize;
 
+	if (noVisibleBlockGlobalPos != noVoxelBlocks)
+	{
+		if (visibleBlockGlobalPos_device != NULL) ITMSafeCall(cudaFree(visibleBlockGlobalPos_device));
+		ITMSafeCall(cudaMalloc((void**)&visibleBlockGlobalPos_device, noVoxelBlocks * sizeof(Vector4s)));
+		noVisibleBlockGlobalPos = noVoxelBlocks;
+	}
+
 	ITMSafeCall(cudaMemset(noTriangles_device, 0, sizeof(unsigned int)));
-	ITMSafeCall(cudaMemset(visibleBlockGlobalPos_device, 0, sizeof(Vector4s) * SDF_LOCAL_BLOCK_NUM));
+	ITMSafeCall(cudaMemset(visibleBlockGlobalPos_device, 0, sizeof(Vector4s) * noVoxelBlocks));
 
 	{ // identify used voxel blocks
 		dim3 cudaBlockSize(256); 
@@ -50,7 +60,7 @@ void ITMMeshingEngine_CUDA<TVoxel, ITMVoxelBlockHash>::MeshScene(ITMMesh *mesh,
 
 	{ // mesh used voxel blocks
 		dim3 cudaBlockSize(SDF_BLOCK_SIZE, SDF_BLOCK_SIZE, SDF_BLOCK_SIZE);
-		dim3 gridSize(SDF_LOCAL_BLOCK_NUM / 16, 16);
+		dim3 gridSize(noVoxelBlocks / 16, 16);
 
 		meshScene_device<TVoxel> << <gridSize, cudaBlockSize >> >(triangles, noTriangles_device, factor, noTotalEntries, noMaxTriangles,
 			visibleBlockGlobalPos_device, localVBA, hashTable);
@@ -18,6 +18,7 @@ namespace ITMLib
 		private:
 			unsigned int  *noTriangles_device;
 			Vector4s *visibleBlockGlobalPos_device;
+			int noVisibleBlockGlobalPos;
 
 		public:
 			void MeshScene(ITMMesh *mesh, const ITMScene<TVoxel, ITMVoxelBlockHash> *scene);
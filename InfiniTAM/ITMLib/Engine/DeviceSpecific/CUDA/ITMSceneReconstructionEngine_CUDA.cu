@@ -5,10 +5,12 @@
 #include "../../DeviceAgnostic/ITMSceneReconstructionEngine.h"
 #include "../../../Objects/ITMRenderState_VH.h"
 
+// the two allocation counters have to stay the first two members, takeAllocationEntries() updates them together
 struct AllocationTempData {
 	int noAllocatedVoxelEntries;
 	int noAllocatedExcessEntries;
 	int noVisibleEntries;
+	int noDroppedAllocations;
 };
 
 using namespace ITMLib::Engine;
@@ -28,7 +30,7 @@ __global__ void buildHashAllocAndVisibleType_device(uchar *entriesAllocType, uch
 	float viewFrustrum_max);
 
 __global__ void allocateVoxelBlocksList_device(int *voxelAllocationList, int *excessAllocationList, ITMHashEntry *hashTable, int noTotalEntries,
-	AllocationTempData *allocData, uchar *entriesAllocType, uchar *entriesVisibleType, Vector4s *blockCoords);
+	int noOrderedEntries, AllocationTempData *allocData, uchar *entriesAllocType, uchar *entriesVisibleType, Vector4s *blockCoords);
 
 __global__ void reAllocateSwappedOutVoxelBlocks_device(int *voxelAllocationList, ITMHashEntry *hashTable, int noTotalEntries,
 	AllocationTempData *allocData, uchar *entriesVisibleType);
@@ -48,9 +50,9 @@ ITMSceneReconstructionEngine_CUDA<TVoxel,ITMVoxelBlockHash>::ITMSceneReconstruct
 	ITMSafeCall(cudaMalloc((void**)&allocationTempData_device, sizeof(AllocationTempData)));
 	ITMSafeCall(cudaMallocHost((void**)&allocationTempData_host, sizeof(AllocationTempData)));
 
-	int noTotalEntries = ITMVoxelBlockHash::noTotalEntries;
-	ITMSafeCall(cudaMalloc((void**)&entriesAllocType_device, noTotalEntries));
-	ITMSafeCall(cudaMalloc((void**)&blockCoords_device, noTotalEntries * sizeof(Vector4s)));
+	// sized for the hash table of the scene on first use
+	entriesAllocType_device = NULL; blockCoords_device = NULL;
+	noAllocTypeEntries = 0;
 }
 
 template<class TVoxel>
@@ -58,8 +60,8 @@ ITMSceneReconstructionEngine_CUDA<TVoxel,ITMVoxelBlockHash>::~ITMSceneReconstruc
 {
 	ITMSafeCall(cudaFreeHost(allocationTempData_host));
 	ITMSafeCall(cudaFree(allocationTempData_device));
-	ITMSafeCall(cudaFree(entriesAllocType_device));
-	ITMSafeCall(cudaFree(blockCoords_device));
+	if (entriesAllocType_device != NULL) ITMSafeCall(cudaFree(entriesAllocType_device));
+	if (blockCoords_device != NULL) ITMSafeCall(cudaFree(blockCoords_device));
 }
 
 template<class TVoxel>
@@ -80,9 +82,10 @@ void ITMSceneReconstructionEngine_CUDA<TVoxel,ITMVoxelBlockHash>::ResetScene(ITM
 	ITMHashEntry *hashEntry_ptr = scene->index.GetEntries();
 	memsetKernel<ITMHashEntry>(hashEntry_ptr, tmpEntry, scene->index.noTotalEntries);
 	int *excessList_ptr = scene->index.GetExcessAllocationList();
-	fillArrayKernel<int>(excessList_ptr, SDF_EXCESS_LIST_SIZE);
+	fillArrayKernel<int>(excessList_ptr, scene->index.GetNoExcessEntries());
 
-	scene->index.SetLastFreeExcessListId(SDF_EXCESS_LIST_SIZE - 1);
+	scene->index.SetLastFreeExcessListId(scene->index.GetNoExcessEntries() - 1);
+	scene->index.SetNoDroppedAllocations(0);
 }
 
 template<class TVoxel>
@@ -114,6 +117,15 @@ void ITMSceneReconstructionEngine_CUDA<TVoxel, ITMVoxelBlockHash>::AllocateScene
 
 	int noTotalEntries = scene->index.noTotalEntries;
 
+	if (noAllocTypeEntries < noTotalEntries)
+	{
+		if (entriesAllocType_device != NULL) ITMSafeCall(cudaFree(entriesAllocType_device));
+		if (blockCoords_device != NULL) ITMSafeCall(cudaFree(blockCoords_device));
+		ITMSafeCall(cudaMalloc((void**)&entriesAllocType_device, noTotalEntries));
+		ITMSafeCall(cudaMalloc((void**)&blockCoords_device, noTotalEntries * sizeof(Vector4s)));
+		noAllocTypeEntries = noTotalEntries;
+	}
+
 	int *visibleEntryIDs = renderState_vh->GetVisibleEntryIDs();
 	uchar *entriesVisibleType = renderState_vh->GetEntriesVisibleType();
 
@@ -132,6 +144,7 @@ void ITMSceneReconstructionEngine_CUDA<TVoxel, ITMVoxelBlockHash>::AllocateScene
 	tempData->noAllocatedVoxelEntries = scene->localVBA.lastFreeBlockId;
 	tempData->noAllocatedExcessEntries = scene->index.GetLastFreeExcessListId();
 	tempData->noVisibleEntries = 0;
+	tempData->noDroppedAllocations = 0;
 	ITMSafeCall(cudaMemcpyAsync(allocationTempData_device, tempData, sizeof(AllocationTempData), cudaMemcpyHostToDevice));
 
 	ITMSafeCall(cudaMemsetAsync(entriesAllocType_device, 0, sizeof(unsigned char)* noTotalEntries));
@@ -147,7 +160,7 @@ void ITMSceneReconstructionEngine_CUDA<TVoxel, ITMVoxelBlockHash>::AllocateScene
 	if (!onlyUpdateVisibleList)
 	{
 		allocateVoxelBlocksList_device << <gridSizeAL, cudaBlockSizeAL >> >(voxelAllocationList, excessAllocationList, hashTable,
-			noTotalEntries, (AllocationTempData*)allocationTempData_device, entriesAllocType_device, entriesVisibleType,
+			noTotalEntries, scene->index.GetNoOrderedEntries(), (AllocationTempData*)allocationTempData_device, entriesAllocType_device, entriesVisibleType,
 			blockCoords_device);
 	}
 
@@ -168,6 +181,7 @@ void ITMSceneReconstructionEngine_CUDA<TVoxel, ITMVoxelBlockHash>::AllocateScene
 	renderState_vh->noVisibleEntries = tempData->noVisibleEntries;
 	scene->localVBA.lastFreeBlockId = tempData->noAllocatedVoxelEntries;
 	scene->index.SetLastFreeExcessListId(tempData->noAllocatedExcessEntries);
+	scene->index.SetNoDroppedAllocations(scene->index.GetNoDroppedAllocations() + tempData->noDroppedAllocations);
 }
 
 template<class TVoxel>
@@ -330,7 +344,7 @@ __global__ void integrateIntoScene_device(TVoxel *localVBA, const ITMHashEntry *
 
 	Vector4f pt_model; int locId;
 
-	locId = x + y * SDF_BLOCK_SIZE + z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+	locId = voxelIndexInBlock(x, y, z);
 
 	if (stopMaxW) if (localVoxelBlock[locId].w_depth == maxW) return;
 	if (approximateIntegration) if (localVoxelBlock[locId].w_depth != 0) return;
@@ -362,8 +376,31 @@ __global__ void setToType3(uchar *entriesVisibleType, int *visibleEntryIDs, int
 	entriesVisibleType[visibleEntryIDs[entryId]] = 3;
 }
 
+/** Take the last free voxel block and, if @p needsExcessEntry, the
+    last free excess list entry, but only if all of them are available.
+    Both counters are swapped as one 64 bit word, so a thread that finds
+    one of them exhausted takes nothing and leaves both untouched.
+*/
+__device__ inline bool takeAllocationEntries(AllocationTempData *allocData, bool needsExcessEntry, int &vbaIdx, int &exlIdx)
+{
+	unsigned long long *counters = (unsigned long long*)&allocData->noAllocatedVoxelEntries;
+	unsigned long long old = *counters, assumed;
+
+	do {
+		assumed = old;
+		vbaIdx = (int)(uint)(assumed & 0xffffffffull);
+		exlIdx = (int)(uint)(assumed >> 32);
+		if (vbaIdx < 0 || (needsExcessEntry && exlIdx < 0)) return false;
+
+		unsigned long long taken = ((unsigned long long)(uint)(needsExcessEntry ? exlIdx - 1 : exlIdx) << 32) | (uint)(vbaIdx - 1);
+		old = atomicCAS(counters, assumed, taken);
+	} while (old != assumed);
+
+	return true;
+}
+
 __global__ void allocateVoxelBlocksList_device(int *voxelAllocationList, int *excessAllocationList, ITMHashEntry *hashTable, int noTotalEntries,
-	AllocationTempData *allocData, uchar *entriesAllocType, uchar *entriesVisibleType, Vector4s *blockCoords)
+	int noOrderedEntries, AllocationTempData *allocData, uchar *entriesAllocType, uchar *entriesVisibleType, Vector4s *blockCoords)
 {
 	int targetIdx = threadIdx.x + blockIdx.x * blockDim.x;
 	if (targetIdx > noTotalEntries - 1) return;
@@ -373,26 +410,26 @@ __global__ void allocateVoxelBlocksList_device(int *voxelAllocationList, int *ex
 	switch (entriesAllocType[targetIdx])
 	{
 	case 1: //needs allocation, fits in the ordered list
-		vbaIdx = atomicSub(&allocData->noAllocatedVoxelEntries, 1);
-
-		if (vbaIdx >= 0) //there is room in the voxel block array
+		if (takeAllocationEntries(allocData, false, vbaIdx, exlIdx)) //there is room in the voxel block array
 		{
 			Vector4s pt_block_all = blockCoords[targetIdx];
 
 			ITMHashEntry hashEntry;
 			hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
 			hashEntry.ptr = voxelAllocationList[vbaIdx];
-			hashEntry.offset = 0;
+			hashEntry.offset = hashTable[targetIdx].offset; //a freed entry may still lead to the excess list
 
 			hashTable[targetIdx] = hashEntry;
 		}
+		else
+		{
+			entriesVisibleType[targetIdx] = 0; //the entry stays free, so it must not reach the visible list
+			atomicAdd(&allocData->noDroppedAllocations, 1);
+		}
 		break;
 
 	case 2: //needs allocation in the excess list
-		vbaIdx = atomicSub(&allocData->noAllocatedVoxelEntries, 1);
-		exlIdx = atomicSub(&allocData->noAllocatedExcessEntries, 1);
-
-		if (vbaIdx >= 0 && exlIdx >= 0) //there is room in the voxel block array and excess list
+		if (takeAllocationEntries(allocData, true, vbaIdx, exlIdx)) //there is room in the voxel block array and excess list
 		{
 			Vector4s pt_block_all = blockCoords[targetIdx];
 
@@ -405,10 +442,11 @@ __global__ void allocateVoxelBlocksList_device(int *voxelAllocationList, int *ex
 
 			hashTable[targetIdx].offset = exlOffset + 1; //connect to child
 
-			hashTable[SDF_BUCKET_NUM + exlOffset] = hashEntry; //add child to the excess list
+			hashTable[noOrderedEntries + exlOffset] = hashEntry; //add child to the excess list
 
-			entriesVisibleType[SDF_BUCKET_NUM + exlOffset] = 1; //make child visible
+			entriesVisibleType[noOrderedEntries + exlOffset] = 1; //make child visible
 		}
+		else atomicAdd(&allocData->noDroppedAllocations, 1);
 
 		break;
 	}
@@ -420,13 +458,13 @@ __global__ void reAllocateSwappedOutVoxelBlocks_device(int *voxelAllocationList,
 	int targetIdx = threadIdx.x + blockIdx.x * blockDim.x;
 	if (targetIdx > noTotalEntries - 1) return;
 
-	int vbaIdx;
+	int vbaIdx, exlIdx;
 	int hashEntry_ptr = hashTable[targetIdx].ptr;
 
 	if (entriesVisibleType[targetIdx] > 0 && hashEntry_ptr == -1) //it is visible and has been previously allocated inside the hash, but deallocated from VBA
 	{
-		vbaIdx = atomicSub(&allocData->noAllocatedVoxelEntries, 1);
-		if (vbaIdx >= 0) hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+		if (takeAllocationEntries(allocData, false, vbaIdx, exlIdx)) hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+		else atomicAdd(&allocData->noDroppedAllocations, 1);
 	}
 }
 
@@ -20,6 +20,8 @@ namespace ITMLib
 			void *allocationTempData_host;
 			unsigned char *entriesAllocType_device;
 			Vector4s *blockCoords_device;
+			/// Number of hash entries entriesAllocType_device and blockCoords_device are allocated for
+			int noAllocTypeEntries;
 
 		public:
 			void ResetScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene);
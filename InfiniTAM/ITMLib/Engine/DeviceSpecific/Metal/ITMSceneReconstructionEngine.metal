@@ -32,7 +32,7 @@ kernel void integrateIntoScene_vh_device(DEVICEPTR(ITMVoxel) *localVBA
 
     Vector4f pt_model; int locId;
 
-    locId = x + y * SDF_BLOCK_SIZE + z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+    locId = voxelIndexInBlock(x, y, z);
 
 //    if (params->others.w < 0.5f) if (localVoxelBlock[locId].w_depth != 0) return;
     
@@ -59,7 +59,7 @@ void ITMSceneReconstructionEngine_Metal<TVoxel,ITMVoxelBlockHash>::IntegrateInto
     
     [commandEncoder setComputePipelineState:p_integrateIntoScene_vh_device];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->localVBA.GetVoxelBlocks_MB()      offset:0 atIndex:0];
-    [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->index.GetEntries_MB()             offset:0 atIndex:1];
+    [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->index.GetEntries_MB()             offset:scene->index.getIndexDataOffset_MB() atIndex:1];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) renderState_vh->GetVisibleEntryIDs_MB()  offset:0 atIndex:2];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) view->rgb->GetMetalBuffer()              offset:0 atIndex:3];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) view->depth->GetMetalBuffer()            offset:0 atIndex:4];
@@ -114,7 +114,7 @@ void ITMSceneReconstructionEngine_Metal<TVoxel,ITMVoxelBlockHash>::BuildAllocAnd
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) this->entriesAllocType->GetMetalBuffer()     offset:0 atIndex:0];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) renderState_vh->GetEntriesVisibleType_MB()   offset:0 atIndex:1];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) this->blockCoords->GetMetalBuffer()          offset:0 atIndex:2];
-    [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->index.GetEntries_MB()                 offset:0 atIndex:3];
+    [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->index.GetEntries_MB()                 offset:scene->index.getIndexDataOffset_MB() atIndex:3];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) view->depth->GetMetalBuffer()                offset:0 atIndex:4];
     [commandEncoder setBuffer:paramsBuffer_sceneReconstruction                                      offset:0 atIndex:5];
     
@@ -143,6 +143,8 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
     
     ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState;
     
+    this->ReserveAllocationEntries(scene->index.noTotalEntries);
+    
     M_d = trackingState->pose_d->GetM(); M_d.inv(invM_d);
     
     projParams_d = view->calib->intrinsics_d.projectionParamsSimple.all;
@@ -153,15 +155,17 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
     float mu = scene->sceneParams->mu;
     
     float *depth = view->depth->GetData(MEMORYDEVICE_CPU);
+    TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
     int *voxelAllocationList = scene->localVBA.GetAllocationList();
     int *excessAllocationList = scene->index.GetExcessAllocationList();
     ITMHashEntry *hashTable = scene->index.GetEntries();
+    int *blockOccupancy = scene->index.GetBlockOccupancy();
     ITMHashSwapState *swapStates = scene->useSwapping ? scene->globalCache->GetSwapStates(false) : 0;
     int *visibleEntryIDs = renderState_vh->GetVisibleEntryIDs();
     uchar *entriesVisibleType = renderState_vh->GetEntriesVisibleType();
     uchar *entriesAllocType = this->entriesAllocType->GetData(MEMORYDEVICE_CPU);
     Vector4s *blockCoords = this->blockCoords->GetData(MEMORYDEVICE_CPU);
-    int noTotalEntries = scene->index.noTotalEntries;
+    int noTotalEntries = scene->index.noTotalEntries, noOrderedEntries = scene->index.GetNoOrderedEntries();
     
     bool useSwapping = scene->useSwapping;
     
@@ -201,9 +205,12 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
                     ITMHashEntry hashEntry;
                     hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
                     hashEntry.ptr = voxelAllocationList[vbaIdx];
-                    hashEntry.offset = 0;
+                    resetVoxelBlock(localVBA + hashEntry.ptr * SDF_BLOCK_SIZE3);
+                    hashEntry.offset = hashTable[targetIdx].offset; //a freed entry may still lead to the excess list
                     
                     hashTable[targetIdx] = hashEntry;
+                    updateBlockOccupancy(blockOccupancy, hashEntry.pos, 1);
+                    markBlockInFilter(hashTable, hashEntry.pos);
                 }
                 
                 break;
@@ -218,15 +225,18 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
                     ITMHashEntry hashEntry;
                     hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
                     hashEntry.ptr = voxelAllocationList[vbaIdx];
+                    resetVoxelBlock(localVBA + hashEntry.ptr * SDF_BLOCK_SIZE3);
                     hashEntry.offset = 0;
                     
                     int exlOffset = excessAllocationList[exlIdx];
                     
                     hashTable[targetIdx].offset = exlOffset + 1; //connect to child
                     
-                    hashTable[SDF_BUCKET_NUM + exlOffset] = hashEntry; //add child to the excess list
+                    hashTable[noOrderedEntries + exlOffset] = hashEntry; //add child to the excess list
+                    updateBlockOccupancy(blockOccupancy, hashEntry.pos, 1);
+                    markBlockInFilter(hashTable, hashEntry.pos);
                     
-                    entriesVisibleType[SDF_BUCKET_NUM + exlOffset] = 1; //make child visible and in memory
+                    entriesVisibleType[noOrderedEntries + exlOffset] = 1; //make child visible and in memory
                 }
                 
                 break;
@@ -287,7 +297,13 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
             if (entriesVisibleType[targetIdx] > 0 && hashEntry.ptr == -1) 
             {
                 vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
-                if (vbaIdx >= 0) hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+                if (vbaIdx >= 0)
+                {
+                    hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+                    resetVoxelBlock(localVBA + hashTable[targetIdx].ptr * SDF_BLOCK_SIZE3);
+                    updateBlockOccupancy(blockOccupancy, hashEntry.pos, 1);
+                    markBlockInFilter(hashTable, hashEntry.pos);
+                }
             }
         }
     }
@@ -296,6 +312,8 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
     
     scene->localVBA.lastFreeBlockId = lastFreeVoxelBlockId;
     scene->index.SetLastFreeExcessListId(lastFreeExcessListId);
+    
+    checkBlockOccupancy(&scene->index);
 }
 
 template class ITMLib::Engine::ITMSceneReconstructionEngine_Metal<ITMVoxel, ITMVoxelIndex>;
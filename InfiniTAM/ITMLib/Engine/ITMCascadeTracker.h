@@ -0,0 +1,124 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include "../Utils/ITMLibDefines.h"
+#include "../Engine/ITMTracker.h"
+
+using namespace ITMLib::Objects;
+
+namespace ITMLib
+{
+	namespace Engine
+	{
+		/** \brief
+		    Runs a cheap tracker first and only falls back to an
+		    expensive one if the result of the cheap tracker fails a
+		    quality test.
+
+		    The cheap tracker has to report its residual and inlier
+		    ratio in the tracking state, as the depth trackers do. If
+		    the residual is above @p maxResidual or the inlier ratio
+		    below @p minInlierRatio, the pose is reset to its value
+		    before the cheap stage and the full tracker runs, exactly
+		    as if it were used on its own.
+		*/
+		class ITMCascadeTracker : public ITMTracker
+		{
+		public:
+			/// The stage whose result was kept for a frame
+			typedef enum {
+				CASCADE_STAGE_NONE,
+				CASCADE_STAGE_CHEAP,
+				CASCADE_STAGE_FULL
+			} CascadeStage;
+
+		private:
+			ITMTracker *cheapTracker, *fullTracker;
+
+			float maxResidual, minInlierRatio;
+
+			CascadeStage lastStage;
+			float lastResidual, lastInlierRatio;
+			int noFrames, noFullRuns;
+
+		public:
+			/// Accept the cheap stage if its residual and inlier ratio pass the thresholds
+			bool AcceptCheapStage(const ITMTrackingState *trackingState) const
+			{
+				if (trackingState->trackingResidual < 0.0f) return false;
+
+				return trackingState->trackingResidual <= maxResidual && trackingState->trackingInlierRatio >= minInlierRatio;
+			}
+
+			void TrackCamera(ITMTrackingState *trackingState, const ITMView *view)
+			{
+				ITMPose initialPose(*(trackingState->pose_d));
+
+				trackingState->ResetTrackingQuality();
+				cheapTracker->TrackCamera(trackingState, view);
+
+				lastResidual = trackingState->trackingResidual;
+				lastInlierRatio = trackingState->trackingInlierRatio;
+				noFrames++;
+
+				if (AcceptCheapStage(trackingState))
+				{
+					lastStage = CASCADE_STAGE_CHEAP;
+					return;
+				}
+
+				trackingState->pose_d->SetFrom(&initialPose);
+				trackingState->ResetTrackingQuality();
+				fullTracker->TrackCamera(trackingState, view);
+
+				lastStage = CASCADE_STAGE_FULL;
+				noFullRuns++;
+			}
+
+			void UpdateInitialPose(ITMTrackingState *trackingState)
+			{
+				fullTracker->UpdateInitialPose(trackingState);
+			}
+
+			/// The stage used for the last frame
+			CascadeStage GetLastStage(void) const { return lastStage; }
+
+			/// Residual and inlier ratio the cheap stage reported for the last frame
+			float GetLastResidual(void) const { return lastResidual; }
+			float GetLastInlierRatio(void) const { return lastInlierRatio; }
+
+			/// Number of frames tracked so far, and how many of them needed the full tracker
+			int GetNoFrames(void) const { return noFrames; }
+			int GetNoFullRuns(void) const { return noFullRuns; }
+
+			void ResetStatistics(void)
+			{
+				lastStage = CASCADE_STAGE_NONE;
+				lastResidual = -1.0f; lastInlierRatio = -1.0f;
+				noFrames = 0; noFullRuns = 0;
+			}
+
+			/// Takes ownership of both trackers
+			ITMCascadeTracker(ITMTracker *cheapTracker, ITMTracker *fullTracker, float maxResidual, float minInlierRatio)
+			{
+				this->cheapTracker = cheapTracker;
+				this->fullTracker = fullTracker;
+				this->maxResidual = maxResidual;
+				this->minInlierRatio = minInlierRatio;
+
+				ResetStatistics();
+			}
+
+			~ITMCascadeTracker(void)
+			{
+				delete cheapTracker;
+				delete fullTracker;
+			}
+
+			// Suppress the default copy constructor and assignment operator
+			ITMCascadeTracker(const ITMCascadeTracker&);
+			ITMCascadeTracker& operator=(const ITMCascadeTracker&);
+		};
+	}
+}
@@ -1,7 +1,7 @@
 // Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
 
 #include "ITMColorTracker.h"
-#include "../../ORUtils/Cholesky.h"
+#include "ITMPoseSolver.h"
 
 #include <math.h>
 
@@ -10,16 +10,33 @@ using namespace ITMLib::Engine;
 static inline bool minimizeLM(const ITMColorTracker & tracker, ITMPose & initialization);
 
 ITMColorTracker::ITMColorTracker(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels,
-	const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType)
+	const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType, ITMLibSettings::PixelSelectionType pixelSelectionType, int pixelSelectionStride,
+	bool useIntensity)
 {
-	viewHierarchy = new ITMImageHierarchy<ITMViewHierarchyLevel>(imgSize, trackingRegime, noHierarchyLevels, memoryType);
+	if (useIntensity)
+	{
+		viewHierarchy = NULL;
+		intensityHierarchy = new ITMImageHierarchy<ITMIntensityHierarchyLevel>(imgSize, trackingRegime, noHierarchyLevels, memoryType);
+	}
+	else
+	{
+		viewHierarchy = new ITMImageHierarchy<ITMViewHierarchyLevel>(imgSize, trackingRegime, noHierarchyLevels, memoryType);
+		intensityHierarchy = NULL;
+	}
 
 	this->lowLevelEngine = lowLevelEngine;
+
+	pixelSelector = ITMPixelSelector::Create(imgSize, pixelSelectionType, pixelSelectionStride, memoryType);
+	selectionHierarchy = (pixelSelector != NULL) ? new ITMImageHierarchy<ITMSelectionHierarchyLevel>(imgSize, trackingRegime, noHierarchyLevels, MEMORYDEVICE_CPU) : NULL;
 }
 
 ITMColorTracker::~ITMColorTracker(void)
 {
-	delete viewHierarchy;
+	if (viewHierarchy != NULL) delete viewHierarchy;
+	if (intensityHierarchy != NULL) delete intensityHierarchy;
+
+	if (pixelSelector != NULL) delete pixelSelector;
+	if (selectionHierarchy != NULL) delete selectionHierarchy;
 }
 
 void ITMColorTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView *view)
@@ -28,11 +45,15 @@ void ITMColorTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView
 
 	this->PrepareForEvaluation(view);
 
+	int noLevels = (intensityHierarchy != NULL) ? intensityHierarchy->noLevels : viewHierarchy->noLevels;
+
 	ITMPose currentPara(view->calib->trafo_rgb_to_depth.calib_inv * trackingState->pose_d->GetM());
-	for (int levelId = viewHierarchy->noLevels - 1; levelId >= 0; levelId--)
+	for (int levelId = noLevels - 1; levelId >= 0; levelId--)
 	{
 		this->levelId = levelId;
-		this->iterationType = viewHierarchy->levels[levelId]->iterationType;
+		this->iterationType = (intensityHierarchy != NULL) ? intensityHierarchy->levels[levelId]->iterationType : viewHierarchy->levels[levelId]->iterationType;
+
+		if (pixelSelector != NULL) this->SelectPoints(currentPara);
 
 		minimizeLM(*this, currentPara);
 	}
@@ -49,6 +70,19 @@ void ITMColorTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView
 
 void ITMColorTracker::PrepareForEvaluation(const ITMView *view)
 {
+	if (intensityHierarchy != NULL)
+	{
+		lowLevelEngine->ConvertColourToIntensity(intensityHierarchy->levels[0]->intensity, view->rgb);
+
+		for (int i = 1; i < intensityHierarchy->noLevels; i++)
+			lowLevelEngine->FilterSubsample(intensityHierarchy->levels[i]->intensity, intensityHierarchy->levels[i - 1]->intensity);
+
+		for (int i = 0; i < intensityHierarchy->noLevels; i++)
+			lowLevelEngine->Gradient(intensityHierarchy->levels[i]->gradients, intensityHierarchy->levels[i]->intensity);
+
+		return;
+	}
+
 	lowLevelEngine->CopyImage(viewHierarchy->levels[0]->rgb, view->rgb);
 
 	ITMImageHierarchy<ITMViewHierarchyLevel> *hierarchy = viewHierarchy;
@@ -68,53 +102,50 @@ void ITMColorTracker::PrepareForEvaluation(const ITMView *view)
 	}
 }
 
-void ITMColorTracker::ApplyDelta(const ITMPose & para_old, const float *delta, ITMPose & para_new) const
+void ITMColorTracker::SelectPoints(const ITMPose &pose)
 {
-	float paramVector[6];
+	Vector4f projParams = view->calib->intrinsics_rgb.projectionParamsSimple.all * (1.0f / (1 << levelId));
 
-	switch (iterationType)
+	// rank the points by the image gradient at their projection under the current estimate
+	if (intensityHierarchy != NULL)
+	{
+		pixelSelector->SelectFromPointCloud(selectionHierarchy->levels[levelId], trackingState->pointCloud, pose.GetM(), projParams,
+			intensityHierarchy->levels[levelId]->gradients);
+	}
+	else
 	{
-	case TRACKER_ITERATION_ROTATION:
-		paramVector[0] = 0.0f; paramVector[1] = 0.0f; paramVector[2] = 0.0f;
-		paramVector[3] = (float)(delta[0]); paramVector[4] = (float)(delta[1]); paramVector[5] = (float)(delta[2]);
-		break;
-	case TRACKER_ITERATION_TRANSLATION:
-		paramVector[0] = (float)(delta[0]); paramVector[1] = (float)(delta[1]); paramVector[2] = (float)(delta[2]);
-		paramVector[3] = 0.0f; paramVector[4] = 0.0f; paramVector[5] = 0.0f;
-		break;
-	case TRACKER_ITERATION_BOTH:
-		paramVector[0] = (float)(delta[0]); paramVector[1] = (float)(delta[1]); paramVector[2] = (float)(delta[2]);
-		paramVector[3] = (float)(delta[3]); paramVector[4] = (float)(delta[4]); paramVector[5] = (float)(delta[5]);
-		break;
-	default: break;
+		ITMViewHierarchyLevel *currentLevel = viewHierarchy->levels[levelId];
+		pixelSelector->SelectFromPointCloud(selectionHierarchy->levels[levelId], trackingState->pointCloud, pose.GetM(), projParams,
+			currentLevel->gradientX_rgb, currentLevel->gradientY_rgb);
 	}
+}
 
-	para_new.SetFrom(paramVector);
-	para_new.MultiplyWith(&(para_old));
+void ITMColorTracker::ApplyDelta(const ITMPose & para_old, const float *delta, ITMPose & para_new) const
+{
+	Matrix4f M_new;
+	ITMPoseSolver::ApplyDelta(para_old.GetM(), delta, iterationType, ITMPoseSolver::PARAMS_TRANSLATION_FIRST, M_new);
+	para_new.SetM(M_new);
 }
 
 void ITMColorTracker::EvaluationPoint::computeGradients(bool hessianRequired)
 {
-	int numPara = mParent->numParameters();
-	cacheNabla = new float[numPara];
-	cacheHessian = new float[numPara*numPara];
-
-	mParent->G_oneLevel(cacheNabla, cacheHessian, mPara);
+	mParent->G_oneLevel(cacheNabla, cacheHessian, &mPara);
+	hasGradients = true;
 }
 
-ITMColorTracker::EvaluationPoint::EvaluationPoint(ITMPose *pos, const ITMColorTracker *f_parent)
+void ITMColorTracker::EvaluationPoint::evaluateAt(const ITMPose & pos)
 {
 	float localF[1];
 
-	this->mPara = pos; this->mParent = f_parent;
+	mPara.SetFrom(&pos);
 
 	ITMColorTracker *parent = (ITMColorTracker *)mParent;
 
-	parent->F_oneLevel(localF, mPara);
+	parent->F_oneLevel(localF, &mPara);
 
 	cacheF = localF[0];
 
-	cacheHessian = NULL; cacheNabla = NULL;
+	hasGradients = false;
 }
 
 // LM optimisation
@@ -123,11 +154,10 @@ static inline double stepQuality(ITMColorTracker::EvaluationPoint *x, ITMColorTr
 {
 	double actual_reduction = x->f() - x2->f();
 	double predicted_reduction = 0.0;
-	float *tmp = new float[numPara];
+	float tmp[6];
 
 	matmul(B, step, tmp, numPara, numPara);
 	for (int i = 0; i < numPara; i++) predicted_reduction -= grad[i] * step[i] + 0.5*step[i] * tmp[i];
-	delete[] tmp;
 
 	if (predicted_reduction < 0) return actual_reduction / fabs(predicted_reduction);
 	return actual_reduction / predicted_reduction;
@@ -147,14 +177,19 @@ static inline bool minimizeLM(const ITMColorTracker & tracker, ITMPose & initial
 	static const float TR_REGION_DECREASE = 0.25f;
 
 	int numPara = tracker.numParameters();
-	float *d = new float[numPara];
+	float d[6];
 	float lambda = 0.01f;
 	int step_counter = 0;
 
-	ITMColorTracker::EvaluationPoint *x = tracker.evaluateAt(new ITMPose(initialization));
-	ITMColorTracker::EvaluationPoint *x2 = NULL;
+	// the current and the trial point swap roles when a step is accepted,
+	// so the loop never allocates
+	ITMColorTracker::EvaluationPoint evalA(&tracker), evalB(&tracker);
+	ITMColorTracker::EvaluationPoint *x = &evalA, *x2 = &evalB;
+	ITMPose tmp_para;
 
-	if (!portable_finite(x->f())) { delete[] d; delete x; return false; }
+	x->evaluateAt(initialization);
+
+	if (!portable_finite(x->f())) return false;
 
 	do
 	{
@@ -164,24 +199,7 @@ static inline bool minimizeLM(const ITMColorTracker & tracker, ITMPose & initial
 		grad = x->nabla_f();
 		B = x->hessian_GN();
 
-		bool success;
-		{
-			float *A = new float[numPara*numPara];
-			for (int i = 0; i < numPara*numPara; ++i) A[i] = B[i];
-			for (int i = 0; i < numPara; ++i)
-			{
-				float & ele = A[i*(numPara + 1)];
-				if (!(fabs(ele) < 1e-15f)) ele *= (1.0f + lambda); else ele = lambda*1e-10f;
-			}
-
-			ORUtils::Cholesky cholA(A, numPara);
-
-			cholA.Backsub(&(d[0]), grad);
-			// TODO: if Cholesky failed, set success to false!
-
-			success = true;
-			delete[] A;
-		}
+		bool success = ITMPoseSolver::SolveDamped(d, B, numPara, grad, lambda, numPara);
 
 		if (success)
 		{
@@ -192,12 +210,11 @@ static inline bool minimizeLM(const ITMColorTracker & tracker, ITMPose & initial
 			for (int i = 0; i < numPara; i++) d[i] = -d[i];
 
 			// make step
-			ITMPose *tmp_para = new ITMPose(x->getParameter());
-			tracker.ApplyDelta(x->getParameter(), &(d[0]), *tmp_para);
+			tracker.ApplyDelta(x->getParameter(), &(d[0]), tmp_para);
 
 			// check whether step reduces error function and
 			// compute a new value of lambda
-			x2 = tracker.evaluateAt(tmp_para);
+			x2->evaluateAt(tmp_para);
 
 			double rho = stepQuality(x, x2, &(d[0]), grad, B, numPara);
 			if (rho > TR_QUALITY_GAMMA1) lambda = lambda / TR_REGION_INCREASE;
@@ -205,7 +222,6 @@ static inline bool minimizeLM(const ITMColorTracker & tracker, ITMPose & initial
 		}
 		else
 		{
-			x2 = NULL;
 			// can't compute a step quality here...
 			lambda = lambda / TR_REGION_DECREASE;
 		}
@@ -216,19 +232,15 @@ static inline bool minimizeLM(const ITMColorTracker & tracker, ITMPose & initial
 			bool continueIteration = true;
 			if (!(x2->f() < (x->f() - fabs(x->f()) * MIN_DECREASE))) continueIteration = false;
 
-			delete x;
-			x = x2;
+			ITMColorTracker::EvaluationPoint *tmp = x;
+			x = x2; x2 = tmp;
 
 			if (!continueIteration) break;
 		}
-		else if (x2 != NULL) delete x2;
 		if (step_counter++ >= MAX_STEPS - 1) break;
 	} while (true);
 
 	initialization.SetFrom(&(x->getParameter()));
-	delete x;
-
-	delete[] d;
 
 	return true;
 }
@@ -6,9 +6,12 @@
 
 #include "../Objects/ITMImageHierarchy.h"
 #include "../Objects/ITMViewHierarchyLevel.h"
+#include "../Objects/ITMIntensityHierarchyLevel.h"
+#include "../Objects/ITMSelectionHierarchyLevel.h"
 
 #include "../Engine/ITMTracker.h"
 #include "../Engine/ITMLowLevelEngine.h"
+#include "../Engine/ITMPixelSelector.h"
 
 using namespace ITMLib::Objects;
 
@@ -20,13 +23,19 @@ namespace ITMLib
 		    tracking. Implementations would typically project down a
 		    point cloud into observed images and try to minimize the
 		    reprojection error.
+
+		    In intensity mode the observed images are converted to a
+		    single channel pyramid with interleaved x and y gradients,
+		    and the point colours are compared by their intensity.
 		*/
 		class ITMColorTracker : public ITMTracker
 		{
 		private:
 			const ITMLowLevelEngine *lowLevelEngine;
+			ITMPixelSelector *pixelSelector;
 
 			void PrepareForEvaluation(const ITMView *view);
+			void SelectPoints(const ITMPose &pose);
 
 		protected: 
 			TrackerIterationType iterationType;
@@ -34,41 +43,40 @@ namespace ITMLib
 			ITMImageHierarchy<ITMViewHierarchyLevel> *viewHierarchy;
 			int levelId;
 
+			/// Intensity pyramid used instead of viewHierarchy in intensity mode, NULL otherwise
+			ITMImageHierarchy<ITMIntensityHierarchyLevel> *intensityHierarchy;
+
+			/// Points to evaluate at each level, or NULL to evaluate all of them
+			ITMImageHierarchy<ITMSelectionHierarchyLevel> *selectionHierarchy;
+
 			int countedPoints_valid;
 		public:
 			class EvaluationPoint
 			{
 			public:
 				float f(void) { return cacheF; }
-				const float* nabla_f(void) { if (cacheNabla == NULL) computeGradients(false); return cacheNabla; }
+				const float* nabla_f(void) { if (!hasGradients) computeGradients(false); return cacheNabla; }
 
-				const float* hessian_GN(void) { if (cacheHessian == NULL) computeGradients(true); return cacheHessian; }
-				const ITMPose & getParameter(void) const { return *mPara; }
+				const float* hessian_GN(void) { if (!hasGradients) computeGradients(true); return cacheHessian; }
+				const ITMPose & getParameter(void) const { return mPara; }
 
-				EvaluationPoint(ITMPose *pos, const ITMColorTracker *f_parent);
-				~EvaluationPoint(void)
-				{
-					delete mPara;
-					if (cacheNabla != NULL) delete[] cacheNabla;
-					if (cacheHessian != NULL) delete[] cacheHessian;
-				}
+				/// Evaluate the energy at @p pos, reusing the storage of this point
+				void evaluateAt(const ITMPose & pos);
+
+				EvaluationPoint(const ITMColorTracker *f_parent) { this->mParent = f_parent; this->hasGradients = false; }
 
 			protected:
 				void computeGradients(bool requiresHessian);
 
-				ITMPose *mPara;
+				ITMPose mPara;
 				const ITMColorTracker *mParent;
 
 				float cacheF;
-				float *cacheNabla;
-				float *cacheHessian;
+				float cacheNabla[6];
+				float cacheHessian[6 * 6];
+				bool hasGradients;
 			};
 
-			EvaluationPoint* evaluateAt(ITMPose *para) const
-			{
-				return new EvaluationPoint(para, this);
-			}
-
 			int numParameters(void) const { return (iterationType == TRACKER_ITERATION_ROTATION) ? 3 : 6; }
 
 			virtual void F_oneLevel(float *f, ITMPose *pose) = 0;
@@ -79,7 +87,9 @@ namespace ITMLib
 			void TrackCamera(ITMTrackingState *trackingState, const ITMView *view);
 
 			ITMColorTracker(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels,
-				const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType);
+				const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType,
+				ITMLibSettings::PixelSelectionType pixelSelectionType = ITMLibSettings::PIXELSELECTION_ALL, int pixelSelectionStride = 1,
+				bool useIntensity = false);
 			virtual ~ITMColorTracker(void);
 		};
 	}
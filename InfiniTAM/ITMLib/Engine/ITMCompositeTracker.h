@@ -23,6 +23,8 @@ namespace ITMLib
 				trackers[trackerId] = tracker;
 			}
 
+			ITMTracker *GetTracker(int trackerId) const { return trackers[trackerId]; }
+
 			ITMCompositeTracker(int noTrackers)
 			{
 				trackers = new ITMTracker*[noTrackers];
@@ -13,6 +13,14 @@ ITMDenseMapper<TVoxel, TIndex>::ITMDenseMapper(const ITMLibSettings *settings)
 {
 	swappingEngine = NULL;
 
+	garbageCollectionInterval = settings->garbageCollectionInterval;
+	garbageCollectionMinSdf = settings->garbageCollectionMinSdf;
+	garbageCollectionMaxW = settings->garbageCollectionMaxW;
+	noFramesSinceGarbageCollection = 0;
+
+	defragmentationInterval = settings->defragmentationInterval;
+	noFramesSinceDefragmentation = 0;
+
 	switch (settings->deviceType)
 	{
 	case ITMLibSettings::DEVICE_CPU:
@@ -45,6 +53,8 @@ template<class TVoxel, class TIndex>
 void ITMDenseMapper<TVoxel,TIndex>::ResetScene(ITMScene<TVoxel,TIndex> *scene)
 {
 	sceneRecoEngine->ResetScene(scene);
+	noFramesSinceGarbageCollection = 0;
+	noFramesSinceDefragmentation = 0;
 }
 
 template<class TVoxel, class TIndex>
@@ -62,6 +72,20 @@ void ITMDenseMapper<TVoxel,TIndex>::ProcessFrame(const ITMView *view, const ITMT
 		// swapping: GPU -> CPU
 		swappingEngine->SaveToGlobalMemory(scene, renderState);
 	}
+
+	// garbage collection of blocks that fusion has carved back to free space
+	if (garbageCollectionInterval > 0 && ++noFramesSinceGarbageCollection >= garbageCollectionInterval)
+	{
+		sceneRecoEngine->CollectGarbage(scene, renderState, garbageCollectionMinSdf, garbageCollectionMaxW);
+		noFramesSinceGarbageCollection = 0;
+	}
+
+	// compaction of the blocks in use, done between frames so no kernel sees a half moved block
+	if (defragmentationInterval > 0 && ++noFramesSinceDefragmentation >= defragmentationInterval)
+	{
+		sceneRecoEngine->DefragmentVoxelBlocks(scene, renderState);
+		noFramesSinceDefragmentation = 0;
+	}
 }
 
 template<class TVoxel, class TIndex>
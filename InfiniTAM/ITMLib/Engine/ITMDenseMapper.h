@@ -26,6 +26,13 @@ namespace ITMLib
 			ITMSceneReconstructionEngine<TVoxel,TIndex> *sceneRecoEngine;
 			ITMSwappingEngine<TVoxel,TIndex> *swappingEngine;
 
+			int garbageCollectionInterval, garbageCollectionMaxW;
+			float garbageCollectionMinSdf;
+			int noFramesSinceGarbageCollection;
+
+			int defragmentationInterval;
+			int noFramesSinceDefragmentation;
+
 		public:
 			void ResetScene(ITMScene<TVoxel,TIndex> *scene);
 
@@ -1,14 +1,15 @@
 // Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
 
 #include "ITMDepthTracker.h"
-#include "../../ORUtils/Cholesky.h"
+#include "ITMPoseSolver.h"
 
 #include <math.h>
 
 using namespace ITMLib::Engine;
 
 ITMDepthTracker::ITMDepthTracker(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, int noICPRunTillLevel, float distThresh,
-	float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType)
+	float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType,
+	ITMLibSettings::PixelSelectionType pixelSelectionType, int pixelSelectionStride)
 {
 	viewHierarchy = new ITMImageHierarchy<ITMTemplatedHierarchyLevel<ITMFloatImage> >(imgSize, trackingRegime, noHierarchyLevels, memoryType, true);
 	sceneHierarchy = new ITMImageHierarchy<ITMSceneHierarchyLevel>(imgSize, trackingRegime, noHierarchyLevels, memoryType, true);
@@ -29,7 +30,11 @@ ITMDepthTracker::ITMDepthTracker(Vector2i imgSize, TrackerIterationType *trackin
 
 	this->lowLevelEngine = lowLevelEngine;
 
+	pixelSelector = ITMPixelSelector::Create(imgSize, pixelSelectionType, pixelSelectionStride, memoryType);
+	selectionHierarchy = (pixelSelector != NULL) ? new ITMImageHierarchy<ITMSelectionHierarchyLevel>(imgSize, trackingRegime, noHierarchyLevels, MEMORYDEVICE_CPU) : NULL;
+
 	this->noICPLevel = noICPRunTillLevel;
+	this->usesViewPyramid = false;
 
 	this->terminationThreshold = terminationThreshold;
 }
@@ -39,6 +44,9 @@ ITMDepthTracker::~ITMDepthTracker(void)
 	delete this->viewHierarchy;
 	delete this->sceneHierarchy;
 
+	if (this->pixelSelector != NULL) delete this->pixelSelector;
+	if (this->selectionHierarchy != NULL) delete this->selectionHierarchy;
+
 	delete[] this->noIterationsPerLevel;
 	delete[] this->distThresh;
 }
@@ -53,8 +61,18 @@ void ITMDepthTracker::SetEvaluationData(ITMTrackingState *trackingState, const I
 
 	// the image hierarchy allows pointers to external data at level 0
 	viewHierarchy->levels[0]->depth = view->depth;
+
+	// if the view builder already subsampled the depth image, the other levels can point there as well
+	usesViewPyramid = view->depthPyramid != NULL && view->noDepthPyramidLevels >= viewHierarchy->noLevels;
+	if (usesViewPyramid)
+	{
+		for (int i = 1; i < viewHierarchy->noLevels; i++) viewHierarchy->levels[i]->SetExternalData(view->depthPyramid[i]);
+	}
+
 	sceneHierarchy->levels[0]->pointsMap = trackingState->pointCloud->locations;
 	sceneHierarchy->levels[0]->normalsMap = trackingState->pointCloud->colours;
+	sceneHierarchy->levels[0]->compactDepthMap = trackingState->pointCloud->compactDepth;
+	sceneHierarchy->levels[0]->compactNormalsMap = trackingState->pointCloud->compactNormals;
 
 	scenePose = trackingState->pose_pointCloud->GetM();
 }
@@ -64,7 +82,7 @@ void ITMDepthTracker::PrepareForEvaluation()
 	for (int i = 1; i < viewHierarchy->noLevels; i++)
 	{
 		ITMTemplatedHierarchyLevel<ITMFloatImage> *currentLevelView = viewHierarchy->levels[i], *previousLevelView = viewHierarchy->levels[i - 1];
-		lowLevelEngine->FilterSubsampleWithHoles(currentLevelView->depth, previousLevelView->depth);
+		if (!usesViewPyramid) lowLevelEngine->FilterSubsampleWithHoles(currentLevelView->depth, previousLevelView->depth);
 		currentLevelView->intrinsics = previousLevelView->intrinsics * 0.5f;
 
 		ITMSceneHierarchyLevel *currentLevelScene = sceneHierarchy->levels[i], *previousLevelScene = sceneHierarchy->levels[i - 1];
@@ -72,6 +90,15 @@ void ITMDepthTracker::PrepareForEvaluation()
 		//lowLevelEngine->FilterSubsampleWithHoles(currentLevelScene->normalsMap, previousLevelScene->normalsMap);
 		currentLevelScene->intrinsics = previousLevelScene->intrinsics * 0.5f;
 	}
+
+	if (pixelSelector != NULL)
+	{
+		for (int i = noICPLevel; i < viewHierarchy->noLevels; i++)
+		{
+			ITMTemplatedHierarchyLevel<ITMFloatImage> *currentLevelView = viewHierarchy->levels[i];
+			pixelSelector->SelectFromDepth(selectionHierarchy->levels[i], currentLevelView->depth, currentLevelView->intrinsics);
+		}
+	}
 }
 
 void ITMDepthTracker::SetEvaluationParams(int levelId)
@@ -80,25 +107,7 @@ void ITMDepthTracker::SetEvaluationParams(int levelId)
 	this->iterationType = viewHierarchy->levels[levelId]->iterationType;
 	this->sceneHierarchyLevel = sceneHierarchy->levels[0];
 	this->viewHierarchyLevel = viewHierarchy->levels[levelId];
-}
-
-void ITMDepthTracker::ComputeDelta(float *step, float *nabla, float *hessian, bool shortIteration) const
-{
-	for (int i = 0; i < 6; i++) step[i] = 0;
-
-	if (shortIteration)
-	{
-		float smallHessian[3 * 3];
-		for (int r = 0; r < 3; r++) for (int c = 0; c < 3; c++) smallHessian[r + c * 3] = hessian[r + c * 6];
-
-		ORUtils::Cholesky cholA(smallHessian, 3);
-		cholA.Backsub(step, nabla);
-	}
-	else
-	{
-		ORUtils::Cholesky cholA(hessian, 6);
-		cholA.Backsub(step, nabla);
-	}
+	this->selectionHierarchyLevel = (selectionHierarchy != NULL) ? selectionHierarchy->levels[levelId] : NULL;
 }
 
 bool ITMDepthTracker::HasConverged(float *step) const
@@ -111,46 +120,15 @@ bool ITMDepthTracker::HasConverged(float *step) const
 	return false;
 }
 
-void ITMDepthTracker::ApplyDelta(const Matrix4f & para_old, const float *delta, Matrix4f & para_new) const
-{
-	float step[6];
-
-	switch (iterationType)
-	{
-	case TRACKER_ITERATION_ROTATION:
-		step[0] = (float)(delta[0]); step[1] = (float)(delta[1]); step[2] = (float)(delta[2]);
-		step[3] = 0.0f; step[4] = 0.0f; step[5] = 0.0f;
-		break;
-	case TRACKER_ITERATION_TRANSLATION:
-		step[0] = 0.0f; step[1] = 0.0f; step[2] = 0.0f;
-		step[3] = (float)(delta[0]); step[4] = (float)(delta[1]); step[5] = (float)(delta[2]);
-		break;
-	default:
-	case TRACKER_ITERATION_BOTH:
-		step[0] = (float)(delta[0]); step[1] = (float)(delta[1]); step[2] = (float)(delta[2]);
-		step[3] = (float)(delta[3]); step[4] = (float)(delta[4]); step[5] = (float)(delta[5]);
-		break;
-	}
-
-	Matrix4f Tinc;
-
-	Tinc.m00 = 1.0f;		Tinc.m10 = step[2];		Tinc.m20 = -step[1];	Tinc.m30 = step[3];
-	Tinc.m01 = -step[2];	Tinc.m11 = 1.0f;		Tinc.m21 = step[0];		Tinc.m31 = step[4];
-	Tinc.m02 = step[1];		Tinc.m12 = -step[0];	Tinc.m22 = 1.0f;		Tinc.m32 = step[5];
-	Tinc.m03 = 0.0f;		Tinc.m13 = 0.0f;		Tinc.m23 = 0.0f;		Tinc.m33 = 1.0f;
-
-	para_new = Tinc * para_old;
-}
-
 void ITMDepthTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView *view)
 {
 	this->SetEvaluationData(trackingState, view);
 	this->PrepareForEvaluation();
 
 	float f_old = 1e10, f_new;
-	int noValidPoints_new;
+	int noValidPoints_new, noValidPoints_good = 0;
 
-	float hessian_good[6 * 6], hessian_new[6 * 6], A[6 * 6];
+	float hessian_good[6 * 6], hessian_new[6 * 6];
 	float nabla_good[6], nabla_new[6];
 	float step[6];
 
@@ -161,7 +139,7 @@ void ITMDepthTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView
 
 		Matrix4f approxInvPose = trackingState->pose_d->GetInvM();
 		ITMPose lastKnownGoodPose(*(trackingState->pose_d));
-		f_old = 1e20f;
+		f_old = 1e20f; noValidPoints_good = 0;
 		float lambda = 1.0;
 
 		for (int iterNo = 0; iterNo < noIterationsPerLevel[levelId]; iterNo++)
@@ -176,18 +154,16 @@ void ITMDepthTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView
 				lambda *= 10.0f;
 			} else {
 				lastKnownGoodPose.SetFrom(trackingState->pose_d);
-				f_old = f_new;
+				f_old = f_new; noValidPoints_good = noValidPoints_new;
 
 				for (int i = 0; i < 6*6; ++i) hessian_good[i] = hessian_new[i] / noValidPoints_new;
 				for (int i = 0; i < 6; ++i) nabla_good[i] = nabla_new[i] / noValidPoints_new;
 				lambda /= 10.0f;
 			}
-			for (int i = 0; i < 6*6; ++i) A[i] = hessian_good[i];
-			for (int i = 0; i < 6; ++i) A[i+i*6] *= 1.0f + lambda;
-
 			// compute a new step and make sure we've got an SE3
-			ComputeDelta(step, nabla_good, A, iterationType != TRACKER_ITERATION_BOTH);
-			ApplyDelta(approxInvPose, step, approxInvPose);
+			for (int i = 0; i < 6; ++i) step[i] = 0.0f;
+			ITMPoseSolver::SolveDamped(step, hessian_good, 6, nabla_good, lambda, iterationType == TRACKER_ITERATION_BOTH ? 6 : 3);
+			ITMPoseSolver::ApplyDelta(approxInvPose, step, iterationType, ITMPoseSolver::PARAMS_ROTATION_FIRST, approxInvPose);
 			trackingState->pose_d->SetInvM(approxInvPose);
 			trackingState->pose_d->Coerce();
 			approxInvPose = trackingState->pose_d->GetInvM();
@@ -195,6 +171,10 @@ void ITMDepthTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView
 			// if step is small, assume it's going to decrease the error and finish
 			if (HasConverged(step)) break;
 		}
+
+		int noEvaluatedPoints = (selectionHierarchyLevel != NULL) ? selectionHierarchyLevel->noSelected :
+			viewHierarchyLevel->depth->noDims.x * viewHierarchyLevel->depth->noDims.y;
+		trackingState->SetTrackingQuality(f_old, noValidPoints_good, noEvaluatedPoints);
 	}
 }
 
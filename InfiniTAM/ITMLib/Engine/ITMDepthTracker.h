@@ -7,9 +7,11 @@
 #include "../Objects/ITMImageHierarchy.h"
 #include "../Objects/ITMTemplatedHierarchyLevel.h"
 #include "../Objects/ITMSceneHierarchyLevel.h"
+#include "../Objects/ITMSelectionHierarchyLevel.h"
 
 #include "../Engine/ITMTracker.h"
 #include "../Engine/ITMLowLevelEngine.h"
+#include "../Engine/ITMPixelSelector.h"
 
 using namespace ITMLib::Objects;
 
@@ -25,11 +27,16 @@ namespace ITMLib
 		{
 		private:
 			const ITMLowLevelEngine *lowLevelEngine;
+			ITMPixelSelector *pixelSelector;
 			ITMImageHierarchy<ITMSceneHierarchyLevel> *sceneHierarchy;
 			ITMImageHierarchy<ITMTemplatedHierarchyLevel<ITMFloatImage> > *viewHierarchy;
+			ITMImageHierarchy<ITMSelectionHierarchyLevel> *selectionHierarchy;
 
 			ITMTrackingState *trackingState; const ITMView *view;
 
+			/// Whether the subsampled depth images come from the depth pyramid of the view
+			bool usesViewPyramid;
+
 			int *noIterationsPerLevel;
 			int noICPLevel;
 
@@ -38,8 +45,6 @@ namespace ITMLib
 			void PrepareForEvaluation();
 			void SetEvaluationParams(int levelId);
 
-			void ComputeDelta(float *delta, float *nabla, float *hessian, bool shortIteration) const;
-			void ApplyDelta(const Matrix4f & para_old, const float *delta, Matrix4f & para_new) const;
 			bool HasConverged(float *step) const;
 
 			void SetEvaluationData(ITMTrackingState *trackingState, const ITMView *view);
@@ -53,13 +58,17 @@ namespace ITMLib
 			ITMSceneHierarchyLevel *sceneHierarchyLevel;
 			ITMTemplatedHierarchyLevel<ITMFloatImage> *viewHierarchyLevel;
 
+			/// Pixels to evaluate at the current level, or NULL to evaluate all of them
+			ITMSelectionHierarchyLevel *selectionHierarchyLevel;
+
 			virtual int ComputeGandH(float &f, float *nabla, float *hessian, Matrix4f approxInvPose) = 0;
 
 		public:
 			void TrackCamera(ITMTrackingState *trackingState, const ITMView *view);
 
 			ITMDepthTracker(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, int noICPRunTillLevel, float distThresh,
-				float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType);
+				float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType,
+				ITMLibSettings::PixelSelectionType pixelSelectionType = ITMLibSettings::PIXELSELECTION_ALL, int pixelSelectionStride = 1);
 			virtual ~ITMDepthTracker(void);
 		};
 	}
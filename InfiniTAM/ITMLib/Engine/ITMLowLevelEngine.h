@@ -25,6 +25,12 @@ namespace ITMLib
 			virtual void GradientX(ITMShort4Image *grad_out, const ITMUChar4Image *image_in) const = 0;
 			virtual void GradientY(ITMShort4Image *grad_out, const ITMUChar4Image *image_in) const = 0;
 
+			/// Single channel intensity images, as used by the intensity mode of ITMColorTracker
+			virtual void ConvertColourToIntensity(ITMUCharImage *image_out, const ITMUChar4Image *image_in) const = 0;
+			virtual void FilterSubsample(ITMUCharImage *image_out, const ITMUCharImage *image_in) const = 0;
+			/// Computes the x and y gradients of an intensity image in one pass
+			virtual void Gradient(ITMShort2Image *grad_out, const ITMUCharImage *image_in) const = 0;
+
 			ITMLowLevelEngine(void) { }
 			virtual ~ITMLowLevelEngine(void) { }
 		};
@@ -17,13 +17,17 @@ ITMMainEngine::ITMMainEngine(const ITMLibSettings *settings, const ITMRGBDCalib
 	this->scene = new ITMScene<ITMVoxel, ITMVoxelIndex>(&(settings->sceneParams), settings->useSwapping, 
 		settings->deviceType == ITMLibSettings::DEVICE_CUDA ? MEMORYDEVICE_CUDA : MEMORYDEVICE_CPU);
 
+	// the depth based trackers and the relocaliser share a depth pyramid built along with the view
+	int noDepthPyramidLevels = (settings->trackerType == ITMLibSettings::TRACKER_COLOR || settings->trackerType == ITMLibSettings::TRACKER_REN) ?
+		0 : settings->noHierarchyLevels;
+
 	meshingEngine = NULL;
 	switch (settings->deviceType)
 	{
 	case ITMLibSettings::DEVICE_CPU:
 		lowLevelEngine = new ITMLowLevelEngine_CPU();
-		viewBuilder = new ITMViewBuilder_CPU(calib);
-		visualisationEngine = new ITMVisualisationEngine_CPU<ITMVoxel, ITMVoxelIndex>(scene);
+		viewBuilder = new ITMViewBuilder_CPU(calib, noDepthPyramidLevels);
+		visualisationEngine = new ITMVisualisationEngine_CPU<ITMVoxel, ITMVoxelIndex>(scene, settings->useTemporalRaycastSeeding);
 		if (createMeshingEngine) meshingEngine = new ITMMeshingEngine_CPU<ITMVoxel, ITMVoxelIndex>();
 		break;
 	case ITMLibSettings::DEVICE_CUDA:
@@ -44,8 +48,7 @@ ITMMainEngine::ITMMainEngine(const ITMLibSettings *settings, const ITMRGBDCalib
 		break;
 	}
 
-	mesh = NULL;
-	if (createMeshingEngine) mesh = new ITMMesh(settings->deviceType == ITMLibSettings::DEVICE_CUDA ? MEMORYDEVICE_CUDA : MEMORYDEVICE_CPU);
+	mesh = NULL; //will be allocated on first use, as it is large
 
 	Vector2i trackedImageSize = ITMTrackingController::GetTrackedImageSize(settings, imgSize_rgb, imgSize_d);
 
@@ -57,7 +60,13 @@ ITMMainEngine::ITMMainEngine(const ITMLibSettings *settings, const ITMRGBDCalib
 
 	imuCalibrator = new ITMIMUCalibrator_iPad();
 	tracker = ITMTrackerFactory<ITMVoxel, ITMVoxelIndex>::Instance().Make(trackedImageSize, settings, lowLevelEngine, imuCalibrator, scene);
-	trackingController = new ITMTrackingController(tracker, visualisationEngine, lowLevelEngine, settings);
+
+	// the factory puts the IMU tracker ahead of the cascade in a composite tracker
+	cascadeTracker = NULL;
+	if (settings->useTrackerCascade) cascadeTracker = (ITMCascadeTracker*)((settings->trackerType == ITMLibSettings::TRACKER_IMU) ?
+		((ITMCompositeTracker*)tracker)->GetTracker(1) : tracker);
+
+	trackingController = new ITMTrackingController(tracker, visualisationEngine, lowLevelEngine, settings, trackedImageSize);
 
 	trackingState = trackingController->BuildTrackingState(trackedImageSize);
 	tracker->UpdateInitialPose(trackingState);
@@ -96,14 +105,18 @@ ITMMainEngine::~ITMMainEngine()
 
 ITMMesh* ITMMainEngine::UpdateMesh(void)
 {
-	if (mesh != NULL) meshingEngine->MeshScene(mesh, scene);
+	if (meshingEngine == NULL) return NULL;
+
+	//up to 32 triangles for each voxel block the scene can hold
+	if (mesh == NULL) mesh = new ITMMesh(settings->deviceType == ITMLibSettings::DEVICE_CUDA ? MEMORYDEVICE_CUDA : MEMORYDEVICE_CPU,
+		scene->index.getNumAllocatedVoxelBlocks() * 32);
+	meshingEngine->MeshScene(mesh, scene);
 	return mesh;
 }
 
 void ITMMainEngine::SaveSceneToMesh(const char *objFileName)
 {
-	if (mesh == NULL) return;
-	meshingEngine->MeshScene(mesh, scene);
+	if (UpdateMesh() == NULL) return;
 	mesh->WriteSTL(objFileName);
 }
 
@@ -118,8 +131,9 @@ void ITMMainEngine::ProcessFrame(ITMUChar4Image *rgbImage, ITMShortImage *rawDep
 	// tracking
 	trackingController->Track(trackingState, view);
 
-	// fusion
-	if (fusionActive) denseMapper->ProcessFrame(view, trackingState, scene, renderState_live);
+	// fusion, frames the tracker lost only update the visible blocks for rendering from the relocalised pose
+	if (trackingState->trackerResult != ITMTrackingState::TRACKING_GOOD) denseMapper->UpdateVisibleList(view, trackingState, scene, renderState_live);
+	else if (fusionActive) denseMapper->ProcessFrame(view, trackingState, scene, renderState_live);
 
 	// raycast to renderState_live for tracking and free visualisation
 	trackingController->Prepare(trackingState, view, renderState_live);
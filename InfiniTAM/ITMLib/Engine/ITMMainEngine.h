@@ -63,6 +63,7 @@ namespace ITMLib
 			ITMTrackingController *trackingController;
 
 			ITMTracker *tracker;
+			ITMCascadeTracker *cascadeTracker;
 			ITMIMUCalibrator *imuCalibrator;
 
 			ITMView *view;
@@ -90,13 +91,16 @@ namespace ITMLib
 			/// Gives access to the current camera pose and additional tracking information
 			ITMTrackingState* GetTrackingState(void) { return trackingState; }
 
+			/// Gives access to the statistics of the tracker cascade, NULL if the cascade is not used
+			ITMCascadeTracker* GetCascadeTracker(void) { return cascadeTracker; }
+
 			/// Gives access to the internal world representation
 			ITMScene<ITMVoxel, ITMVoxelIndex>* GetScene(void) { return scene; }
 
 			/// Process a frame with rgb and depth images and optionally a corresponding imu measurement
 			void ProcessFrame(ITMUChar4Image *rgbImage, ITMShortImage *rawDepthImage, ITMIMUMeasurement *imuMeasurement = NULL);
 
-			// Gives access to the data structure used internally to store any created meshes
+			// Gives access to the data structure used internally to store any created meshes, NULL before the first one
 			ITMMesh* GetMesh(void) { return mesh; }
 
 			/// Update the internally stored mesh data structure and return a pointer to it
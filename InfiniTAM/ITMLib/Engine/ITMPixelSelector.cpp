@@ -0,0 +1,271 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#include "ITMPixelSelector.h"
+#include "DeviceAgnostic/ITMPixelSelector.h"
+
+using namespace ITMLib::Engine;
+
+// pixels without valid depth are never selected. Pixels with depth but no usable normal, typically at depth edges and
+// on thin structures, get a bin of their own after the normal bins, so that they still receive a share of the budget.
+#define BIN_INVALID -1
+#define BIN_NONORMAL NORMAL_BINS_TOTAL
+#define BINS_TOTAL (NORMAL_BINS_TOTAL + 1)
+#define BIN_SELECTED BINS_TOTAL
+
+ITMPixelSelector::ITMPixelSelector(Vector2i imgSize, ITMLibSettings::PixelSelectionType selectionType, int stride)
+{
+	this->selectionType = selectionType;
+	this->stride = MAX(stride, 1);
+
+	binIds = new ORUtils::MemoryBlock<int>(imgSize.x * imgSize.y, MEMORYDEVICE_CPU);
+	sortedIds = new ORUtils::MemoryBlock<int>(imgSize.x * imgSize.y, MEMORYDEVICE_CPU);
+	gradientMagnitudes = new ORUtils::MemoryBlock<float>(imgSize.x * imgSize.y, MEMORYDEVICE_CPU);
+}
+
+ITMPixelSelector *ITMPixelSelector::Create(Vector2i imgSize, ITMLibSettings::PixelSelectionType selectionType, int stride, MemoryDeviceType memoryType)
+{
+	if (selectionType == ITMLibSettings::PIXELSELECTION_ALL || memoryType != MEMORYDEVICE_CPU) return NULL;
+
+	return new ITMPixelSelector(imgSize, selectionType, stride);
+}
+
+ITMPixelSelector::~ITMPixelSelector(void)
+{
+	delete binIds;
+	delete sortedIds;
+	delete gradientMagnitudes;
+}
+
+int ITMPixelSelector::SelectStrided(int *indices, const int *binIds, Vector2i imgSize) const
+{
+	int noSelected = 0;
+
+	for (int y = 0; y < imgSize.y; y += stride) for (int x = 0; x < imgSize.x; x += stride)
+	{
+		int locId = x + y * imgSize.x;
+		if (binIds[locId] != BIN_INVALID) indices[noSelected++] = locId;
+	}
+
+	return noSelected;
+}
+
+int ITMPixelSelector::SelectEveryNth(int *indices, int noTotalPoints) const
+{
+	// the point cloud is already compacted, so just keep every n-th point
+	int noSelected = 0;
+	for (int locId = 0; locId < noTotalPoints; locId += stride * stride) indices[noSelected++] = locId;
+
+	return noSelected;
+}
+
+int ITMPixelSelector::SelectFromBins(int *indices, int *binIds, int noPixels)
+{
+	int *sortedIds = this->sortedIds->GetData(MEMORYDEVICE_CPU);
+
+	int binCounts[BINS_TOTAL], binOffsets[BINS_TOTAL], binQuotas[BINS_TOTAL], binOrder[BINS_TOTAL];
+	for (int binId = 0; binId < BINS_TOTAL; binId++) binCounts[binId] = 0;
+
+	int noBinned = 0;
+	for (int locId = 0; locId < noPixels; locId++)
+	{
+		int binId = binIds[locId];
+		if (binId >= 0) { binCounts[binId]++; noBinned++; }
+	}
+
+	int budget = noBinned / (stride * stride);
+
+	if (budget < noBinned)
+	{
+		// fill the bins with the fewest pixels first, so that rare normal
+		// directions are fully represented and the rest is shared evenly
+		int noNonEmptyBins = 0;
+		for (int binId = 0; binId < BINS_TOTAL; binId++)
+		{
+			int count = binCounts[binId], pos = noNonEmptyBins;
+			if (count == 0) continue;
+
+			while (pos > 0 && binCounts[binOrder[pos - 1]] > count) { binOrder[pos] = binOrder[pos - 1]; pos--; }
+			binOrder[pos] = binId; noNonEmptyBins++;
+		}
+
+		for (int binId = 0; binId < BINS_TOTAL; binId++) binQuotas[binId] = 0;
+		for (int i = 0, remainingBudget = budget; i < noNonEmptyBins; i++)
+		{
+			int binId = binOrder[i];
+			binQuotas[binId] = MIN(binCounts[binId], remainingBudget / (noNonEmptyBins - i));
+			remainingBudget -= binQuotas[binId];
+		}
+
+		// counting sort of the pixels by bin, keeping raster order inside each bin
+		for (int binId = 0, offset = 0; binId < BINS_TOTAL; binId++) { binOffsets[binId] = offset; offset += binCounts[binId]; }
+		for (int locId = 0; locId < noPixels; locId++)
+		{
+			int binId = binIds[locId];
+			if (binId >= 0) sortedIds[binOffsets[binId]++] = locId;
+		}
+
+		// pick evenly spaced pixels from each bin and mark them
+		for (int binId = 0, offset = 0; binId < BINS_TOTAL; binId++)
+		{
+			int count = binCounts[binId], quota = binQuotas[binId];
+			for (int i = 0; i < quota; i++) binIds[sortedIds[offset + (i * count) / quota]] = BIN_SELECTED;
+			offset += count;
+		}
+	}
+	else
+	{
+		for (int locId = 0; locId < noPixels; locId++) if (binIds[locId] >= 0) binIds[locId] = BIN_SELECTED;
+	}
+
+	// emit the selection in raster order to keep the tracker loops cache friendly
+	int noSelected = 0;
+	for (int locId = 0; locId < noPixels; locId++) if (binIds[locId] == BIN_SELECTED) indices[noSelected++] = locId;
+
+	return noSelected;
+}
+
+void ITMPixelSelector::SelectFromDepth(ITMSelectionHierarchyLevel *selection, const ITMFloatImage *depth, const Vector4f &intrinsics)
+{
+	Vector2i imgSize = depth->noDims;
+	const float *depthData = depth->GetData(MEMORYDEVICE_CPU);
+	int *binIds = this->binIds->GetData(MEMORYDEVICE_CPU);
+	int *indices = selection->indices->GetData(MEMORYDEVICE_CPU);
+
+	bool informative = selectionType == ITMLibSettings::PIXELSELECTION_INFORMATIVE;
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
+	{
+		int locId = x + y * imgSize.x;
+
+		if (!(depthData[locId] > 0.0f)) binIds[locId] = BIN_INVALID;
+		else if (!informative) binIds[locId] = BIN_NONORMAL;
+		else
+		{
+			int binId = computeNormalBin_Depth(x, y, depthData, imgSize, intrinsics);
+			binIds[locId] = binId >= 0 ? binId : BIN_NONORMAL;
+		}
+	}
+
+	if (informative) selection->noSelected = SelectFromBins(indices, binIds, imgSize.x * imgSize.y);
+	else selection->noSelected = SelectStrided(indices, binIds, imgSize);
+}
+
+void ITMPixelSelector::SelectFromPoints(ITMSelectionHierarchyLevel *selection, const ITMFloat4Image *points)
+{
+	Vector2i imgSize = points->noDims;
+	const Vector4f *pointData = points->GetData(MEMORYDEVICE_CPU);
+	int *binIds = this->binIds->GetData(MEMORYDEVICE_CPU);
+	int *indices = selection->indices->GetData(MEMORYDEVICE_CPU);
+
+	bool informative = selectionType == ITMLibSettings::PIXELSELECTION_INFORMATIVE;
+
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++)
+	{
+		int locId = x + y * imgSize.x;
+
+		if (pointData[locId].w < 0.0f) binIds[locId] = BIN_INVALID;
+		else if (!informative) binIds[locId] = BIN_NONORMAL;
+		else
+		{
+			int binId = computeNormalBin_Points(x, y, pointData, imgSize);
+			binIds[locId] = binId >= 0 ? binId : BIN_NONORMAL;
+		}
+	}
+
+	if (informative) selection->noSelected = SelectFromBins(indices, binIds, imgSize.x * imgSize.y);
+	else selection->noSelected = SelectStrided(indices, binIds, imgSize);
+}
+
+void ITMPixelSelector::SelectFromPointCloud(ITMSelectionHierarchyLevel *selection, const ITMPointCloud *pointCloud, const Matrix4f &M,
+	const Vector4f &projParams, const ITMShort4Image *gradientX, const ITMShort4Image *gradientY)
+{
+	int noTotalPoints = pointCloud->noTotalPoints;
+	int *indices = selection->indices->GetData(MEMORYDEVICE_CPU);
+
+	if (selectionType != ITMLibSettings::PIXELSELECTION_INFORMATIVE)
+	{
+		selection->noSelected = SelectEveryNth(indices, noTotalPoints);
+		return;
+	}
+
+	const Vector4f *locations = pointCloud->locations->GetData(MEMORYDEVICE_CPU);
+	const Vector4s *gx = gradientX->GetData(MEMORYDEVICE_CPU);
+	const Vector4s *gy = gradientY->GetData(MEMORYDEVICE_CPU);
+	float *magnitudes = gradientMagnitudes->GetData(MEMORYDEVICE_CPU);
+	Vector2i imgSize = gradientX->noDims;
+
+	float maxMagnitude = 0.0f;
+	for (int locId = 0; locId < noTotalPoints; locId++)
+	{
+		magnitudes[locId] = computePointGradientMagnitude(locations[locId], M, projParams, gx, gy, imgSize);
+		maxMagnitude = MAX(maxMagnitude, magnitudes[locId]);
+	}
+
+	selection->noSelected = SelectFromMagnitudes(indices, magnitudes, maxMagnitude, noTotalPoints);
+}
+
+void ITMPixelSelector::SelectFromPointCloud(ITMSelectionHierarchyLevel *selection, const ITMPointCloud *pointCloud, const Matrix4f &M,
+	const Vector4f &projParams, const ITMShort2Image *gradients)
+{
+	int noTotalPoints = pointCloud->noTotalPoints;
+	int *indices = selection->indices->GetData(MEMORYDEVICE_CPU);
+
+	if (selectionType != ITMLibSettings::PIXELSELECTION_INFORMATIVE)
+	{
+		selection->noSelected = SelectEveryNth(indices, noTotalPoints);
+		return;
+	}
+
+	const Vector4f *locations = pointCloud->locations->GetData(MEMORYDEVICE_CPU);
+	const Vector2s_ *gradientData = gradients->GetData(MEMORYDEVICE_CPU);
+	float *magnitudes = gradientMagnitudes->GetData(MEMORYDEVICE_CPU);
+	Vector2i imgSize = gradients->noDims;
+
+	float maxMagnitude = 0.0f;
+	for (int locId = 0; locId < noTotalPoints; locId++)
+	{
+		magnitudes[locId] = computePointGradientMagnitude(locations[locId], M, projParams, gradientData, imgSize);
+		maxMagnitude = MAX(maxMagnitude, magnitudes[locId]);
+	}
+
+	selection->noSelected = SelectFromMagnitudes(indices, magnitudes, maxMagnitude, noTotalPoints);
+}
+
+int ITMPixelSelector::SelectFromMagnitudes(int *indices, const float *magnitudes, float maxMagnitude, int noTotalPoints) const
+{
+	int budget = noTotalPoints / (stride * stride);
+
+	// without any texture there is nothing to rank by, so fall back to strided selection rather than selecting nothing
+	if (maxMagnitude <= 0.0f) return SelectEveryNth(indices, noTotalPoints);
+
+	// find the histogram bin above which the strongest "budget" points lie
+	int histogram[GRADIENT_HISTOGRAM_BINS];
+	for (int binId = 0; binId < GRADIENT_HISTOGRAM_BINS; binId++) histogram[binId] = 0;
+
+	float binScale = (GRADIENT_HISTOGRAM_BINS - 1) / maxMagnitude;
+	for (int locId = 0; locId < noTotalPoints; locId++)
+		if (magnitudes[locId] >= 0.0f) histogram[(int)(magnitudes[locId] * binScale)]++;
+
+	int thresholdBin = GRADIENT_HISTOGRAM_BINS - 1, noAboveThreshold = histogram[thresholdBin];
+	while (thresholdBin > 0 && noAboveThreshold < budget) noAboveThreshold += histogram[--thresholdBin];
+
+	int noAtThreshold = budget - (noAboveThreshold - histogram[thresholdBin]);
+
+	int noSelected = 0;
+	for (int locId = 0; locId < noTotalPoints; locId++)
+	{
+		if (magnitudes[locId] < 0.0f) continue;
+
+		int binId = (int)(magnitudes[locId] * binScale);
+		if (binId > thresholdBin) indices[noSelected++] = locId;
+		else if (binId == thresholdBin && noAtThreshold > 0) { indices[noSelected++] = locId; noAtThreshold--; }
+	}
+
+	return noSelected;
+}
@@ -0,0 +1,82 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include "../Utils/ITMLibDefines.h"
+#include "../Utils/ITMLibSettings.h"
+
+#include "../Objects/ITMPointCloud.h"
+#include "../Objects/ITMSelectionHierarchyLevel.h"
+
+using namespace ITMLib::Objects;
+
+namespace ITMLib
+{
+	namespace Engine
+	{
+		/** \brief
+		    Chooses the subset of pixels the trackers evaluate in
+		    their energy functions and stores it as a compact list of
+		    indices per hierarchy level.
+
+		    Strided selection keeps the valid pixels on a regular grid.
+		    Informative selection keeps pixels spread uniformly over
+		    the space of surface normals for the depth trackers, with
+		    pixels that have no usable normal treated as one more
+		    direction, and the points with the strongest image
+		    gradient for the colour tracker. In both cases about one
+		    in stride^2 pixels is kept.
+		*/
+		class ITMPixelSelector
+		{
+		private:
+			ITMLibSettings::PixelSelectionType selectionType;
+			int stride;
+
+			ORUtils::MemoryBlock<int> *binIds;
+			ORUtils::MemoryBlock<int> *sortedIds;
+			ORUtils::MemoryBlock<float> *gradientMagnitudes;
+
+			int SelectStrided(int *indices, const int *binIds, Vector2i imgSize) const;
+			int SelectEveryNth(int *indices, int noTotalPoints) const;
+			int SelectFromBins(int *indices, int *binIds, int noPixels);
+			int SelectFromMagnitudes(int *indices, const float *magnitudes, float maxMagnitude, int noTotalPoints) const;
+
+		public:
+			/** Select pixels with valid depth from a depth image
+			    with the given intrinsics.
+			*/
+			void SelectFromDepth(ITMSelectionHierarchyLevel *selection, const ITMFloatImage *depth, const Vector4f &intrinsics);
+
+			/** Select valid points from a camera-space point image,
+			    as used by ITMRenTracker.
+			*/
+			void SelectFromPoints(ITMSelectionHierarchyLevel *selection, const ITMFloat4Image *points);
+
+			/** Select points of a coloured point cloud, ranking them
+			    by the image gradient at their projection with pose
+			    @p M into an image with intrinsics @p projParams.
+			*/
+			void SelectFromPointCloud(ITMSelectionHierarchyLevel *selection, const ITMPointCloud *pointCloud, const Matrix4f &M,
+				const Vector4f &projParams, const ITMShort4Image *gradientX, const ITMShort4Image *gradientY);
+
+			/// As above, ranking by the gradients of an intensity image
+			void SelectFromPointCloud(ITMSelectionHierarchyLevel *selection, const ITMPointCloud *pointCloud, const Matrix4f &M,
+				const Vector4f &projParams, const ITMShort2Image *gradients);
+
+			/** Create a selector for a tracker working in @p memoryType,
+			    or return NULL if the tracker should use every pixel.
+			    Pixel selection runs on the host, so it is only
+			    available for CPU trackers.
+			*/
+			static ITMPixelSelector *Create(Vector2i imgSize, ITMLibSettings::PixelSelectionType selectionType, int stride, MemoryDeviceType memoryType);
+
+			ITMPixelSelector(Vector2i imgSize, ITMLibSettings::PixelSelectionType selectionType, int stride);
+			~ITMPixelSelector(void);
+
+			// Suppress the default copy constructor and assignment operator
+			ITMPixelSelector(const ITMPixelSelector&);
+			ITMPixelSelector& operator=(const ITMPixelSelector&);
+		};
+	}
+}
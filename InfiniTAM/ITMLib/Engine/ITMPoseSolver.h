@@ -0,0 +1,144 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include "../Utils/ITMLibDefines.h"
+#include "../Objects/ITMPose.h"
+
+#include <math.h>
+
+using namespace ITMLib::Objects;
+
+namespace ITMLib
+{
+	namespace Engine
+	{
+		/** \brief
+		    Gauss-Newton / Levenberg-Marquardt step computation and pose
+		    update shared by the trackers.
+
+		    The normal equations are solved with an LDL^T factorisation
+		    whose size is a template parameter, so the 3x3 and 6x6
+		    systems of the trackers are fully unrolled and never touch
+		    the heap. Steps are applied to the pose through the SE(3)
+		    exponential map.
+		*/
+		class ITMPoseSolver
+		{
+		public:
+			/// Orders of the pose parameters in the trackers' gradients and Hessians
+			typedef enum {
+				//! (tx, ty, tz, rx, ry, rz) as in the ITMPose tangent, used by the colour and Ren trackers
+				PARAMS_TRANSLATION_FIRST,
+				//! (rx, ry, rz, tx, ty, tz) with the rotation acting as I - [r]x, used by the ICP trackers
+				PARAMS_ROTATION_FIRST
+			} ParameterLayout;
+
+			/** Solve (H + lambda diag(H)) x = g for the upper left
+			    N x N block of @p hessian, which is stored with row
+			    stride @p hessianStride. Diagonal entries that vanish
+			    are replaced by a tiny multiple of lambda. Returns false
+			    and a zero step if the damped system is not positive
+			    definite.
+			*/
+			template<int N>
+			static bool SolveDamped(float *step, const float *hessian, int hessianStride, const float *nabla, float lambda)
+			{
+				float A[N * N], D[N], y[N];
+
+				for (int r = 0; r < N; r++) for (int c = 0; c <= r; c++) A[c + r * N] = hessian[c + r * hessianStride];
+				for (int i = 0; i < N; i++)
+				{
+					float & ele = A[i + i * N];
+					if (!(fabs(ele) < 1e-15f)) ele *= (1.0f + lambda); else ele = lambda * 1e-10f;
+				}
+
+				// A = L D L^T, with the unit lower triangular L stored below the diagonal of A
+				for (int c = 0; c < N; c++)
+				{
+					float d = A[c + c * N];
+					for (int k = 0; k < c; k++) d -= A[k + c * N] * A[k + c * N] * D[k];
+
+					if (!(d > 0.0f))
+					{
+						for (int i = 0; i < N; i++) step[i] = 0.0f;
+						return false;
+					}
+
+					D[c] = d;
+					float inv_d = 1.0f / d;
+
+					for (int r = c + 1; r < N; r++)
+					{
+						float val = A[c + r * N];
+						for (int k = 0; k < c; k++) val -= A[k + r * N] * A[k + c * N] * D[k];
+						A[c + r * N] = val * inv_d;
+					}
+				}
+
+				for (int i = 0; i < N; i++)
+				{
+					float val = nabla[i];
+					for (int k = 0; k < i; k++) val -= A[k + i * N] * y[k];
+					y[i] = val;
+				}
+
+				for (int i = N - 1; i >= 0; i--)
+				{
+					float val = y[i] / D[i];
+					for (int k = i + 1; k < N; k++) val -= A[i + k * N] * step[k];
+					step[i] = val;
+				}
+
+				return true;
+			}
+
+			/// Runtime dispatch to the 3 or 6 parameter solver
+			static bool SolveDamped(float *step, const float *hessian, int hessianStride, const float *nabla, float lambda, int noParameters)
+			{
+				if (noParameters == 3) return SolveDamped<3>(step, hessian, hessianStride, nabla, lambda);
+				return SolveDamped<6>(step, hessian, hessianStride, nabla, lambda);
+			}
+
+			/** Expand a step of the given iteration type into a full
+			    (tx, ty, tz, rx, ry, rz) twist.
+			*/
+			static void GetTwist(float *twist, const float *step, TrackerIterationType iterationType, ParameterLayout layout)
+			{
+				int rotationOffset = (layout == PARAMS_ROTATION_FIRST) ? 0 : 3, translationOffset = 3 - rotationOffset;
+				float rotationSign = (layout == PARAMS_ROTATION_FIRST) ? -1.0f : 1.0f;
+
+				for (int i = 0; i < 6; i++) twist[i] = 0.0f;
+
+				switch (iterationType)
+				{
+				case TRACKER_ITERATION_ROTATION:
+					for (int i = 0; i < 3; i++) twist[3 + i] = rotationSign * step[i];
+					break;
+				case TRACKER_ITERATION_TRANSLATION:
+					for (int i = 0; i < 3; i++) twist[i] = step[i];
+					break;
+				case TRACKER_ITERATION_BOTH:
+					for (int i = 0; i < 3; i++)
+					{
+						twist[i] = step[translationOffset + i];
+						twist[3 + i] = rotationSign * step[rotationOffset + i];
+					}
+					break;
+				default: break;
+				}
+			}
+
+			/// Left multiply @p para_old by the exponential of the step
+			static void ApplyDelta(const Matrix4f & para_old, const float *step, TrackerIterationType iterationType, ParameterLayout layout,
+				Matrix4f & para_new)
+			{
+				float twist[6];
+				GetTwist(twist, step, iterationType, layout);
+
+				ITMPose increment(twist);
+				para_new = increment.GetM() * para_old;
+			}
+		};
+	}
+}
@@ -0,0 +1,154 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#include "ITMRelocaliser.h"
+
+using namespace ITMLib::Engine;
+
+// width of the depth image the ferns are evaluated on
+#define RELOCALISER_MAX_WIDTH 80
+
+/// Small deterministic generator, so that the ferns do not depend on the global rand() state
+static inline float nextRandom(unsigned int &state)
+{
+	state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+	return (float)(state & 0xffffff) / (float)0x1000000;
+}
+
+ITMRelocaliser::ITMRelocaliser(Vector2i imgSize, const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType, int noFerns,
+	int noDecisionsPerFern, float minDepth, float maxDepth, float keyframeDissimilarity, int maxNoKeyframes)
+{
+	this->lowLevelEngine = lowLevelEngine;
+	this->memoryType = memoryType;
+	this->noFerns = noFerns;
+	this->noDecisionsPerFern = noDecisionsPerFern;
+	this->keyframeDissimilarity = keyframeDissimilarity;
+	this->maxNoKeyframes = maxNoKeyframes;
+
+	// always subsample at least once, which also brings CUDA images back to the host
+	noLevels = 1;
+	while ((imgSize.x >> noLevels) > RELOCALISER_MAX_WIDTH) noLevels++;
+
+	depthLevels = new ITMFloatImage*[noLevels];
+	for (int levelId = 0; levelId < noLevels; levelId++)
+	{
+		Vector2i levelSize(imgSize.x >> (levelId + 1), imgSize.y >> (levelId + 1));
+		depthLevels[levelId] = new ITMFloatImage(levelSize, true, memoryType == MEMORYDEVICE_CUDA);
+	}
+
+	Vector2i codeImgSize = depthLevels[noLevels - 1]->noDims;
+
+	decisionLocIds = new int[noFerns * noDecisionsPerFern];
+	decisionThresholds = new float[noFerns * noDecisionsPerFern];
+
+	unsigned int state = 0x9e3779b9;
+	for (int i = 0; i < noFerns * noDecisionsPerFern; i++)
+	{
+		int x = MIN((int)(nextRandom(state) * codeImgSize.x), codeImgSize.x - 1);
+		int y = MIN((int)(nextRandom(state) * codeImgSize.y), codeImgSize.y - 1);
+
+		decisionLocIds[i] = x + y * codeImgSize.x;
+		decisionThresholds[i] = minDepth + nextRandom(state) * (maxDepth - minDepth);
+	}
+
+	currentCodes = new int[noFerns];
+	noValidCodes = 0;
+
+	buckets = new std::vector<int>[noFerns << noDecisionsPerFern];
+}
+
+ITMRelocaliser::~ITMRelocaliser(void)
+{
+	for (int levelId = 0; levelId < noLevels; levelId++) delete depthLevels[levelId];
+	delete[] depthLevels;
+
+	delete[] decisionLocIds;
+	delete[] decisionThresholds;
+	delete[] currentCodes;
+	delete[] buckets;
+}
+
+void ITMRelocaliser::Reset(void)
+{
+	for (int i = 0; i < (noFerns << noDecisionsPerFern); i++) buckets[i].clear();
+	keyframePoses.clear();
+}
+
+void ITMRelocaliser::ComputeCodes(const ITMView *view)
+{
+	// level i here is level i + 1 of the view's depth pyramid, which only exists on the host
+	const ITMFloatImage *input = view->depth;
+	for (int levelId = 0; levelId < noLevels; levelId++)
+	{
+		if (levelId + 1 < view->noDepthPyramidLevels) { input = view->depthPyramid[levelId + 1]; continue; }
+
+		lowLevelEngine->FilterSubsampleWithHoles(depthLevels[levelId], input);
+		input = depthLevels[levelId];
+	}
+
+	if (memoryType == MEMORYDEVICE_CUDA) depthLevels[noLevels - 1]->UpdateHostFromDevice();
+
+	const float *depthData = input->GetData(MEMORYDEVICE_CPU);
+
+	noValidCodes = 0;
+	for (int fernId = 0; fernId < noFerns; fernId++)
+	{
+		int code = 0;
+		for (int decisionId = 0; decisionId < noDecisionsPerFern; decisionId++)
+		{
+			int offset = fernId * noDecisionsPerFern + decisionId;
+			float z = depthData[decisionLocIds[offset]];
+
+			if (!(z > 0.0f)) { code = -1; break; }
+			if (z > decisionThresholds[offset]) code |= 1 << decisionId;
+		}
+
+		currentCodes[fernId] = code;
+		if (code >= 0) noValidCodes++;
+	}
+}
+
+float ITMRelocaliser::FindNearestKeyframe(int &keyframeId)
+{
+	keyframeId = -1;
+	if (keyframePoses.empty() || noValidCodes == 0) return 2.0f;
+
+	similarities.assign(keyframePoses.size(), 0);
+
+	for (int fernId = 0; fernId < noFerns; fernId++)
+	{
+		if (currentCodes[fernId] < 0) continue;
+
+		const std::vector<int> &bucket = buckets[(fernId << noDecisionsPerFern) + currentCodes[fernId]];
+		for (size_t i = 0; i < bucket.size(); i++) similarities[bucket[i]]++;
+	}
+
+	int bestSimilarity = -1;
+	for (int i = 0; i < (int)similarities.size(); i++)
+	{
+		if (similarities[i] > bestSimilarity) { bestSimilarity = similarities[i]; keyframeId = i; }
+	}
+
+	return 1.0f - (float)bestSimilarity / (float)noValidCodes;
+}
+
+bool ITMRelocaliser::AddKeyframe(const ITMPose *pose)
+{
+	if ((int)keyframePoses.size() >= maxNoKeyframes) return false;
+
+	// frames that are mostly holes describe the scene poorly
+	if (noValidCodes < noFerns / 2) return false;
+
+	int nearestId;
+	if (FindNearestKeyframe(nearestId) <= keyframeDissimilarity) return false;
+
+	int keyframeId = (int)keyframePoses.size();
+	keyframePoses.push_back(*pose);
+
+	for (int fernId = 0; fernId < noFerns; fernId++)
+	{
+		if (currentCodes[fernId] < 0) continue;
+		buckets[(fernId << noDecisionsPerFern) + currentCodes[fernId]].push_back(keyframeId);
+	}
+
+	return true;
+}
@@ -0,0 +1,85 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include <vector>
+
+#include "../Utils/ITMLibDefines.h"
+
+#include "../Objects/ITMPose.h"
+#include "../Objects/ITMView.h"
+
+#include "../Engine/ITMLowLevelEngine.h"
+
+using namespace ITMLib::Objects;
+
+namespace ITMLib
+{
+	namespace Engine
+	{
+		/** \brief
+		    Keyframe index for recovering from tracking failures.
+
+		    Each frame is reduced to a small depth image and encoded
+		    with a set of random ferns. Every fern compares the depth
+		    at a few fixed pixels against fixed thresholds, giving one
+		    code word per fern. Keyframes are stored in per-fern
+		    buckets of their code words, so finding the most similar
+		    keyframe only touches the keyframes that share at least
+		    one code word with the current frame. A new keyframe is
+		    only added if no existing one is similar to it.
+		*/
+		class ITMRelocaliser
+		{
+		private:
+			const ITMLowLevelEngine *lowLevelEngine;
+			MemoryDeviceType memoryType;
+
+			ITMFloatImage **depthLevels; int noLevels;
+
+			int noFerns, noDecisionsPerFern;
+			int *decisionLocIds; float *decisionThresholds;
+
+			/// Code words of the current frame, -1 where a fern sees a hole
+			int *currentCodes;
+			int noValidCodes;
+
+			/// Keyframe ids per fern and code word
+			std::vector<int> *buckets;
+			std::vector<ITMPose> keyframePoses;
+			std::vector<int> similarities;
+
+			int maxNoKeyframes;
+			float keyframeDissimilarity;
+
+		public:
+			/// Encode the depth image of the current frame, using its depth pyramid where available
+			void ComputeCodes(const ITMView *view);
+
+			/** Find the stored keyframe most similar to the current
+			    frame. Returns its dissimilarity in [0, 1], or a value
+			    above 1 if there is no keyframe to compare against.
+			*/
+			float FindNearestKeyframe(int &keyframeId);
+
+			/** Store the current frame as a keyframe with the given
+			    pose if it is not similar to any existing keyframe.
+			    Returns whether the keyframe was added.
+			*/
+			bool AddKeyframe(const ITMPose *pose);
+
+			const ITMPose *GetKeyframePose(int keyframeId) const { return &keyframePoses[keyframeId]; }
+			int GetNoKeyframes(void) const { return (int)keyframePoses.size(); }
+
+			void Reset(void);
+
+			ITMRelocaliser(Vector2i imgSize, const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType, int noFerns, int noDecisionsPerFern,
+				float minDepth, float maxDepth, float keyframeDissimilarity, int maxNoKeyframes);
+			~ITMRelocaliser(void);
+
+			// Suppress the default copy constructor and assignment operator
+			ITMRelocaliser(const ITMRelocaliser&);
+			ITMRelocaliser& operator=(const ITMRelocaliser&);
+		};
+	}
+}
@@ -6,9 +6,11 @@
 
 #include "../Objects/ITMImageHierarchy.h"
 #include "../Objects/ITMTemplatedHierarchyLevel.h"
+#include "../Objects/ITMSelectionHierarchyLevel.h"
 
 #include "../Engine/ITMTracker.h"
 #include "../Engine/ITMLowLevelEngine.h"
+#include "../Engine/ITMPixelSelector.h"
 
 using namespace ITMLib::Objects;
 
@@ -24,6 +26,7 @@ namespace ITMLib
 		private:
 			ITMTrackingState *trackingState; 
 			const ITMLowLevelEngine *lowLevelEngine;
+			ITMPixelSelector *pixelSelector;
 			
 
 			ITMFloatImage *tempImage1, *tempImage2;
@@ -38,6 +41,9 @@ namespace ITMLib
 			const ITMScene<TVoxel, TIndex> *scene;
 			ITMImageHierarchy<ITMTemplatedHierarchyLevel<ITMFloat4Image> > *viewHierarchy;
 
+			/// Points to evaluate at each level, or NULL to evaluate all of them
+			ITMImageHierarchy<ITMSelectionHierarchyLevel> *selectionHierarchy;
+
 			int levelId;
 			bool rotationOnly;
 
@@ -51,13 +57,13 @@ namespace ITMLib
 
 		public:
 
-			void applyDelta(const ITMPose & para_old, const float *delta, ITMPose & para_new) const;
 			int numParameters(void) const { return 6; }
 
 			void TrackCamera(ITMTrackingState *trackingState, const ITMView *view);
 
 			ITMRenTracker(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, const ITMLowLevelEngine *lowLevelEngine, 
-				const ITMScene<TVoxel, TIndex> *scene, MemoryDeviceType memoryType);
+				const ITMScene<TVoxel, TIndex> *scene, MemoryDeviceType memoryType,
+				ITMLibSettings::PixelSelectionType pixelSelectionType = ITMLibSettings::PIXELSELECTION_ALL, int pixelSelectionStride = 1);
 
 			virtual ~ITMRenTracker(void);
 		};
@@ -47,6 +47,24 @@ namespace ITMLib
 			virtual void IntegrateIntoScene(ITMScene<TVoxel,TIndex> *scene, const ITMView *view, const ITMTrackingState *trackingState,
 				const ITMRenderState *renderState) = 0;
 
+			/** Release the voxel blocks that are out of view and
+			    carry no surface, i.e. all of their observed voxels
+			    are at least @p minSdf in front of a surface and
+			    none has been observed more than @p maxW times.
+			    Engines that do not support this leave the scene
+			    unchanged.
+			*/
+			virtual void CollectGarbage(ITMScene<TVoxel,TIndex> *scene, const ITMRenderState *renderState, float minSdf, int maxW) { }
+
+			/** Move the voxel blocks in use to the start of the
+			    voxel block array, in the Morton order of their
+			    positions, so that blocks close in space are close
+			    in memory. The visible list of @p renderState is
+			    kept valid. Engines that do not support this leave
+			    the scene unchanged.
+			*/
+			virtual void DefragmentVoxelBlocks(ITMScene<TVoxel,TIndex> *scene, const ITMRenderState *renderState) { }
+
 			ITMSceneReconstructionEngine(void) { }
 			virtual ~ITMSceneReconstructionEngine(void) { }
 		};
@@ -5,6 +5,7 @@
 #include <map>
 #include <stdexcept>
 
+#include "ITMCascadeTracker.h"
 #include "ITMCompositeTracker.h"
 #include "ITMIMUTracker.h"
 #include "ITMLowLevelEngine.h"
@@ -81,6 +82,8 @@ namespace ITMLib
         typename std::map<ITMLibSettings::TrackerType,Maker>::const_iterator it = makers.find(settings->trackerType);
         if(it == makers.end()) DIEWITHEXCEPTION("Unknown tracker type");
 
+        if(settings->useTrackerCascade) return MakeCascadeTracker(trackedImageSize, settings, lowLevelEngine, imuCalibrator, scene);
+
         Maker maker = it->second;
         return (*maker)(trackedImageSize, settings, lowLevelEngine, imuCalibrator, scene);
       }
@@ -97,7 +100,8 @@ namespace ITMLib
         {
           case ITMLibSettings::DEVICE_CPU:
           {
-            return new ITMColorTracker_CPU(trackedImageSize, settings->trackingRegime, settings->noHierarchyLevels, lowLevelEngine);
+            return new ITMColorTracker_CPU(trackedImageSize, settings->trackingRegime, settings->noHierarchyLevels, lowLevelEngine,
+              settings->pixelSelectionType, settings->pixelSelectionStride, settings->useIntensityColourTracking);
           }
           case ITMLibSettings::DEVICE_CUDA:
           {
@@ -110,7 +114,8 @@ namespace ITMLib
           case ITMLibSettings::DEVICE_METAL:
           {
 #ifdef COMPILE_WITH_METAL
-            return new ITMColorTracker_CPU(trackedImageSize, settings->trackingRegime, settings->noHierarchyLevels, lowLevelEngine);
+            return new ITMColorTracker_CPU(trackedImageSize, settings->trackingRegime, settings->noHierarchyLevels, lowLevelEngine,
+              settings->pixelSelectionType, settings->pixelSelectionStride, settings->useIntensityColourTracking);
 #else
             break;
 #endif
@@ -127,113 +132,54 @@ namespace ITMLib
       static ITMTracker *MakeICPTracker(const Vector2i& trackedImageSize, const ITMLibSettings *settings, const ITMLowLevelEngine *lowLevelEngine,
                                         ITMIMUCalibrator *imuCalibrator, ITMScene<TVoxel,TIndex> *scene)
       {
-        switch(settings->deviceType)
+        return MakeDepthTracker(trackedImageSize, settings, lowLevelEngine, settings->noICPRunTillLevel);
+      }
+
+      /**
+       * \brief Makes a cascade of a coarse and a full tracker of the type specified in the settings.
+       */
+      static ITMTracker *MakeCascadeTracker(const Vector2i& trackedImageSize, const ITMLibSettings *settings, const ITMLowLevelEngine *lowLevelEngine,
+                                            ITMIMUCalibrator *imuCalibrator, ITMScene<TVoxel,TIndex> *scene)
+      {
+        int cheapTillLevel = MAX(settings->noICPRunTillLevel, settings->cascadeCheapTillLevel);
+        ITMTracker *cheapTracker, *fullTracker;
+
+        switch(settings->trackerType)
         {
-          case ITMLibSettings::DEVICE_CPU:
+          case ITMLibSettings::TRACKER_ICP:
+          case ITMLibSettings::TRACKER_IMU:
           {
-            return new ITMDepthTracker_CPU(
-              trackedImageSize,
-              settings->trackingRegime,
-              settings->noHierarchyLevels,
-              settings->noICPRunTillLevel,
-              settings->depthTrackerICPThreshold,
-              settings->depthTrackerTerminationThreshold,
-              lowLevelEngine
-            );
-          }
-          case ITMLibSettings::DEVICE_CUDA:
-          {
-#ifndef COMPILE_WITHOUT_CUDA
-            return new ITMDepthTracker_CUDA(
-              trackedImageSize,
-              settings->trackingRegime,
-              settings->noHierarchyLevels,
-              settings->noICPRunTillLevel,
-              settings->depthTrackerICPThreshold,
-              settings->depthTrackerTerminationThreshold,
-              lowLevelEngine
-            );
-#else
+            cheapTracker = MakeDepthTracker(trackedImageSize, settings, lowLevelEngine, cheapTillLevel);
+            fullTracker = MakeDepthTracker(trackedImageSize, settings, lowLevelEngine, settings->noICPRunTillLevel);
             break;
-#endif
           }
-          case ITMLibSettings::DEVICE_METAL:
+          case ITMLibSettings::TRACKER_WICP:
           {
-#ifdef COMPILE_WITH_METAL
-            return new ITMDepthTracker_Metal(
-              trackedImageSize,
-              settings->trackingRegime,
-              settings->noHierarchyLevels,
-              settings->noICPRunTillLevel,
-              settings->depthTrackerICPThreshold,
-              settings->depthTrackerTerminationThreshold,
-              lowLevelEngine
-            );
-#else
+            cheapTracker = MakeWeightedDepthTracker(trackedImageSize, settings, lowLevelEngine, cheapTillLevel);
+            fullTracker = MakeWeightedDepthTracker(trackedImageSize, settings, lowLevelEngine, settings->noICPRunTillLevel);
             break;
-#endif
           }
-          default: break;
+          default:
+            DIEWITHEXCEPTION("Tracker cascade requires an ICP, weighted ICP or IMU tracker");
         }
 
-        DIEWITHEXCEPTION("Failed to make ICP tracker");
+        ITMTracker *cascadeTracker = new ITMCascadeTracker(cheapTracker, fullTracker, settings->cascadeMaxResidual, settings->cascadeMinInlierRatio);
+        if(settings->trackerType != ITMLibSettings::TRACKER_IMU) return cascadeTracker;
+
+        // the IMU tracker consumes a measurement per call, so it runs once ahead of both stages
+        ITMCompositeTracker *compositeTracker = new ITMCompositeTracker(2);
+        compositeTracker->SetTracker(new ITMIMUTracker(imuCalibrator), 0);
+        compositeTracker->SetTracker(cascadeTracker, 1);
+        return compositeTracker;
       }
+
 	  /**
 	  * \brief Makes an WICP tracker.
 	  */
 	  static ITMTracker *MakeWeightedICPTracker(const Vector2i& trackedImageSize, const ITMLibSettings *settings, const ITMLowLevelEngine *lowLevelEngine,
 		  ITMIMUCalibrator *imuCalibrator, ITMScene<TVoxel, TIndex> *scene)
 	  {
-		  switch (settings->deviceType)
-		  {
-		  case ITMLibSettings::DEVICE_CPU:
-		  {
-			  return new ITMWeightedICPTracker_CPU(
-				  trackedImageSize,
-				  settings->trackingRegime,
-				  settings->noHierarchyLevels,
-				  settings->noICPRunTillLevel,
-				  settings->depthTrackerICPThreshold,
-				  settings->depthTrackerTerminationThreshold,
-				  lowLevelEngine
-				  );
-		  }
-		  case ITMLibSettings::DEVICE_CUDA:
-		  {
-#ifndef COMPILE_WITHOUT_CUDA
-			  return new ITMWeightedICPTracker_CUDA(
-				  trackedImageSize,
-				  settings->trackingRegime,
-				  settings->noHierarchyLevels,
-				  settings->noICPRunTillLevel,
-				  settings->depthTrackerICPThreshold,
-				  settings->depthTrackerTerminationThreshold,
-				  lowLevelEngine
-				  );
-#else
-			  break;
-#endif
-		  }
-		  case ITMLibSettings::DEVICE_METAL:
-		  {
-#ifdef COMPILE_WITH_METAL
-			  return new ITMDepthTracker_Metal(
-				  trackedImageSize,
-				  settings->trackingRegime,
-				  settings->noHierarchyLevels,
-				  settings->noICPRunTillLevel,
-				  settings->depthTrackerICPThreshold,
-				  settings->depthTrackerTerminationThreshold,
-				  lowLevelEngine
-				  );
-#else
-			  break;
-#endif
-		  }
-		  default: break;
-		  }
-
-		  throw std::runtime_error("Failed to make ICP tracker");
+		  return MakeWeightedDepthTracker(trackedImageSize, settings, lowLevelEngine, settings->noICPRunTillLevel);
 	  }
 
       /**
@@ -256,7 +202,9 @@ namespace ITMLib
                 settings->noICPRunTillLevel,
                 settings->depthTrackerICPThreshold,
                 settings->depthTrackerTerminationThreshold,
-                lowLevelEngine
+                lowLevelEngine,
+                settings->pixelSelectionType,
+                settings->pixelSelectionStride
               ), 1
             );
             return compositeTracker;
@@ -323,7 +271,9 @@ namespace ITMLib
               trackedImageSize,
               settings->trackingRegime,
               2,
-              lowLevelEngine, scene
+              lowLevelEngine, scene,
+              settings->pixelSelectionType,
+              settings->pixelSelectionStride
             );
           }
           case ITMLibSettings::DEVICE_CUDA:
@@ -347,7 +297,9 @@ namespace ITMLib
               trackedImageSize,
               settings->trackingRegime,
               2,
-              lowLevelEngine, scene
+              lowLevelEngine, scene,
+              settings->pixelSelectionType,
+              settings->pixelSelectionStride
             );
 #else
             break;
@@ -358,6 +310,128 @@ namespace ITMLib
 
         DIEWITHEXCEPTION("Failed to make Ren tracker");
       }
+
+      //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+    private:
+      /**
+       * \brief Makes an ICP tracker that stops at the given hierarchy level.
+       */
+      static ITMTracker *MakeDepthTracker(const Vector2i& trackedImageSize, const ITMLibSettings *settings, const ITMLowLevelEngine *lowLevelEngine,
+                                          int noICPRunTillLevel)
+      {
+        switch(settings->deviceType)
+        {
+          case ITMLibSettings::DEVICE_CPU:
+          {
+            return new ITMDepthTracker_CPU(
+              trackedImageSize,
+              settings->trackingRegime,
+              settings->noHierarchyLevels,
+              noICPRunTillLevel,
+              settings->depthTrackerICPThreshold,
+              settings->depthTrackerTerminationThreshold,
+              lowLevelEngine,
+              settings->pixelSelectionType,
+              settings->pixelSelectionStride
+            );
+          }
+          case ITMLibSettings::DEVICE_CUDA:
+          {
+#ifndef COMPILE_WITHOUT_CUDA
+            return new ITMDepthTracker_CUDA(
+              trackedImageSize,
+              settings->trackingRegime,
+              settings->noHierarchyLevels,
+              noICPRunTillLevel,
+              settings->depthTrackerICPThreshold,
+              settings->depthTrackerTerminationThreshold,
+              lowLevelEngine
+            );
+#else
+            break;
+#endif
+          }
+          case ITMLibSettings::DEVICE_METAL:
+          {
+#ifdef COMPILE_WITH_METAL
+            return new ITMDepthTracker_Metal(
+              trackedImageSize,
+              settings->trackingRegime,
+              settings->noHierarchyLevels,
+              noICPRunTillLevel,
+              settings->depthTrackerICPThreshold,
+              settings->depthTrackerTerminationThreshold,
+              lowLevelEngine
+            );
+#else
+            break;
+#endif
+          }
+          default: break;
+        }
+
+        DIEWITHEXCEPTION("Failed to make ICP tracker");
+      }
+
+	  /**
+	  * \brief Makes a WICP tracker that stops at the given hierarchy level.
+	  */
+	  static ITMTracker *MakeWeightedDepthTracker(const Vector2i& trackedImageSize, const ITMLibSettings *settings, const ITMLowLevelEngine *lowLevelEngine,
+		  int noICPRunTillLevel)
+	  {
+		  switch (settings->deviceType)
+		  {
+		  case ITMLibSettings::DEVICE_CPU:
+		  {
+			  return new ITMWeightedICPTracker_CPU(
+				  trackedImageSize,
+				  settings->trackingRegime,
+				  settings->noHierarchyLevels,
+				  noICPRunTillLevel,
+				  settings->depthTrackerICPThreshold,
+				  settings->depthTrackerTerminationThreshold,
+				  lowLevelEngine,
+				  settings->pixelSelectionType,
+				  settings->pixelSelectionStride
+				  );
+		  }
+		  case ITMLibSettings::DEVICE_CUDA:
+		  {
+#ifndef COMPILE_WITHOUT_CUDA
+			  return new ITMWeightedICPTracker_CUDA(
+				  trackedImageSize,
+				  settings->trackingRegime,
+				  settings->noHierarchyLevels,
+				  noICPRunTillLevel,
+				  settings->depthTrackerICPThreshold,
+				  settings->depthTrackerTerminationThreshold,
+				  lowLevelEngine
+				  );
+#else
+			  break;
+#endif
+		  }
+		  case ITMLibSettings::DEVICE_METAL:
+		  {
+#ifdef COMPILE_WITH_METAL
+			  return new ITMDepthTracker_Metal(
+				  trackedImageSize,
+				  settings->trackingRegime,
+				  settings->noHierarchyLevels,
+				  noICPRunTillLevel,
+				  settings->depthTrackerICPThreshold,
+				  settings->depthTrackerTerminationThreshold,
+				  lowLevelEngine
+				  );
+#else
+			  break;
+#endif
+		  }
+		  default: break;
+		  }
+
+		  throw std::runtime_error("Failed to make ICP tracker");
+	  }
     };
   }
 }
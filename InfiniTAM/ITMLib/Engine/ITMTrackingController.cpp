@@ -10,9 +10,39 @@ using namespace ITMLib::Engine;
 
 void ITMTrackingController::Track(ITMTrackingState *trackingState, const ITMView *view)
 {
+	trackingState->ResetTrackingQuality();
 	if (trackingState->age_pointCloud!=-1) tracker->TrackCamera(trackingState, view);
 
 	trackingState->requiresFullRendering = trackingState->TrackerFarFromPointCloud() || !settings->useApproximateRaycast;
+
+	if (relocaliser != NULL) Relocalise(trackingState, view);
+}
+
+void ITMTrackingController::Relocalise(ITMTrackingState *trackingState, const ITMView *view)
+{
+	relocaliser->ComputeCodes(view);
+
+	// a negative residual means the tracker did not run or does not report one
+	bool trackingFailed = trackingState->trackingResidual >= 0.0f &&
+		(trackingState->trackingResidual > settings->relocalisationMaxResidual ||
+		trackingState->trackingInlierRatio < settings->relocalisationMinInlierRatio);
+
+	if (!trackingFailed)
+	{
+		trackingState->trackerResult = ITMTrackingState::TRACKING_GOOD;
+		relocaliser->AddKeyframe(trackingState->pose_d);
+		return;
+	}
+
+	trackingState->trackerResult = ITMTrackingState::TRACKING_FAILED;
+
+	int keyframeId;
+	relocaliser->FindNearestKeyframe(keyframeId);
+	if (keyframeId < 0) return;
+
+	// re-seed the tracker at the keyframe, with ICP maps rendered from there
+	trackingState->pose_d->SetFrom(relocaliser->GetKeyframePose(keyframeId));
+	trackingState->requiresFullRendering = true;
 }
 
 void ITMTrackingController::Prepare(ITMTrackingState *trackingState, const ITMView *view, ITMRenderState *renderState)
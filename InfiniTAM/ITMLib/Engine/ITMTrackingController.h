@@ -9,6 +9,7 @@
 
 #include "../Engine/ITMVisualisationEngine.h"
 #include "../Engine/ITMLowLevelEngine.h"
+#include "../Engine/ITMRelocaliser.h"
 
 #include "ITMTrackerFactory.h"
 
@@ -26,15 +27,21 @@ namespace ITMLib
 			const ITMLowLevelEngine *lowLevelEngine;
 
 			ITMTracker *tracker;
+			ITMRelocaliser *relocaliser;
 
 			MemoryDeviceType memoryType;
 
+			void Relocalise(ITMTrackingState *trackingState, const ITMView *view);
+
 		public:
 			void Track(ITMTrackingState *trackingState, const ITMView *view);
 			void Prepare(ITMTrackingState *trackingState, const ITMView *view, ITMRenderState *renderState);
 
+			/// Gives access to the keyframes, NULL if relocalisation is disabled
+			ITMRelocaliser *GetRelocaliser(void) { return relocaliser; }
+
 			ITMTrackingController(ITMTracker *tracker, const IITMVisualisationEngine *visualisationEngine, const ITMLowLevelEngine *lowLevelEngine,
-				const ITMLibSettings *settings)
+				const ITMLibSettings *settings, const Vector2i & trackedImageSize)
 			{
 				this->tracker = tracker;
 				this->settings = settings;
@@ -42,11 +49,29 @@ namespace ITMLib
 				this->lowLevelEngine = lowLevelEngine;
 
 				memoryType = settings->deviceType == ITMLibSettings::DEVICE_CUDA ? MEMORYDEVICE_CUDA : MEMORYDEVICE_CPU;
+
+				// failures are detected from the ICP residual and inlier ratio. The colour and Ren trackers
+				// report neither, so they would never fail and the relocaliser would only collect keyframes.
+				relocaliser = NULL;
+				if (settings->useRelocalisation && settings->trackerType != ITMLibSettings::TRACKER_COLOR &&
+					settings->trackerType != ITMLibSettings::TRACKER_REN)
+				{
+					relocaliser = new ITMRelocaliser(trackedImageSize, lowLevelEngine, memoryType, settings->relocalisationNoFerns,
+						settings->relocalisationNoDecisionsPerFern, settings->sceneParams.viewFrustum_min, settings->sceneParams.viewFrustum_max,
+						settings->relocalisationKeyframeDissimilarity, settings->relocalisationMaxNoKeyframes);
+				}
+			}
+
+			~ITMTrackingController(void)
+			{
+				if (relocaliser != NULL) delete relocaliser;
 			}
 
 			ITMTrackingState *BuildTrackingState(const Vector2i & trackedImageSize) const
 			{
-				return new ITMTrackingState(trackedImageSize, memoryType);
+				// the compact ICP maps are only produced and consumed by the CPU implementations
+				bool useCompactICPMaps = settings->useCompactICPMaps && settings->deviceType == ITMLibSettings::DEVICE_CPU;
+				return new ITMTrackingState(trackedImageSize, memoryType, useCompactICPMaps);
 			}
 
 			static Vector2i GetTrackedImageSize(const ITMLibSettings *settings, const Vector2i& imgSize_rgb, const Vector2i& imgSize_d)
@@ -1,14 +1,15 @@
 // Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
 
 #include "ITMWeightedICPTracker.h"
-#include "../../ORUtils/Cholesky.h"
+#include "ITMPoseSolver.h"
 
 #include <math.h>
 
 using namespace ITMLib::Engine;
 
 ITMWeightedICPTracker::ITMWeightedICPTracker(Vector2i imgSize, TrackerIterationType *trackingRegime, int noHierarchyLevels, int noICPRunTillLevel, float distThresh,
-	float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType)
+	float terminationThreshold, const ITMLowLevelEngine *lowLevelEngine, MemoryDeviceType memoryType,
+	ITMLibSettings::PixelSelectionType pixelSelectionType, int pixelSelectionStride)
 {
 	if (memoryType==MEMORYDEVICE_CUDA) 
 	{
@@ -39,7 +40,11 @@ ITMWeightedICPTracker::ITMWeightedICPTracker(Vector2i imgSize, TrackerIterationT
 
 	this->lowLevelEngine = lowLevelEngine;
 
+	pixelSelector = ITMPixelSelector::Create(imgSize, pixelSelectionType, pixelSelectionStride, memoryType);
+	selectionHierarchy = (pixelSelector != NULL) ? new ITMImageHierarchy<ITMSelectionHierarchyLevel>(imgSize, trackingRegime, noHierarchyLevels, MEMORYDEVICE_CPU) : NULL;
+
 	this->noICPLevel = noICPRunTillLevel;
+	this->usesViewPyramid = false;
 
 	this->terminationThreshold = terminationThreshold;
 }
@@ -49,6 +54,9 @@ ITMWeightedICPTracker::~ITMWeightedICPTracker(void)
 	delete this->viewHierarchy;
 	delete this->weightHierarchy;
 	delete this->sceneHierarchy;
+
+	if (this->pixelSelector != NULL) delete this->pixelSelector;
+	if (this->selectionHierarchy != NULL) delete this->selectionHierarchy;
 	
 
 	delete[] this->noIterationsPerLevel;
@@ -65,9 +73,18 @@ void ITMWeightedICPTracker::SetEvaluationData(ITMTrackingState *trackingState, c
 	// the image hierarchy allows pointers to external data at level 0
 	viewHierarchy->levels[0]->depth = view->depth;
 	weightHierarchy->levels[0]->depth = view->depthUncertainty;
+
+	// if the view builder already subsampled the depth image, the other levels can point there as well
+	usesViewPyramid = view->depthPyramid != NULL && view->noDepthPyramidLevels >= viewHierarchy->noLevels;
+	if (usesViewPyramid)
+	{
+		for (int i = 1; i < viewHierarchy->noLevels; i++) viewHierarchy->levels[i]->SetExternalData(view->depthPyramid[i]);
+	}
 	
 	sceneHierarchy->levels[0]->pointsMap = trackingState->pointCloud->locations;
 	sceneHierarchy->levels[0]->normalsMap = trackingState->pointCloud->colours;
+	sceneHierarchy->levels[0]->compactDepthMap = trackingState->pointCloud->compactDepth;
+	sceneHierarchy->levels[0]->compactNormalsMap = trackingState->pointCloud->compactNormals;
 
 	scenePose = trackingState->pose_pointCloud->GetM();
 }
@@ -79,7 +96,7 @@ void ITMWeightedICPTracker::PrepareForEvaluation()
 
 
 		ITMTemplatedHierarchyLevel<ITMFloatImage> *currentWICPLevel = viewHierarchy->levels[i], *previousWICPHierarch = viewHierarchy->levels[i - 1];
-		lowLevelEngine->FilterSubsampleWithHoles(currentWICPLevel->depth, previousWICPHierarch->depth);
+		if (!usesViewPyramid) lowLevelEngine->FilterSubsampleWithHoles(currentWICPLevel->depth, previousWICPHierarch->depth);
 		currentWICPLevel->intrinsics = previousWICPHierarch->intrinsics * 0.5f;
 
 		currentWICPLevel = weightHierarchy->levels[i], previousWICPHierarch = weightHierarchy->levels[i - 1];
@@ -88,6 +105,15 @@ void ITMWeightedICPTracker::PrepareForEvaluation()
 		ITMSceneHierarchyLevel *currentLevelScene = sceneHierarchy->levels[i], *previousLevelScene = sceneHierarchy->levels[i - 1];
 		currentLevelScene->intrinsics = previousLevelScene->intrinsics * 0.5f;
 	}
+
+	if (pixelSelector != NULL)
+	{
+		for (int i = noICPLevel; i < viewHierarchy->noLevels; i++)
+		{
+			ITMTemplatedHierarchyLevel<ITMFloatImage> *currentLevelView = viewHierarchy->levels[i];
+			pixelSelector->SelectFromDepth(selectionHierarchy->levels[i], currentLevelView->depth, currentLevelView->intrinsics);
+		}
+	}
 }
 
 void ITMWeightedICPTracker::SetEvaluationParams(int levelId)
@@ -96,28 +122,10 @@ void ITMWeightedICPTracker::SetEvaluationParams(int levelId)
 	this->iterationType = viewHierarchy->levels[levelId]->iterationType;
 	this->sceneHierarchyLevel = sceneHierarchy->levels[0];
 	this->viewHierarchyLevel = viewHierarchy->levels[levelId];
+	this->selectionHierarchyLevel = (selectionHierarchy != NULL) ? selectionHierarchy->levels[levelId] : NULL;
 	this->weightHierarchyLevel = weightHierarchy->levels[levelId];
 }
 
-void ITMWeightedICPTracker::ComputeDelta(float *step, float *nabla, float *hessian, bool shortIteration) const
-{
-	for (int i = 0; i < 6; i++) step[i] = 0;
-
-	if (shortIteration)
-	{
-		float smallHessian[3 * 3];
-		for (int r = 0; r < 3; r++) for (int c = 0; c < 3; c++) smallHessian[r + c * 3] = hessian[r + c * 6];
-
-		ORUtils::Cholesky cholA(smallHessian, 3);
-		cholA.Backsub(step, nabla);
-	}
-	else
-	{
-		ORUtils::Cholesky cholA(hessian, 6);
-		cholA.Backsub(step, nabla);
-	}
-}
-
 bool ITMWeightedICPTracker::HasConverged(float *step) const
 {
 
@@ -129,35 +137,6 @@ bool ITMWeightedICPTracker::HasConverged(float *step) const
 	return false;
 }
 
-void ITMWeightedICPTracker::ApplyDelta(const Matrix4f & para_old, const float *delta, Matrix4f & para_new) const
-{
-	float step[6];
-
-	switch (iterationType)
-	{
-	case TRACKER_ITERATION_ROTATION:
-		step[0] = (float)(delta[0]); step[1] = (float)(delta[1]); step[2] = (float)(delta[2]);
-		step[3] = 0.0f; step[4] = 0.0f; step[5] = 0.0f;
-		break;
-	case TRACKER_ITERATION_TRANSLATION:
-		step[0] = 0.0f; step[1] = 0.0f; step[2] = 0.0f;
-		step[3] = (float)(delta[0]); step[4] = (float)(delta[1]); step[5] = (float)(delta[2]);
-		break;
-	default:
-	case TRACKER_ITERATION_BOTH:
-		step[0] = (float)(delta[0]); step[1] = (float)(delta[1]); step[2] = (float)(delta[2]);
-		step[3] = (float)(delta[3]); step[4] = (float)(delta[4]); step[5] = (float)(delta[5]);
-		break;
-	}
-
-	Matrix4f Tinc;
-	Tinc.m00 = 1.0f;		Tinc.m10 = step[2];		Tinc.m20 = -step[1];	Tinc.m30 = step[3];
-	Tinc.m01 = -step[2];	Tinc.m11 = 1.0f;		Tinc.m21 = step[0];		Tinc.m31 = step[4];
-	Tinc.m02 = step[1];		Tinc.m12 = -step[0];	Tinc.m22 = 1.0f;		Tinc.m32 = step[5];
-	Tinc.m03 = 0.0f;		Tinc.m13 = 0.0f;		Tinc.m23 = 0.0f;		Tinc.m33 = 1.0f;
-	para_new = Tinc * para_old;
-}
-
 void ITMWeightedICPTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView *view)
 {
 	this->SetEvaluationData(trackingState, view);
@@ -173,6 +152,8 @@ void ITMWeightedICPTracker::TrackCamera(ITMTrackingState *trackingState, const I
 
 		if (iterationType == TRACKER_ITERATION_NONE) continue;
 
+		float f_good = 0.0f; int noValidPoints_good = 0;
+
 		for (int iterNo = 0; iterNo < noIterationsPerLevel[levelId]; iterNo++)
 		{
 			int noValidPoints = this->ComputeGandH(f_new, nabla, hessian, approxInvPose);
@@ -180,13 +161,20 @@ void ITMWeightedICPTracker::TrackCamera(ITMTrackingState *trackingState, const I
 			if (noValidPoints <= 0) break;
 			if (f_new > f_old) break;
 
-			ComputeDelta(step, nabla, hessian, iterationType != TRACKER_ITERATION_BOTH);
-			ApplyDelta(approxInvPose, step, approxInvPose);
+			f_good = f_new; noValidPoints_good = noValidPoints;
+
+			for (int i = 0; i < 6; ++i) step[i] = 0.0f;
+			ITMPoseSolver::SolveDamped(step, hessian, 6, nabla, 0.0f, iterationType == TRACKER_ITERATION_BOTH ? 6 : 3);
+			ITMPoseSolver::ApplyDelta(approxInvPose, step, iterationType, ITMPoseSolver::PARAMS_ROTATION_FIRST, approxInvPose);
 			trackingState->pose_d->SetInvM(approxInvPose);
 			trackingState->pose_d->Coerce();
 			approxInvPose = trackingState->pose_d->GetInvM();
 			if (HasConverged(step)) break;
 		}
+
+		int noEvaluatedPoints = (selectionHierarchyLevel != NULL) ? selectionHierarchyLevel->noSelected :
+			viewHierarchyLevel->depth->noDims.x * viewHierarchyLevel->depth->noDims.y;
+		trackingState->SetTrackingQuality(f_good, noValidPoints_good, noEvaluatedPoints);
 	}
 }
 
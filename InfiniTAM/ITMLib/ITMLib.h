@@ -17,6 +17,8 @@
 #include "Engine/DeviceSpecific/Metal/ITMLowLevelEngine_Metal.h"
 #endif
 
+#include "Engine/ITMPixelSelector.h"
+
 #include "Engine/ITMDepthTracker.h"
 #include "Engine/DeviceSpecific/CPU/ITMDepthTracker_CPU.h"
 #ifndef COMPILE_WITHOUT_CUDA
@@ -79,6 +81,8 @@
 
 #include "Engine/ITMIMUTracker.h"
 #include "Engine/ITMCompositeTracker.h"
+#include "Engine/ITMCascadeTracker.h"
+#include "Engine/ITMRelocaliser.h"
 #include "Engine/ITMTrackingController.h"
 
 #include "Engine/ITMViewBuilder.h"
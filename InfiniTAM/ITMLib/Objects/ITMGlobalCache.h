@@ -43,14 +43,14 @@ namespace ITMLib
 
 			int noTotalEntries; 
 
-			ITMGlobalCache() : noTotalEntries(SDF_BUCKET_NUM + SDF_EXCESS_LIST_SIZE)
+			/// Stores the blocks of a hash table with @p noTotalEntries entries, which therefore must not be resized
+			ITMGlobalCache(int noTotalEntries) : noTotalEntries(noTotalEntries)
 			{	
-				hasStoredData = (bool*)malloc(noTotalEntries * sizeof(bool));
+				// calloc hands out zero pages, so none of this becomes resident before it is used
+				hasStoredData = (bool*)calloc(noTotalEntries, sizeof(bool));
 				storedVoxelBlocks = (TVoxel*)malloc(noTotalEntries * sizeof(TVoxel) * SDF_BLOCK_SIZE3);
-				memset(hasStoredData, 0, noTotalEntries);
 
-				swapStates_host = (ITMHashSwapState *)malloc(noTotalEntries * sizeof(ITMHashSwapState));
-				memset(swapStates_host, 0, sizeof(ITMHashSwapState) * noTotalEntries);
+				swapStates_host = (ITMHashSwapState *)calloc(noTotalEntries, sizeof(ITMHashSwapState));
 
 #ifndef COMPILE_WITHOUT_CUDA
 				ITMSafeCall(cudaMallocHost((void**)&syncedVoxelBlocks_host, SDF_TRANSFER_BLOCK_NUM * sizeof(TVoxel) * SDF_BLOCK_SIZE3));
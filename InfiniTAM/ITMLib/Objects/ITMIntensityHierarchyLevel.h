@@ -0,0 +1,65 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include "../Utils/ITMLibDefines.h"
+
+namespace ITMLib
+{
+	namespace Objects
+	{
+		/** \brief
+		    Single channel counterpart of ITMViewHierarchyLevel, holding
+		    the intensity image of one level and its x and y gradients
+		    interleaved in one two channel image.
+		*/
+		class ITMIntensityHierarchyLevel
+		{
+		public:
+			int levelId;
+
+			TrackerIterationType iterationType;
+
+			ITMUCharImage *intensity;
+			ITMShort2Image *gradients;
+
+			bool manageData;
+
+			ITMIntensityHierarchyLevel(Vector2i imgSize, int levelId, TrackerIterationType iterationType, MemoryDeviceType memoryType, bool skipAllocation)
+			{
+				this->manageData = !skipAllocation;
+				this->levelId = levelId;
+				this->iterationType = iterationType;
+
+				if (!skipAllocation) {
+					this->intensity = new ITMUCharImage(imgSize, memoryType);
+					this->gradients = new ITMShort2Image(imgSize, memoryType);
+				}
+			}
+
+			void UpdateHostFromDevice()
+			{ 
+				this->intensity->UpdateHostFromDevice();
+				this->gradients->UpdateHostFromDevice();
+			}
+
+			void UpdateDeviceFromHost()
+			{ 
+				this->intensity->UpdateDeviceFromHost();
+				this->gradients->UpdateDeviceFromHost();
+			}
+
+			~ITMIntensityHierarchyLevel(void)
+			{
+				if (manageData) {
+					delete intensity;
+					delete gradients;
+				}
+			}
+
+			// Suppress the default copy constructor and assignment operator
+			ITMIntensityHierarchyLevel(const ITMIntensityHierarchyLevel&);
+			ITMIntensityHierarchyLevel& operator=(const ITMIntensityHierarchyLevel&);
+		};
+	}
+}
@@ -14,6 +14,12 @@ namespace ITMLib
 		/** \brief
 		Stores the actual voxel content that is referred to by a
 		ITMLib::Objects::ITMHashTable.
+
+		On the CPU the array is only reserved when it is created.
+		The engines initialise each block when they take it from
+		the free list, so the resident memory follows the size of
+		the map while the block pointers stay valid. CUDA and
+		Metal keep the whole array allocated up front.
 		*/
 		template<class TVoxel>
 		class ITMLocalVBA
@@ -22,11 +28,14 @@ namespace ITMLib
 			ORUtils::MemoryBlock<TVoxel> *voxelBlocks;
 			ORUtils::MemoryBlock<int> *allocationList;
 
+			/** Reserved CPU array, NULL if @ref voxelBlocks is used. */
+			TVoxel *voxelBlocks_cpu;
+
 			MemoryDeviceType memoryType;
 
 		public:
-			inline TVoxel *GetVoxelBlocks(void) { return voxelBlocks->GetData(memoryType); }
-			inline const TVoxel *GetVoxelBlocks(void) const { return voxelBlocks->GetData(memoryType); }
+			inline TVoxel *GetVoxelBlocks(void) { return voxelBlocks_cpu != NULL ? voxelBlocks_cpu : voxelBlocks->GetData(memoryType); }
+			inline const TVoxel *GetVoxelBlocks(void) const { return voxelBlocks_cpu != NULL ? voxelBlocks_cpu : voxelBlocks->GetData(memoryType); }
 			int *GetAllocationList(void) { return allocationList->GetData(memoryType); }
 
 #ifdef COMPILE_WITH_METAL
@@ -43,12 +52,26 @@ namespace ITMLib
 
 				allocatedSize = noBlocks * blockSize;
 
-				voxelBlocks = new ORUtils::MemoryBlock<TVoxel>(allocatedSize, memoryType);
+				voxelBlocks = NULL; voxelBlocks_cpu = NULL;
+#ifndef COMPILE_WITH_METAL
+				if (memoryType == MEMORYDEVICE_CPU)
+				{
+					// pages of the reservation only become resident once blocks on them are initialised
+					voxelBlocks_cpu = (TVoxel*)malloc((size_t)allocatedSize * sizeof(TVoxel));
+					if (voxelBlocks_cpu == NULL) DIEWITHEXCEPTION("Could not reserve the voxel block array");
+				}
+				else
+#endif
+				{
+					voxelBlocks = new ORUtils::MemoryBlock<TVoxel>(allocatedSize, memoryType);
+				}
+
 				allocationList = new ORUtils::MemoryBlock<int>(noBlocks, memoryType);
 			}
 
 			~ITMLocalVBA(void)
 			{
+				if (voxelBlocks_cpu != NULL) free(voxelBlocks_cpu);
 				delete voxelBlocks;
 				delete allocationList;
 			}
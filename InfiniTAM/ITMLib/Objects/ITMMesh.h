@@ -19,14 +19,17 @@ namespace ITMLib
 			MemoryDeviceType memoryType;
 
 			uint noTotalTriangles;
-			static const uint noMaxTriangles = SDF_LOCAL_BLOCK_NUM * 32;
+
+			/** Capacity of the triangle buffer, the meshing engines stop adding triangles once it is full. */
+			uint noMaxTriangles;
 
 			ORUtils::MemoryBlock<Triangle> *triangles;
 
-			explicit ITMMesh(MemoryDeviceType memoryType)
+			ITMMesh(MemoryDeviceType memoryType, uint noMaxTriangles)
 			{
 				this->memoryType = memoryType;
 				this->noTotalTriangles = 0;
+				this->noMaxTriangles = noMaxTriangles;
 
 				triangles = new ORUtils::MemoryBlock<Triangle>(noMaxTriangles, memoryType);
 			}
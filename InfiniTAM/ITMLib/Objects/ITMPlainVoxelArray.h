@@ -7,6 +7,9 @@
 #endif
 
 #include "../Utils/ITMLibDefines.h"
+#ifndef __METALC__
+#include "ITMSceneParams.h"
+#endif
 #include "../../ORUtils/MemoryBlock.h"
 
 namespace ITMLib
@@ -46,7 +49,8 @@ namespace ITMLib
 
 #ifndef __METALC__
 		public:
-			ITMPlainVoxelArray(MemoryDeviceType memoryType)
+			/// The size of the volume is given by ITMVoxelArrayInfo, not by the scene parameters
+			ITMPlainVoxelArray(const ITMSceneParams *sceneParams, MemoryDeviceType memoryType)
 			{
 				this->memoryType = memoryType;
 
@@ -63,7 +67,7 @@ namespace ITMLib
 			}
 
 			/** Maximum number of total entries. */
-			int getNumAllocatedVoxelBlocks(void) { return 1; }
+			int getNumAllocatedVoxelBlocks(void) const { return 1; }
 			int getVoxelBlockSize(void) 
 			{ 
 				return indexData->GetData(MEMORYDEVICE_CPU)->size.x * 
@@ -77,6 +81,7 @@ namespace ITMLib
 
 #ifdef COMPILE_WITH_METAL
 			const void *getIndexData_MB() const { return indexData->GetMetalBuffer(); }
+			size_t getIndexDataOffset_MB(void) const { return 0; }
 #endif
 
 			// Suppress the default copy constructor and assignment operator
@@ -18,30 +18,52 @@ namespace ITMLib
 
 			ORUtils::Image<Vector4f> *locations, *colours;
 
-			explicit ITMPointCloud(Vector2i imgSize, MemoryDeviceType memoryType)
+			/** Compact ICP maps: depth along the pixel rays of the
+			    camera in pose_pointCloud and octahedral normals in the
+			    same frame. Only allocated on request, NULL otherwise.
+			    When present, the ICP maps are written here instead of
+			    to locations and colours.
+			*/
+			ITMFloatImage *compactDepth;
+			ITMShort2Image *compactNormals;
+
+			explicit ITMPointCloud(Vector2i imgSize, MemoryDeviceType memoryType, bool useCompactICPMaps = false)
 			{
 				this->noTotalPoints = 0;
 
 				locations = new ORUtils::Image<Vector4f>(imgSize, memoryType);
 				colours = new ORUtils::Image<Vector4f>(imgSize, memoryType);
+
+				compactDepth = NULL; compactNormals = NULL;
+				if (useCompactICPMaps)
+				{
+					compactDepth = new ITMFloatImage(imgSize, memoryType);
+					compactNormals = new ITMShort2Image(imgSize, memoryType);
+				}
 			}
 
 			void UpdateHostFromDevice()
 			{
 				this->locations->UpdateHostFromDevice();
 				this->colours->UpdateHostFromDevice();
+				if (compactDepth != NULL) this->compactDepth->UpdateHostFromDevice();
+				if (compactNormals != NULL) this->compactNormals->UpdateHostFromDevice();
 			}
 
 			void UpdateDeviceFromHost()
 			{
 				this->locations->UpdateDeviceFromHost();
 				this->colours->UpdateDeviceFromHost();
+				if (compactDepth != NULL) this->compactDepth->UpdateDeviceFromHost();
+				if (compactNormals != NULL) this->compactNormals->UpdateDeviceFromHost();
 			}
 
 			~ITMPointCloud()
 			{
 				delete locations;
 				delete colours;
+				if (compactDepth != NULL) delete compactDepth;
+				if (compactNormals != NULL) delete compactNormals;
 			}
 
 			// Suppress the default copy constructor and assignment operator
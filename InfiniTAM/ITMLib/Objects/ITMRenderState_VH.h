@@ -35,12 +35,12 @@ namespace ITMLib
 			/** Number of entries in the live list. */
 			int noVisibleEntries;
             
-			ITMRenderState_VH(int noTotalEntries, const Vector2i & imgSize, float vf_min, float vf_max, MemoryDeviceType memoryType = MEMORYDEVICE_CPU)
+			ITMRenderState_VH(int noTotalEntries, int noVoxelBlocks, const Vector2i & imgSize, float vf_min, float vf_max, MemoryDeviceType memoryType = MEMORYDEVICE_CPU)
 				: ITMRenderState(imgSize, vf_min, vf_max, memoryType)
             {
 				this->memoryType = memoryType;
 
-				visibleEntryIDs = new ORUtils::MemoryBlock<int>(SDF_LOCAL_BLOCK_NUM, memoryType);
+				visibleEntryIDs = new ORUtils::MemoryBlock<int>(noVoxelBlocks, memoryType);
 				entriesVisibleType = new ORUtils::MemoryBlock<uchar>(noTotalEntries, memoryType);
 				
 				noVisibleEntries = 0;
@@ -63,6 +63,17 @@ namespace ITMLib
 			*/
 			uchar *GetEntriesVisibleType(void) { return entriesVisibleType->GetData(memoryType); }
 
+			/** Reallocate the list of "visible entries" for a
+			hash table that has been resized to @p noTotalEntries
+			entries, with all entries invisible.
+			*/
+			void ResizeEntriesVisibleType(int noTotalEntries)
+			{
+				delete entriesVisibleType;
+				entriesVisibleType = new ORUtils::MemoryBlock<uchar>(noTotalEntries, memoryType);
+				entriesVisibleType->Clear();
+			}
+
 #ifdef COMPILE_WITH_METAL
 			const void* GetVisibleEntryIDs_MB(void) { return visibleEntryIDs->GetMetalBuffer(); }
 			const void* GetEntriesVisibleType_MB(void) { return entriesVisibleType->GetMetalBuffer(); }
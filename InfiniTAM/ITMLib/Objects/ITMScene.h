@@ -35,11 +35,11 @@ namespace ITMLib
 			ITMGlobalCache<TVoxel> *globalCache;
 
 			ITMScene(const ITMSceneParams *sceneParams, bool useSwapping, MemoryDeviceType memoryType)
-				: index(memoryType), localVBA(memoryType, index.getNumAllocatedVoxelBlocks(), index.getVoxelBlockSize())
+				: index(sceneParams, memoryType), localVBA(memoryType, index.getNumAllocatedVoxelBlocks(), index.getVoxelBlockSize())
 			{
 				this->sceneParams = sceneParams;
 				this->useSwapping = useSwapping;
-				if (useSwapping) globalCache = new ITMGlobalCache<TVoxel>();
+				if (useSwapping) globalCache = new ITMGlobalCache<TVoxel>(sceneParams->noHashEntries + sceneParams->noExcessEntries);
 			}
 
 			~ITMScene(void)
@@ -19,6 +19,10 @@ namespace ITMLib
 			ITMFloat4Image *normalsMap;
 			Vector4f intrinsics;
 
+			/// Compact ICP maps, never owned by the level. NULL when the point cloud has none.
+			ITMFloatImage *compactDepthMap;
+			ITMShort2Image *compactNormalsMap;
+
 			bool manageData;
 
 			ITMSceneHierarchyLevel(Vector2i imgSize, int levelId, TrackerIterationType iterationType, MemoryDeviceType memoryType, bool skipAllocation = false)
@@ -26,6 +30,8 @@ namespace ITMLib
 				this->manageData = !skipAllocation;
 				this->levelId = levelId;
 				this->iterationType = iterationType;
+				this->compactDepthMap = NULL;
+				this->compactNormalsMap = NULL;
 
 				if (!skipAllocation) {
 					this->pointsMap = new ITMFloat4Image(imgSize, memoryType);
@@ -2,8 +2,6 @@
 
 #pragma once
 
-#include "../Objects/ITMIntrinsics.h"
-
 namespace ITMLib
 {
 	namespace Objects
@@ -46,14 +44,53 @@ namespace ITMLib
 			/** Stop integration once maxW has been reached. */
 			bool stopIntegratingAtMaxW;
 
+			/** \brief
+			    Number of ordered entries and size of the excess
+			    list of the voxel block hash when the scene is
+			    created. The number of ordered entries should be
+			    2^n and a multiple of @ref noEntriesPerBucket.
+			*/
+			int noHashEntries, noExcessEntries;
+
+			/** \brief
+			    Number of ordered entries per bucket of the voxel
+			    block hash, should be 2^n. The excess list only
+			    takes a block once its bucket is full, 4 entries
+			    fill one 64 byte cache line.
+			*/
+			int noEntriesPerBucket;
+
+			/** \brief
+			    The CPU engine rehashes into a table with twice as
+			    many ordered entries and excess list entries once
+			    the allocated blocks exceed @ref maxHashLoad times
+			    the ordered entries, or more than @ref maxExcessLoad
+			    of the excess list is in use. Values of 1 or more
+			    keep the table at its initial size.
+			*/
+			float maxHashLoad, maxExcessLoad;
+
+			/** \brief
+			    Maximum number of voxel blocks held in memory. On
+			    the CPU the voxel block array only takes memory for
+			    the blocks in use, so this is a cap rather than a
+			    reservation.
+			*/
+			int noVoxelBlocks;
+
 			ITMSceneParams(float mu, int maxW, float voxelSize, 
-				float viewFrustum_min, float viewFrustum_max, bool stopIntegratingAtMaxW)
+				float viewFrustum_min, float viewFrustum_max, bool stopIntegratingAtMaxW,
+				int noHashEntries, int noExcessEntries, int noEntriesPerBucket, float maxHashLoad, float maxExcessLoad, int noVoxelBlocks)
 			{
 				this->mu = mu;
 				this->maxW = maxW;
 				this->voxelSize = voxelSize;
 				this->viewFrustum_min = viewFrustum_min; this->viewFrustum_max = viewFrustum_max;
 				this->stopIntegratingAtMaxW = stopIntegratingAtMaxW;
+				this->noHashEntries = noHashEntries; this->noExcessEntries = noExcessEntries;
+				this->noEntriesPerBucket = noEntriesPerBucket;
+				this->maxHashLoad = maxHashLoad; this->maxExcessLoad = maxExcessLoad;
+				this->noVoxelBlocks = noVoxelBlocks;
 			}
 
 			explicit ITMSceneParams(const ITMSceneParams *sceneParams) { this->SetFrom(sceneParams); }
@@ -66,6 +103,12 @@ namespace ITMLib
 				this->mu = sceneParams->mu;
 				this->maxW = sceneParams->maxW;
 				this->stopIntegratingAtMaxW = sceneParams->stopIntegratingAtMaxW;
+				this->noHashEntries = sceneParams->noHashEntries;
+				this->noExcessEntries = sceneParams->noExcessEntries;
+				this->noEntriesPerBucket = sceneParams->noEntriesPerBucket;
+				this->maxHashLoad = sceneParams->maxHashLoad;
+				this->maxExcessLoad = sceneParams->maxExcessLoad;
+				this->noVoxelBlocks = sceneParams->noVoxelBlocks;
 			}
 		};
 	}
@@ -0,0 +1,58 @@
+// Copyright 2014-2015 Isis Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include "../Utils/ITMLibDefines.h"
+#include "../../ORUtils/MemoryBlock.h"
+
+namespace ITMLib
+{
+	namespace Objects
+	{
+		/** \brief
+		    Compact list of the pixel (or point) indices a tracker
+		    evaluates at one level of its image hierarchy.
+		*/
+		class ITMSelectionHierarchyLevel
+		{
+		public:
+			int levelId;
+
+			TrackerIterationType iterationType;
+
+			ORUtils::MemoryBlock<int> *indices;
+			int noSelected;
+
+			bool manageData;
+
+			ITMSelectionHierarchyLevel(Vector2i imgSize, int levelId, TrackerIterationType iterationType, MemoryDeviceType memoryType, bool skipAllocation = false)
+			{
+				this->manageData = !skipAllocation;
+				this->levelId = levelId;
+				this->iterationType = iterationType;
+				this->noSelected = 0;
+
+				if (!skipAllocation) this->indices = new ORUtils::MemoryBlock<int>(imgSize.x * imgSize.y, memoryType);
+			}
+
+			void UpdateHostFromDevice()
+			{ 
+				this->indices->UpdateHostFromDevice();
+			}
+
+			void UpdateDeviceFromHost()
+			{ 
+				this->indices->UpdateDeviceFromHost();
+			}
+
+			~ITMSelectionHierarchyLevel(void)
+			{
+				if (manageData) delete indices;
+			}
+
+			// Suppress the default copy constructor and assignment operator
+			ITMSelectionHierarchyLevel(const ITMSelectionHierarchyLevel&);
+			ITMSelectionHierarchyLevel& operator=(const ITMSelectionHierarchyLevel&);
+		};
+	}
+}
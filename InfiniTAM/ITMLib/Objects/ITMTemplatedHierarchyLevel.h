@@ -28,6 +28,14 @@ namespace ITMLib
 				if (!skipAllocation) this->depth = new ImageType(imgSize, memoryType);
 			}
 
+			/// Use an image owned by someone else instead of the level's own one
+			void SetExternalData(ImageType *data)
+			{
+				if (manageData) delete depth;
+				this->depth = data;
+				this->manageData = false;
+			}
+
 			void UpdateHostFromDevice()
 			{ 
 				this->depth->UpdateHostFromDevice();
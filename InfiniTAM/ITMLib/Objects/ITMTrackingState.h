@@ -38,6 +38,42 @@ namespace ITMLib
 
 			bool requiresFullRendering;
 
+			/// Outcome of tracking the current frame
+			typedef enum {
+				//! The pose can be used for fusion
+				TRACKING_GOOD,
+				//! The tracker lost the camera, the pose is either unreliable or a relocalised guess
+				TRACKING_FAILED
+			} TrackingResult;
+
+			TrackingResult trackerResult;
+
+			/** Final residual of the depth trackers, or a negative
+			    value if the last tracker run did not report one.
+			*/
+			float trackingResidual;
+
+			/// Fraction of the evaluated pixels that found a correspondence in the final iteration
+			float trackingInlierRatio;
+
+			void ResetTrackingQuality(void)
+			{
+				trackingResidual = -1.0f;
+				trackingInlierRatio = -1.0f;
+			}
+
+			/** Report the outcome of a tracker run that found
+			    @p noValidPoints correspondences among
+			    @p noEvaluatedPoints pixels with final residual
+			    @p residual.
+			*/
+			void SetTrackingQuality(float residual, int noValidPoints, int noEvaluatedPoints)
+			{
+				// no correspondences at all is reported as the same large residual as too few of them
+				trackingResidual = (noValidPoints > 0) ? residual : 1e5f;
+				trackingInlierRatio = (noEvaluatedPoints > 0) ? (float)noValidPoints / (float)noEvaluatedPoints : 0.0f;
+			}
+
 			bool TrackerFarFromPointCloud(void) const
 			{
 				// if no point cloud exists, yet
@@ -58,9 +94,9 @@ namespace ITMLib
 				return false;
 			}
 
-			ITMTrackingState(Vector2i imgSize, MemoryDeviceType memoryType)
+			ITMTrackingState(Vector2i imgSize, MemoryDeviceType memoryType, bool useCompactICPMaps = false)
 			{
-				this->pointCloud = new ITMPointCloud(imgSize, memoryType);
+				this->pointCloud = new ITMPointCloud(imgSize, memoryType, useCompactICPMaps);
 
 				this->pose_d = new ITMPose();
 				this->pose_d->SetFrom(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
@@ -70,6 +106,9 @@ namespace ITMLib
 				this->pose_pointCloud->SetFrom(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 
 				requiresFullRendering = true;
+				trackerResult = TRACKING_GOOD;
+
+				ResetTrackingQuality();
 			}
 
 			~ITMTrackingState(void)
@@ -33,6 +33,11 @@ namespace ITMLib
 			/// allocated when needed
 			ITMFloatImage *depthUncertainty;
 
+			/// depth image subsampled by factors of two with holes, level 0 being @ref depth
+			/// allocated when needed
+			ITMFloatImage **depthPyramid;
+			int noDepthPyramidLevels;
+
 			ITMView(const ITMRGBDCalib *calibration, Vector2i imgSize_rgb, Vector2i imgSize_d, bool useGPU)
 			{
 				this->calib = new ITMRGBDCalib(*calibration);
@@ -40,6 +45,8 @@ namespace ITMLib
 				this->depth = new ITMFloatImage(imgSize_d, true, useGPU);
 				this->depthNormal = NULL;
 				this->depthUncertainty = NULL;
+				this->depthPyramid = NULL;
+				this->noDepthPyramidLevels = 0;
 			}
 
 			virtual ~ITMView(void)
@@ -51,6 +58,12 @@ namespace ITMLib
 
 				if (depthNormal != NULL) delete depthNormal;
 				if (depthUncertainty != NULL) delete depthUncertainty;
+
+				if (depthPyramid != NULL)
+				{
+					for (int levelId = 1; levelId < noDepthPyramidLevels; levelId++) delete depthPyramid[levelId];
+					delete[] depthPyramid;
+				}
 			}
 
 			// Suppress the default copy constructor and assignment operator
@@ -8,6 +8,9 @@
 
 #include "../Utils/ITMLibDefines.h"
 
+#ifndef __METALC__
+#include "ITMSceneParams.h"
+#endif
 #include "../../ORUtils/MemoryBlock.h"
 
 namespace ITMLib
@@ -18,6 +21,17 @@ namespace ITMLib
 		This is the central class for the voxel block hash
 		implementation. It contains all the data needed on the CPU
 		and a pointer to the data structure on the GPU.
+
+		The table holds the ordered entries, followed by the excess
+		list and, for tables in host memory, the block filter. All
+		sizes are chosen at runtime, so the entries are preceded by a
+		header entry that stores the number of ordered entries in its
+		offset, the size of the excess list in its ptr, the log2 of
+		the number of filter lines in its pos.x, whether there is
+		a filter in its pos.y and the number of entries per bucket
+		in its pos.z. GetEntries() points past the header, and
+		lookups read it from there, see getNoOrderedEntries() and
+		getBlockFilter().
 		*/
 		class ITMVoxelBlockHash
 		{
@@ -30,15 +44,31 @@ namespace ITMLib
 				_CPU_AND_GPU_CODE_ IndexCache(void) : blockPos(0x7fffffff), blockPtr(-1) {}
 			};
 
-			/** Maximum number of total entries. */
-			static const CONSTPTR(int) noTotalEntries = SDF_BUCKET_NUM + SDF_EXCESS_LIST_SIZE;
+			/** Occupancy and probe lengths of the hash table, see
+			ComputeStatistics(). Entries in use are allocated or
+			swapped out, a bucket is full if all of its ordered
+			entries are in use.
+			*/
+			struct Statistics {
+				int noAllocatedEntries, noSwappedOutEntries;
+				int noOrderedEntries, noExcessEntries;
+				int noUsedBuckets, noFullBuckets;
+				int maxChainLength, maxProbeLength;
+				float averageProbeLength;
+			};
+
 			static const CONSTPTR(int) voxelBlockSize = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
 
 #ifndef __METALC__
+			/** Number of total entries, ordered and excess list. */
+			int noTotalEntries;
+
 		private:
+			int noOrderedEntries, noExcessEntries, noEntriesPerBucket, noFilterLines;
 			int lastFreeExcessListId;
+			int noVoxelBlocks;
 
-			/** The actual data in the hash table. */
+			/** The actual data in the hash table, after the header entry, followed by the block filter. */
 			ORUtils::MemoryBlock<ITMHashEntry> *hashEntries;
 
 			/** Identifies which entries of the overflow
@@ -47,29 +77,125 @@ namespace ITMLib
 			overflow.
 			*/
 			ORUtils::MemoryBlock<int> *excessAllocationList;
+
+			/** Number of allocated blocks in each super-block of
+			the coarse occupancy hierarchy, hashed per level. Used
+			by the CPU raycaster to skip unallocated space and
+			maintained by the CPU engines.
+			*/
+			ORUtils::MemoryBlock<int> *blockOccupancy;
+
+			/** Number of blocks removed from the hash table since
+			the block filter was last rebuilt, see GetBlockFilter().
+			*/
+			int noFilterRemovals;
+
+			/** Number of blocks that could not be allocated since
+			the scene was reset, because the voxel block array or
+			the excess list was full.
+			*/
+			int noDroppedAllocations;
         
 			MemoryDeviceType memoryType;
 
+			/** Lines of the block filter for a table with the given
+			number of ordered entries, so that the rate of false
+			positives stays the same as the table grows. Only the
+			host side engines maintain the filter, so tables in
+			device memory have none.
+			*/
+			int ComputeNoFilterLines(int noOrderedEntries) const
+			{
+				if (memoryType != MEMORYDEVICE_CPU) return 0;
+				return MAX(noOrderedEntries / SDF_FILTER_ENTRIES_PER_LINE, 1);
+			}
+
+			/** Allocate the entries and the block filter behind them. */
+			void AllocateEntries(void)
+			{
+				noFilterLines = ComputeNoFilterLines(noOrderedEntries);
+				int noFilterEntries = (int)((noFilterLines * SDF_FILTER_LINE_WORDS * sizeof(uint) + sizeof(ITMHashEntry) - 1) / sizeof(ITMHashEntry));
+
+				hashEntries = new ORUtils::MemoryBlock<ITMHashEntry>(noTotalEntries + 1 + noFilterEntries, memoryType);
+				excessAllocationList = new ORUtils::MemoryBlock<int>(noExcessEntries, memoryType);
+				WriteHeader();
+			}
+
+			/** Write the sizes of the table into its header entry. */
+			void WriteHeader(void)
+			{
+				int filterLineShift = 0;
+				while ((1 << filterLineShift) < noFilterLines) filterLineShift++;
+
+				ITMHashEntry header;
+				header.pos.x = filterLineShift; header.pos.y = (noFilterLines > 0) ? 1 : 0; header.pos.z = noEntriesPerBucket;
+				header.offset = noOrderedEntries; header.ptr = noExcessEntries;
+
+				if (memoryType == MEMORYDEVICE_CUDA)
+				{
+#ifndef COMPILE_WITHOUT_CUDA
+					ITMSafeCall(cudaMemcpy(hashEntries->GetData(memoryType), &header, sizeof(ITMHashEntry), cudaMemcpyHostToDevice));
+#endif
+				}
+				else hashEntries->GetData(memoryType)[0] = header;
+			}
+
 		public:
-			ITMVoxelBlockHash(MemoryDeviceType memoryType)
+			ITMVoxelBlockHash(const ITMSceneParams *sceneParams, MemoryDeviceType memoryType)
 			{
 				this->memoryType = memoryType;
-				hashEntries = new ORUtils::MemoryBlock<ITMHashEntry>(noTotalEntries, memoryType);
-				excessAllocationList = new ORUtils::MemoryBlock<int>(SDF_EXCESS_LIST_SIZE, memoryType);
+				this->noOrderedEntries = sceneParams->noHashEntries;
+				this->noExcessEntries = sceneParams->noExcessEntries;
+				this->noEntriesPerBucket = sceneParams->noEntriesPerBucket;
+				this->noTotalEntries = noOrderedEntries + noExcessEntries;
+				this->noVoxelBlocks = sceneParams->noVoxelBlocks;
+
+				if (noVoxelBlocks <= 0) DIEWITHEXCEPTION("The number of voxel blocks has to be positive");
+				if (noEntriesPerBucket <= 0 || (noEntriesPerBucket & (noEntriesPerBucket - 1)) != 0)
+					DIEWITHEXCEPTION("The number of entries per hash bucket has to be 2^n");
+				if (noOrderedEntries < noEntriesPerBucket || (noOrderedEntries & (noOrderedEntries - 1)) != 0)
+					DIEWITHEXCEPTION("The number of ordered hash entries has to be 2^n and at least the number of entries per bucket");
+
+				AllocateEntries();
+
+				blockOccupancy = new ORUtils::MemoryBlock<int>(SDF_SUPERBLOCK_LEVELS * SDF_OCCUPANCY_NUM, memoryType);
+				noFilterRemovals = 0;
+				noDroppedAllocations = 0;
 			}
 
 			~ITMVoxelBlockHash(void)
 			{
 				delete hashEntries;
 				delete excessAllocationList;
+				delete blockOccupancy;
 			}
 
 			/** Get the list of actual entries in the hash table. */
-			const ITMHashEntry *GetEntries(void) const { return hashEntries->GetData(memoryType); }
-			ITMHashEntry *GetEntries(void) { return hashEntries->GetData(memoryType); }
+			const ITMHashEntry *GetEntries(void) const { return hashEntries->GetData(memoryType) + 1; }
+			ITMHashEntry *GetEntries(void) { return hashEntries->GetData(memoryType) + 1; }
 
-			const IndexData *getIndexData(void) const { return hashEntries->GetData(memoryType); }
-			IndexData *getIndexData(void) { return hashEntries->GetData(memoryType); }
+			const IndexData *getIndexData(void) const { return hashEntries->GetData(memoryType) + 1; }
+			IndexData *getIndexData(void) { return hashEntries->GetData(memoryType) + 1; }
+
+			int GetNoOrderedEntries(void) const { return noOrderedEntries; }
+			int GetNoExcessEntries(void) const { return noExcessEntries; }
+			int GetNoEntriesPerBucket(void) const { return noEntriesPerBucket; }
+
+			/** Reallocate the table for the given sizes. The
+			entries, the excess allocation list and the block
+			filter are left uninitialised, the caller has to fill
+			them in again.
+			*/
+			void Resize(int noOrderedEntries, int noExcessEntries)
+			{
+				this->noOrderedEntries = noOrderedEntries;
+				this->noExcessEntries = noExcessEntries;
+				this->noTotalEntries = noOrderedEntries + noExcessEntries;
+
+				delete hashEntries;
+				delete excessAllocationList;
+				AllocateEntries();
+			}
 
 			/** Get the list that identifies which entries of the
 			overflow list are allocated. This is used if too
@@ -78,17 +204,104 @@ namespace ITMLib
 			const int *GetExcessAllocationList(void) const { return excessAllocationList->GetData(memoryType); }
 			int *GetExcessAllocationList(void) { return excessAllocationList->GetData(memoryType); }
 
+			/** Get the per level occupancy counters of the
+			super-blocks, see occupancyIndex().
+			*/
+			const int *GetBlockOccupancy(void) const { return blockOccupancy->GetData(memoryType); }
+			int *GetBlockOccupancy(void) { return blockOccupancy->GetData(memoryType); }
+
+			/** Get the blocked Bloom filter over the positions of
+			the allocated blocks, see mayContainBlock(). Lets the CPU
+			lookups reject most unallocated blocks without touching
+			the hash table. Blocks are only ever added, so the filter
+			is rebuilt once SDF_FILTER_REBUILD_REMOVALS blocks have
+			been removed from the hash table since the last rebuild.
+			*/
+			const uint *GetBlockFilter(void) const { return (const uint*)(GetEntries() + noTotalEntries); }
+			uint *GetBlockFilter(void) { return (uint*)(GetEntries() + noTotalEntries); }
+
+			/** Number of lines of the block filter, 0 if the table has none. */
+			int GetNoFilterLines(void) const { return noFilterLines; }
+
+			int GetNoFilterRemovals(void) { return noFilterRemovals; }
+			void SetNoFilterRemovals(int noFilterRemovals) { this->noFilterRemovals = noFilterRemovals; }
+
+			int GetNoDroppedAllocations(void) { return noDroppedAllocations; }
+			void SetNoDroppedAllocations(int noDroppedAllocations) { this->noDroppedAllocations = noDroppedAllocations; }
+
+			/** Walk all buckets of the table and gather its
+			occupancy, tables in device memory are copied to the
+			host first. An entry in slot i of its bucket takes
+			i + 1 comparisons to find, the k-th entry of the excess
+			list chained to the bucket noEntriesPerBucket + k.
+			*/
+			void ComputeStatistics(Statistics &stats) const
+			{
+				ORUtils::MemoryBlock<ITMHashEntry> hostEntries(noTotalEntries, MEMORYDEVICE_CPU);
+				ITMHashEntry *hashTable = hostEntries.GetData(MEMORYDEVICE_CPU);
+
+				if (memoryType == MEMORYDEVICE_CUDA)
+				{
+#ifndef COMPILE_WITHOUT_CUDA
+					ITMSafeCall(cudaMemcpy(hashTable, GetEntries(), noTotalEntries * sizeof(ITMHashEntry), cudaMemcpyDeviceToHost));
+#endif
+				}
+				else memcpy(hashTable, GetEntries(), noTotalEntries * sizeof(ITMHashEntry));
+
+				memset(&stats, 0, sizeof(stats));
+				double sumProbeLength = 0.0;
+
+				for (int bucketStart = 0; bucketStart < noOrderedEntries; bucketStart += noEntriesPerBucket)
+				{
+					int noUsedEntries = 0, probeLength = 0;
+
+					for (int entryId = 0; entryId < noEntriesPerBucket; entryId++)
+					{
+						const ITMHashEntry &hashEntry = hashTable[bucketStart + entryId];
+						if (hashEntry.ptr < -1) continue;
+
+						noUsedEntries++; probeLength = entryId + 1;
+						sumProbeLength += probeLength;
+						if (hashEntry.ptr >= 0) stats.noAllocatedEntries++; else stats.noSwappedOutEntries++;
+					}
+
+					int chainLength = 0, offset = hashTable[bucketStart + noEntriesPerBucket - 1].offset;
+					while (offset >= 1)
+					{
+						const ITMHashEntry &hashEntry = hashTable[noOrderedEntries + offset - 1];
+
+						chainLength++; probeLength = noEntriesPerBucket + chainLength;
+						sumProbeLength += probeLength;
+						if (hashEntry.ptr >= 0) stats.noAllocatedEntries++; else stats.noSwappedOutEntries++;
+
+						offset = hashEntry.offset;
+					}
+
+					stats.noOrderedEntries += noUsedEntries;
+					stats.noExcessEntries += chainLength;
+					if (noUsedEntries > 0) stats.noUsedBuckets++;
+					if (noUsedEntries == noEntriesPerBucket) stats.noFullBuckets++;
+					stats.maxChainLength = MAX(stats.maxChainLength, chainLength);
+					stats.maxProbeLength = MAX(stats.maxProbeLength, probeLength);
+				}
+
+				int noEntries = stats.noOrderedEntries + stats.noExcessEntries;
+				stats.averageProbeLength = (noEntries > 0) ? (float)(sumProbeLength / noEntries) : 0.0f;
+			}
+
 			int GetLastFreeExcessListId(void) { return lastFreeExcessListId; }
 			void SetLastFreeExcessListId(int lastFreeExcessListId) { this->lastFreeExcessListId = lastFreeExcessListId; }
 
 #ifdef COMPILE_WITH_METAL
+			/// The buffer of the entries includes the header entry, bind it at getIndexDataOffset_MB()
 			const void* GetEntries_MB(void) { return hashEntries->GetMetalBuffer(); }
 			const void* GetExcessAllocationList_MB(void) { return excessAllocationList->GetMetalBuffer(); }
 			const void* getIndexData_MB(void) const { return hashEntries->GetMetalBuffer(); }
+			size_t getIndexDataOffset_MB(void) const { return sizeof(ITMHashEntry); }
 #endif
 
-			/** Maximum number of total entries. */
-			int getNumAllocatedVoxelBlocks(void) { return SDF_LOCAL_BLOCK_NUM; }
+			/** Maximum number of voxel blocks in the local voxel block array. */
+			int getNumAllocatedVoxelBlocks(void) const { return noVoxelBlocks; }
 			int getVoxelBlockSize(void) { return SDF_BLOCK_SIZE3; }
 
 			// Suppress the default copy constructor and assignment operator
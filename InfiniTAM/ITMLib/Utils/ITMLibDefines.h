@@ -35,14 +35,34 @@
 
 #define SDF_BLOCK_SIZE 8				// SDF block size
 #define SDF_BLOCK_SIZE3 512				// SDF_BLOCK_SIZE3 = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE
-#define SDF_LOCAL_BLOCK_NUM 0x40000		// Number of locally stored blocks, currently 2^17
+#define SDF_VOXEL_LAYOUT_LINEAR 0		// Voxels of a block stored x fastest, then y, then z
+#define SDF_VOXEL_LAYOUT_BRICKED 1		// Voxels of a block stored in 2x2x2 bricks, the bricks in linear order
+#define SDF_VOXEL_LAYOUT_MORTON 2		// Voxels of a block stored along a Morton (Z-order) curve
+#ifndef SDF_VOXEL_LAYOUT
+#define SDF_VOXEL_LAYOUT SDF_VOXEL_LAYOUT_LINEAR	// Order of the voxels inside a block, see voxelIndexInBlock()
+#endif
+#if SDF_VOXEL_LAYOUT == SDF_VOXEL_LAYOUT_MORTON && SDF_BLOCK_SIZE != 8
+#error The Morton voxel layout needs SDF_BLOCK_SIZE 8
+#endif
+#define SDF_LOCAL_BLOCK_NUM 0x40000		// Default maximum number of locally stored blocks, see ITMSceneParams::noVoxelBlocks
 
-#define SDF_GLOBAL_BLOCK_NUM 0x120000	// Number of globally stored blocks: SDF_BUCKET_NUM + SDF_EXCESS_LIST_SIZE
 #define SDF_TRANSFER_BLOCK_NUM 0x1000	// Maximum number of blocks transfered in one swap operation
 
-#define SDF_BUCKET_NUM 0x100000			// Number of Hash Bucket, should be 2^n and bigger than SDF_LOCAL_BLOCK_NUM, SDF_HASH_MASK = SDF_BUCKET_NUM - 1
-#define SDF_HASH_MASK 0xfffff			// Used for get hashing value of the bucket index,  SDF_HASH_MASK = SDF_BUCKET_NUM - 1
-#define SDF_EXCESS_LIST_SIZE 0x20000	// 0x20000 Size of excess list, used to handle collisions. Also max offset (unsigned short) value.
+#define SDF_BUCKET_NUM 0x100000			// Default number of ordered hash entries, see ITMSceneParams::noHashEntries, should be 2^n and bigger than SDF_LOCAL_BLOCK_NUM
+#define SDF_EXCESS_LIST_SIZE 0x20000	// Default size of excess list, used to handle collisions, see ITMSceneParams::noExcessEntries
+#define SDF_ENTRY_NUM_PER_BUCKET 1		// Default number of ordered entries per hash bucket, see ITMSceneParams::noEntriesPerBucket, should be 2^n
+
+#define SDF_SUPERBLOCK_SHIFT 2			// Each level of the block occupancy hierarchy groups 2^SDF_SUPERBLOCK_SHIFT cubed cells of the level below
+#define SDF_SUPERBLOCK_LEVELS 2			// Number of levels of the block occupancy hierarchy, i.e. super-blocks of 4^3 and 16^3 blocks
+#define SDF_OCCUPANCY_NUM 0x10000		// Number of hashed occupancy counters per level, should be 2^n, SDF_OCCUPANCY_MASK = SDF_OCCUPANCY_NUM - 1
+#define SDF_OCCUPANCY_MASK 0xffff		// Used for get hashing value of the occupancy counter index
+#ifndef SDF_CHECK_BLOCK_OCCUPANCY
+#define SDF_CHECK_BLOCK_OCCUPANCY 0		// Set to 1 to check the occupancy counters against the hash table whenever blocks are allocated or removed (slow)
+#endif
+
+#define SDF_FILTER_ENTRIES_PER_LINE 0x100	// Number of ordered hash entries per 512 bit line of the filter over allocated blocks, should be 2^n
+#define SDF_FILTER_LINE_WORDS 16		// Number of 32 bit words per filter line, i.e. one cache line
+#define SDF_FILTER_REBUILD_REMOVALS 0x4000	// Number of blocks removed from the hash after which the filter is rebuilt
 
 //////////////////////////////////////////////////////////////////////////
 // Voxel Hashing data structures
@@ -215,6 +235,10 @@ typedef ITMLib::Objects::ITMVoxelBlockHash ITMVoxelIndex;
 #define ITMShortImage ORUtils::Image<short>
 #endif
 
+#ifndef ITMShort2Image
+#define ITMShort2Image ORUtils::Image<Vector2s_>
+#endif
+
 #ifndef ITMShort3Image
 #define ITMShort3Image ORUtils::Image<Vector3s>
 #endif
@@ -7,7 +7,7 @@
 using namespace ITMLib::Objects;
 
 ITMLibSettings::ITMLibSettings(void)
-	: sceneParams(0.02f, 100, 0.005f, 0.2f, 3.0f, false)
+	: sceneParams(0.02f, 100, 0.005f, 0.2f, 3.0f, false, SDF_BUCKET_NUM, SDF_EXCESS_LIST_SIZE, SDF_ENTRY_NUM_PER_BUCKET, 0.5f, 0.75f, SDF_LOCAL_BLOCK_NUM)
 {
 	/// depth threashold for the ICP tracker
 	depthTrackerICPThreshold = 0.1f * 0.1f;
@@ -15,9 +15,32 @@ ITMLibSettings::ITMLibSettings(void)
 	/// For ITMDepthTracker: ICP iteration termination threshold
 	depthTrackerTerminationThreshold = 1e-3f;
 
+	/// run the full resolution tracker only when a coarse run up to level 1 fails the quality test
+	useTrackerCascade = false;
+	cascadeCheapTillLevel = 1;
+	cascadeMaxResidual = 5e-5f;
+	cascadeMinInlierRatio = 0.2f;
+
+	/// recover from tracking failures by jumping to the most similar keyframe
+	useRelocalisation = false;
+	relocalisationMaxResidual = 1e-4f;
+	relocalisationMinInlierRatio = 0.1f;
+	relocalisationNoFerns = 500;
+	relocalisationNoDecisionsPerFern = 4;
+	relocalisationKeyframeDissimilarity = 0.2f;
+	relocalisationMaxNoKeyframes = 1000;
+
 	/// skips every other point when using the colour tracker
 	skipPoints = true;
 
+	/// evaluate all pixels in the trackers, or only a selected subset of them
+	pixelSelectionType = PIXELSELECTION_ALL;
+	//pixelSelectionType = PIXELSELECTION_STRIDED;
+	//pixelSelectionType = PIXELSELECTION_INFORMATIVE;
+
+	/// keeps about one in four pixels when pixel selection is enabled
+	pixelSelectionStride = 2;
+
 #ifndef COMPILE_WITHOUT_CUDA
 	deviceType = DEVICE_CUDA;
 #else
@@ -33,9 +56,26 @@ ITMLibSettings::ITMLibSettings(void)
 	/// enables or disables swapping. HERE BE DRAGONS: It should work, but requires more testing
 	useSwapping = false;
 
+	/// garbage collection is off, e.g. 30 runs it about once a second at 30 Hz; a lower garbageCollectionMinSdf and higher garbageCollectionMaxW release more
+	garbageCollectionInterval = 0;
+	garbageCollectionMinSdf = 0.95f;
+	garbageCollectionMaxW = 5;
+
+	/// defragmentation is off; it copies every block in use, so run it rarely, e.g. after garbage collection has freed many blocks
+	defragmentationInterval = 0;
+
 	/// enables or disables approximate raycast
 	useApproximateRaycast = false;
 
+	/// enables or disables the compact ICP maps, 8 instead of 32 bytes per pixel
+	useCompactICPMaps = false;
+
+	/// seed the ICP map raycasts with the previous raycast, falling back to a full march where that finds no surface
+	useTemporalRaycastSeeding = false;
+
+	/// track colour on one intensity channel, a quarter of the image and gradient traffic
+	useIntensityColourTracking = false;
+
 	/// enable or disable bilateral depth filtering;
 	useBilateralFilter = false;
 
@@ -25,6 +25,16 @@ namespace ITMLib
 			/// Enables swapping between host and device.
 			bool useSwapping;
 
+			/// Every this many fused frames, release the voxel blocks out of view that carry no surface, 0 disables this (CPU only, not with swapping)
+			int garbageCollectionInterval;
+
+			/// For garbage collection: a block is released if all its observed voxels have an SDF of at least garbageCollectionMinSdf, in units of mu, and none has a weight above garbageCollectionMaxW
+			float garbageCollectionMinSdf;
+			int garbageCollectionMaxW;
+
+			/// Every this many fused frames, move the voxel blocks in use together in Morton order of their positions, 0 disables this (CPU only)
+			int defragmentationInterval;
+
 			bool useApproximateRaycast;
 
 			bool useBilateralFilter;
@@ -60,6 +70,55 @@ namespace ITMLib
 			/// For ITMColorTracker: skip every other point in energy function evaluation.
 			bool skipPoints;
 
+			/// Pixel selection strategies shared by the trackers
+			typedef enum {
+				//! Evaluate every valid pixel
+				PIXELSELECTION_ALL,
+				//! Evaluate the valid pixels on a regular grid
+				PIXELSELECTION_STRIDED,
+				//! Normal-space sampling for depth trackers, high-gradient sampling for the colour tracker
+				PIXELSELECTION_INFORMATIVE
+			} PixelSelectionType;
+
+			/// Select which pixels the trackers evaluate in their energy functions
+			PixelSelectionType pixelSelectionType;
+
+			/// For pixel selection: keep about one in pixelSelectionStride^2 pixels at each level
+			int pixelSelectionStride;
+
+			/// For ITMDepthTracker: raycast the ICP maps into ray depths and octahedral normals (CPU only)
+			bool useCompactICPMaps;
+
+			/// Start the tracking raycasts near the surface seen by the previous raycast, reprojected into the new pose (CPU only)
+			bool useTemporalRaycastSeeding;
+
+			/// For ITMColorTracker: track on a single channel intensity pyramid instead of RGB (CPU only)
+			bool useIntensityColourTracking;
+
+			/// For the ICP, weighted ICP and IMU trackers: try a coarse run of the tracker first and only run the full tracker if its result is poor
+			bool useTrackerCascade;
+
+			/// For the tracker cascade: the finest hierarchy level the cheap stage runs on
+			int cascadeCheapTillLevel;
+
+			/// For the tracker cascade: largest residual and smallest inlier ratio of an acceptable cheap stage
+			float cascadeMaxResidual, cascadeMinInlierRatio;
+
+			/// For the ICP, weighted ICP and IMU trackers: detect tracking failures and relocalise against stored keyframes
+			bool useRelocalisation;
+
+			/// For relocalisation: tracking has failed if the residual is above or the inlier ratio below these
+			float relocalisationMaxResidual, relocalisationMinInlierRatio;
+
+			/// For relocalisation: number of random ferns and of depth tests per fern used to encode keyframes
+			int relocalisationNoFerns, relocalisationNoDecisionsPerFern;
+
+			/// For relocalisation: a frame becomes a keyframe if its dissimilarity to all keyframes is above this
+			float relocalisationKeyframeDissimilarity;
+
+			/// For relocalisation: upper limit on the number of stored keyframes
+			int relocalisationMaxNoKeyframes;
+
 			/// For ITMDepthTracker: ICP distance threshold
 			float depthTrackerICPThreshold;
 
@@ -26,6 +26,9 @@ typedef class ORUtils::Vector2<int> Vector2i;
 typedef class ORUtils::Vector2<float> Vector2f;
 typedef class ORUtils::Vector2<double> Vector2d;
 
+/// Plain storage for a Vector2s, for images that are cleared bytewise
+typedef struct ORUtils::Vector2_<short> Vector2s_;
+
 typedef class ORUtils::Vector3<short> Vector3s;
 typedef class ORUtils::Vector3<double> Vector3d;
 typedef class ORUtils::Vector3<int> Vector3i;
@@ -80,6 +83,7 @@ typedef float3x3 Matrix3f;
 typedef float4x4 Matrix4f;
 
 typedef short2 Vector2s;
+typedef short2 Vector2s_;
 typedef int2 Vector2i;
 typedef float2 Vector2f;
 